@@ -0,0 +1,28 @@
+#----------------------------------------------------------------
+# Generated CMake target import file for configuration "Debug".
+#----------------------------------------------------------------
+
+# Commands may need to know the format version.
+set(CMAKE_IMPORT_FILE_VERSION 1)
+
+# Import target "awk::awk_exe" for configuration "Debug"
+set_property(TARGET awk::awk_exe APPEND PROPERTY IMPORTED_CONFIGURATIONS DEBUG)
+set_target_properties(awk::awk_exe PROPERTIES
+  IMPORTED_LOCATION_DEBUG "${_IMPORT_PREFIX}/bin/awk"
+  )
+
+list(APPEND _cmake_import_check_targets awk::awk_exe )
+list(APPEND _cmake_import_check_files_for_awk::awk_exe "${_IMPORT_PREFIX}/bin/awk" )
+
+# Import target "awk::awk_lib" for configuration "Debug"
+set_property(TARGET awk::awk_lib APPEND PROPERTY IMPORTED_CONFIGURATIONS DEBUG)
+set_target_properties(awk::awk_lib PROPERTIES
+  IMPORTED_LINK_INTERFACE_LANGUAGES_DEBUG "CXX"
+  IMPORTED_LOCATION_DEBUG "${_IMPORT_PREFIX}/lib/libawk.a"
+  )
+
+list(APPEND _cmake_import_check_targets awk::awk_lib )
+list(APPEND _cmake_import_check_files_for_awk::awk_lib "${_IMPORT_PREFIX}/lib/libawk.a" )
+
+# Commands beyond this point should not need to know the version.
+set(CMAKE_IMPORT_FILE_VERSION)
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/awk_exe.dir/src/main.cpp.o"
+  "CMakeFiles/awk_exe.dir/src/main.cpp.o.d"
+  "Release/awk"
+  "Release/awk.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/awk_exe.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
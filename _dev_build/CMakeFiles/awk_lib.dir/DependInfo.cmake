@@ -0,0 +1,40 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/src/array.cpp" "CMakeFiles/awk_lib.dir/src/array.cpp.o" "gcc" "CMakeFiles/awk_lib.dir/src/array.cpp.o.d"
+  "/root/repo/src/compiler.cpp" "CMakeFiles/awk_lib.dir/src/compiler.cpp.o" "gcc" "CMakeFiles/awk_lib.dir/src/compiler.cpp.o.d"
+  "/root/repo/src/environment.cpp" "CMakeFiles/awk_lib.dir/src/environment.cpp.o" "gcc" "CMakeFiles/awk_lib.dir/src/environment.cpp.o.d"
+  "/root/repo/src/i18n.cpp" "CMakeFiles/awk_lib.dir/src/i18n.cpp.o" "gcc" "CMakeFiles/awk_lib.dir/src/i18n.cpp.o.d"
+  "/root/repo/src/interpreter.cpp" "CMakeFiles/awk_lib.dir/src/interpreter.cpp.o" "gcc" "CMakeFiles/awk_lib.dir/src/interpreter.cpp.o.d"
+  "/root/repo/src/interpreter_builtins_io.cpp" "CMakeFiles/awk_lib.dir/src/interpreter_builtins_io.cpp.o" "gcc" "CMakeFiles/awk_lib.dir/src/interpreter_builtins_io.cpp.o.d"
+  "/root/repo/src/interpreter_builtins_math.cpp" "CMakeFiles/awk_lib.dir/src/interpreter_builtins_math.cpp.o" "gcc" "CMakeFiles/awk_lib.dir/src/interpreter_builtins_math.cpp.o.d"
+  "/root/repo/src/interpreter_builtins_misc.cpp" "CMakeFiles/awk_lib.dir/src/interpreter_builtins_misc.cpp.o" "gcc" "CMakeFiles/awk_lib.dir/src/interpreter_builtins_misc.cpp.o.d"
+  "/root/repo/src/interpreter_builtins_string.cpp" "CMakeFiles/awk_lib.dir/src/interpreter_builtins_string.cpp.o" "gcc" "CMakeFiles/awk_lib.dir/src/interpreter_builtins_string.cpp.o.d"
+  "/root/repo/src/interpreter_coprocess.cpp" "CMakeFiles/awk_lib.dir/src/interpreter_coprocess.cpp.o" "gcc" "CMakeFiles/awk_lib.dir/src/interpreter_coprocess.cpp.o.d"
+  "/root/repo/src/interpreter_eval.cpp" "CMakeFiles/awk_lib.dir/src/interpreter_eval.cpp.o" "gcc" "CMakeFiles/awk_lib.dir/src/interpreter_eval.cpp.o.d"
+  "/root/repo/src/interpreter_exec.cpp" "CMakeFiles/awk_lib.dir/src/interpreter_exec.cpp.o" "gcc" "CMakeFiles/awk_lib.dir/src/interpreter_exec.cpp.o.d"
+  "/root/repo/src/interpreter_getline.cpp" "CMakeFiles/awk_lib.dir/src/interpreter_getline.cpp.o" "gcc" "CMakeFiles/awk_lib.dir/src/interpreter_getline.cpp.o.d"
+  "/root/repo/src/interpreter_vm.cpp" "CMakeFiles/awk_lib.dir/src/interpreter_vm.cpp.o" "gcc" "CMakeFiles/awk_lib.dir/src/interpreter_vm.cpp.o.d"
+  "/root/repo/src/lexer.cpp" "CMakeFiles/awk_lib.dir/src/lexer.cpp.o" "gcc" "CMakeFiles/awk_lib.dir/src/lexer.cpp.o.d"
+  "/root/repo/src/parser.cpp" "CMakeFiles/awk_lib.dir/src/parser.cpp.o" "gcc" "CMakeFiles/awk_lib.dir/src/parser.cpp.o.d"
+  "/root/repo/src/record_reader.cpp" "CMakeFiles/awk_lib.dir/src/record_reader.cpp.o" "gcc" "CMakeFiles/awk_lib.dir/src/record_reader.cpp.o.d"
+  "/root/repo/src/regex_cache.cpp" "CMakeFiles/awk_lib.dir/src/regex_cache.cpp.o" "gcc" "CMakeFiles/awk_lib.dir/src/regex_cache.cpp.o.d"
+  "/root/repo/src/resolver.cpp" "CMakeFiles/awk_lib.dir/src/resolver.cpp.o" "gcc" "CMakeFiles/awk_lib.dir/src/resolver.cpp.o.d"
+  "/root/repo/src/simd_scan.cpp" "CMakeFiles/awk_lib.dir/src/simd_scan.cpp.o" "gcc" "CMakeFiles/awk_lib.dir/src/simd_scan.cpp.o.d"
+  "/root/repo/src/space_invaders.cpp" "CMakeFiles/awk_lib.dir/src/space_invaders.cpp.o" "gcc" "CMakeFiles/awk_lib.dir/src/space_invaders.cpp.o.d"
+  "/root/repo/src/value.cpp" "CMakeFiles/awk_lib.dir/src/value.cpp.o" "gcc" "CMakeFiles/awk_lib.dir/src/value.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,53 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/awk_lib.dir/src/array.cpp.o"
+  "CMakeFiles/awk_lib.dir/src/array.cpp.o.d"
+  "CMakeFiles/awk_lib.dir/src/compiler.cpp.o"
+  "CMakeFiles/awk_lib.dir/src/compiler.cpp.o.d"
+  "CMakeFiles/awk_lib.dir/src/environment.cpp.o"
+  "CMakeFiles/awk_lib.dir/src/environment.cpp.o.d"
+  "CMakeFiles/awk_lib.dir/src/i18n.cpp.o"
+  "CMakeFiles/awk_lib.dir/src/i18n.cpp.o.d"
+  "CMakeFiles/awk_lib.dir/src/interpreter.cpp.o"
+  "CMakeFiles/awk_lib.dir/src/interpreter.cpp.o.d"
+  "CMakeFiles/awk_lib.dir/src/interpreter_builtins_io.cpp.o"
+  "CMakeFiles/awk_lib.dir/src/interpreter_builtins_io.cpp.o.d"
+  "CMakeFiles/awk_lib.dir/src/interpreter_builtins_math.cpp.o"
+  "CMakeFiles/awk_lib.dir/src/interpreter_builtins_math.cpp.o.d"
+  "CMakeFiles/awk_lib.dir/src/interpreter_builtins_misc.cpp.o"
+  "CMakeFiles/awk_lib.dir/src/interpreter_builtins_misc.cpp.o.d"
+  "CMakeFiles/awk_lib.dir/src/interpreter_builtins_string.cpp.o"
+  "CMakeFiles/awk_lib.dir/src/interpreter_builtins_string.cpp.o.d"
+  "CMakeFiles/awk_lib.dir/src/interpreter_coprocess.cpp.o"
+  "CMakeFiles/awk_lib.dir/src/interpreter_coprocess.cpp.o.d"
+  "CMakeFiles/awk_lib.dir/src/interpreter_eval.cpp.o"
+  "CMakeFiles/awk_lib.dir/src/interpreter_eval.cpp.o.d"
+  "CMakeFiles/awk_lib.dir/src/interpreter_exec.cpp.o"
+  "CMakeFiles/awk_lib.dir/src/interpreter_exec.cpp.o.d"
+  "CMakeFiles/awk_lib.dir/src/interpreter_getline.cpp.o"
+  "CMakeFiles/awk_lib.dir/src/interpreter_getline.cpp.o.d"
+  "CMakeFiles/awk_lib.dir/src/interpreter_vm.cpp.o"
+  "CMakeFiles/awk_lib.dir/src/interpreter_vm.cpp.o.d"
+  "CMakeFiles/awk_lib.dir/src/lexer.cpp.o"
+  "CMakeFiles/awk_lib.dir/src/lexer.cpp.o.d"
+  "CMakeFiles/awk_lib.dir/src/parser.cpp.o"
+  "CMakeFiles/awk_lib.dir/src/parser.cpp.o.d"
+  "CMakeFiles/awk_lib.dir/src/record_reader.cpp.o"
+  "CMakeFiles/awk_lib.dir/src/record_reader.cpp.o.d"
+  "CMakeFiles/awk_lib.dir/src/regex_cache.cpp.o"
+  "CMakeFiles/awk_lib.dir/src/regex_cache.cpp.o.d"
+  "CMakeFiles/awk_lib.dir/src/resolver.cpp.o"
+  "CMakeFiles/awk_lib.dir/src/resolver.cpp.o.d"
+  "CMakeFiles/awk_lib.dir/src/simd_scan.cpp.o"
+  "CMakeFiles/awk_lib.dir/src/simd_scan.cpp.o.d"
+  "CMakeFiles/awk_lib.dir/src/space_invaders.cpp.o"
+  "CMakeFiles/awk_lib.dir/src/space_invaders.cpp.o.d"
+  "CMakeFiles/awk_lib.dir/src/value.cpp.o"
+  "CMakeFiles/awk_lib.dir/src/value.cpp.o.d"
+  "Release/libawk.a"
+  "Release/libawk.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/awk_lib.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
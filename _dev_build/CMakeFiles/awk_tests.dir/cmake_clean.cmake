@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/awk_tests.dir/tests/main.cpp.o"
+  "CMakeFiles/awk_tests.dir/tests/main.cpp.o.d"
+  "Release/awk_tests"
+  "Release/awk_tests.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/awk_tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,10 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo
+# Build directory: /root/repo/_dev_build
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+add_test(awk_unit_tests "/root/repo/_dev_build/Release/awk_tests")
+set_tests_properties(awk_unit_tests PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;160;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(awk_integration_tests "/root/.pyenv/shims/python3" "/root/repo/scripts/run_integration_tests.py")
+set_tests_properties(awk_integration_tests PROPERTIES  WORKING_DIRECTORY "/root/repo" _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;165;add_test;/root/repo/CMakeLists.txt;0;")
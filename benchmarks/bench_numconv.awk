@@ -0,0 +1,24 @@
+# Benchmark: number <-> string conversion
+# Tests: numconv kernels (integer and %.6g formatting, field parsing)
+# Usage: awk -f bench_numconv.awk test_data.csv (or BEGIN-only without input)
+BEGIN {
+    FS = ","
+    # Integers and fractions converted to strings
+    for (i = 1; i <= 200000; i++) {
+        a = i * 7
+        b = i / 7
+        s = s a " " b
+        if (length(s) > 4096) s = ""
+    }
+    # Numeric subscripts
+    for (i = 1; i <= 200000; i++) {
+        k[i % 1000 + 0.25] = i
+        t = (i * 0.01) ""
+    }
+    print length(s), length(k), t
+}
+{
+    # Every field parsed as a number
+    for (f = 1; f <= NF; f++) sum += $f
+}
+END { printf "%d fields, sum %.6g\n", NR * NF, sum }
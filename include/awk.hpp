@@ -9,7 +9,11 @@
 #include "awk/ast.hpp"
 #include "awk/parser.hpp"
 #include "awk/value.hpp"
+#include "awk/array.hpp"
 #include "awk/environment.hpp"
+#include "awk/bytecode.hpp"
+#include "awk/resolver.hpp"
+#include "awk/record_reader.hpp"
 #include "awk/interpreter.hpp"
 
 namespace awk {
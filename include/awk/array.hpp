@@ -0,0 +1,245 @@
+#ifndef AWK_ARRAY_HPP
+#define AWK_ARRAY_HPP
+
+#include "value.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace awk {
+
+// ============================================================================
+// AWKArray - insertion-ordered open-addressing hash table
+// ============================================================================
+//
+// Elements live in a vector in insertion order, so iteration (for-in,
+// array_keys) walks memory linearly. An index table maps hashes to positions
+// in that vector using SwissTable-style open addressing: one control byte
+// per slot holds 7 bits of the hash (or EMPTY/DELETED), and probing tests 8
+// control bytes at once with word-wide bit tricks before touching an entry.
+//
+// An entry is one cache line: the key (std::string, whose small-string
+// buffer keeps keys of up to 15 characters inline), the value and the
+// cached hash, which also makes growing the table free of rehashing keys.
+// Deleted entries stay in the vector as tombstones until the table is
+// rebuilt, keeping the order of the others.
+//
+// Arrays whose keys are exactly "1".."n" (split(), asort(), a[i] filled by
+// a counting loop) skip all of that: element i is dense_[i - 1], with no
+// key strings or hashes. Appending n + 1 or deleting n keeps the array
+// dense; any other key converts it to the hash table until clear().
+//
+// References to values stay valid until the next insertion or clear().
+// for-in walks the storage itself through an ArrayCursor (below).
+
+// ============================================================================
+// TupleKey - the subscripts of a[i, j, ...]
+// ============================================================================
+//
+// The key of a[i, j] is i SUBSEP j. A TupleKey holds views of the parts
+// instead: the table hashes and compares it piece by piece, with the same
+// result as for the joined string, and joins it only when a new element is
+// inserted. Strings are viewed in place; numbers are formatted into the
+// key's own scratch space.
+class TupleKey {
+public:
+    static constexpr size_t MAX_PARTS = 8;  // More subscripts: join them
+
+    TupleKey(const AWKValue* values, size_t count, std::string_view subsep);
+
+    TupleKey(const TupleKey&) = delete;
+    TupleKey& operator=(const TupleKey&) = delete;
+
+    // Length of the joined key
+    size_t size() const;
+
+    // The joined key
+    std::string join() const;
+
+    // True if key is the joined key
+    bool equals(std::string_view key) const;
+
+    size_t count() const { return count_; }
+    std::string_view part(size_t i) const { return parts_[i]; }
+    std::string_view subsep() const { return subsep_; }
+
+private:
+    std::string_view parts_[MAX_PARTS];
+    std::string scratch_[MAX_PARTS];
+    size_t count_;
+    std::string_view subsep_;
+};
+
+class AWKArray {
+public:
+    AWKArray() = default;
+
+    // Element lookup; nullptr if absent
+    AWKValue* find(std::string_view key);
+    const AWKValue* find(std::string_view key) const;
+    bool contains(std::string_view key) const { return find(key) != nullptr; }
+
+    // Element, inserted uninitialized if absent
+    AWKValue& operator[](std::string_view key);
+
+    // Same element as the key std::to_string(index), without building the
+    // key while the array is dense
+    AWKValue* find(long long index);
+    AWKValue& operator[](long long index);
+
+    // Same element as the key key.join()
+    AWKValue* find(const TupleKey& key);
+    AWKValue& operator[](const TupleKey& key);
+    size_t erase(const TupleKey& key);
+
+    // Element that must exist (throws std::out_of_range)
+    const AWKValue& at(std::string_view key) const;
+
+    // Removes an element; returns the number removed (0 or 1)
+    size_t erase(std::string_view key);
+
+    void clear();
+    void reserve(size_t count);
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    bool dense() const { return !hashed_; }
+
+    // Calls fn(std::string_view key, AWKValue& value) for every element in
+    // insertion order. fn must not insert or delete elements.
+    template <typename Fn>
+    void for_each(Fn&& fn);
+    template <typename Fn>
+    void for_each(Fn&& fn) const;
+
+    // Hash of a key (fast, non-cryptographic); a TupleKey hashes like its
+    // joined key
+    static uint32_t hash(std::string_view key);
+    static uint32_t hash(const TupleKey& key);
+
+    // Index of a key in canonical integer form ("1", "42"; not "01", "+1"
+    // or "1.0"), or 0 if it is not a positive integer
+    static long long parse_index(std::string_view key);
+
+private:
+    friend class ArrayCursor;
+
+    struct Entry {
+        std::string key;
+        AWKValue value;
+        uint32_t hash;
+        bool erased;
+    };
+
+    static constexpr size_t GROUP_SIZE = 8;        // Control bytes probed at once
+    static constexpr size_t MIN_CAPACITY = 16;
+    static constexpr uint8_t EMPTY = 0x80;
+    static constexpr uint8_t DELETED = 0xFE;        // Full slots hold 7 hash bits
+    static constexpr size_t NOT_FOUND = ~size_t(0);
+
+    bool hashed_ = false;          // Elements are in entries_, not dense_
+    std::vector<AWKValue> dense_;  // Elements 1..n while !hashed_
+
+    std::vector<Entry> entries_;   // Insertion order, including tombstones
+    std::vector<uint8_t> control_; // One byte per slot
+    std::vector<uint32_t> slots_;  // Entry index of each full slot
+    size_t size_ = 0;              // Live entries
+    size_t erased_ = 0;            // Tombstones in entries_
+    size_t growth_left_ = 0;       // Insertions into EMPTY slots before a rebuild
+    size_t cursors_ = 0;           // Open ArrayCursors; tombstones stay while > 0
+    size_t generation_ = 0;        // Incremented by clear()
+
+    // Slot holding key (std::string_view or TupleKey), or NOT_FOUND
+    template <typename Key>
+    size_t find_slot(const Key& key, uint32_t hash) const;
+
+    // First EMPTY or DELETED slot on the probe sequence of hash
+    size_t find_free_slot(uint32_t hash) const;
+
+    // Rebuilds the index with room for at least count live entries,
+    // dropping tombstones from entries_ unless a cursor is open
+    void rehash(size_t count);
+
+    // Moves dense elements into the hash table
+    void convert_to_hashed();
+
+    // Element of key in the hash table, inserted if absent
+    template <typename Key>
+    AWKValue& insert_hashed(const Key& key);
+
+    // Erases the element in slot
+    void erase_slot(size_t slot);
+
+    // Decimal form of index into buffer (at least 20 bytes)
+    static std::string_view format_index(long long index, char* buffer);
+};
+
+// ============================================================================
+// ArrayCursor - for (k in a) without copying the keys
+// ============================================================================
+//
+// A cursor is a position in the array's own storage (the dense vector or
+// the entry vector), so starting a loop costs nothing however large the
+// array is. While a cursor is open the array keeps erased entries as
+// tombstones, which keeps positions stable when the loop body deletes or
+// inserts: deleted elements not yet reached are skipped, elements inserted
+// during the loop are not visited, and clearing the array ends the loop.
+// The cursor shares the array (like a copy of its AWKValue), so the array
+// outlives it.
+class ArrayCursor {
+public:
+    ArrayCursor() = default;
+
+    // Cursor before the first element; iterates nothing if array is not an
+    // array
+    explicit ArrayCursor(AWKValue& array);
+
+    ArrayCursor(ArrayCursor&& other) noexcept;
+    ArrayCursor& operator=(ArrayCursor&& other) noexcept;
+    ArrayCursor(const ArrayCursor&) = delete;
+    ArrayCursor& operator=(const ArrayCursor&) = delete;
+    ~ArrayCursor();
+
+    // Advances to the next element and sets key to its key (valid until the
+    // next call, or until the cursor is moved); false at the end
+    bool next(std::string_view& key);
+
+private:
+    AWKValue array_;              // Keeps the array alive
+    AWKArray* table_ = nullptr;   // array_'s table; nullptr once finished
+    size_t position_ = 0;         // Next dense or entry index
+    size_t end_ = 0;              // Storage size when the loop started
+    size_t generation_ = 0;
+    char buffer_[24];             // Key of a dense element
+
+    void close();
+};
+
+template <typename Fn>
+void AWKArray::for_each(Fn&& fn) {
+    if (!hashed_) {
+        char buffer[24];
+        for (size_t i = 0; i < dense_.size(); ++i) {
+            fn(format_index(static_cast<long long>(i + 1), buffer), dense_[i]);
+        }
+        return;
+    }
+    for (Entry& entry : entries_) {
+        if (!entry.erased) {
+            fn(std::string_view(entry.key), entry.value);
+        }
+    }
+}
+
+template <typename Fn>
+void AWKArray::for_each(Fn&& fn) const {
+    const_cast<AWKArray*>(this)->for_each([&fn](std::string_view key, const AWKValue& value) {
+        fn(key, value);
+    });
+}
+
+} // namespace awk
+
+#endif // AWK_ARRAY_HPP
@@ -2,6 +2,7 @@
 #define AWK_AST_HPP
 
 #include "token.hpp"
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <string>
@@ -12,20 +13,61 @@ namespace awk {
 // Forward declarations
 struct Expr;
 struct Stmt;
+class FormatProgram;  // format_program.hpp
+class Regex;          // regex.hpp
 
 // Unique pointer aliases
 using ExprPtr = std::unique_ptr<Expr>;
 using StmtPtr = std::unique_ptr<Stmt>;
 
+// ============================================================================
+// Variable Resolution
+// ============================================================================
+
+// Storage location of a named variable or array, filled in by the Resolver
+// before execution. Unresolved references fall back to lookup by name.
+struct VarRef {
+    enum class Scope : unsigned char {
+        UNRESOLVED,
+        GLOBAL,  // index = slot in Environment's global table
+        LOCAL    // index = parameter position in the current function
+    };
+
+    Scope scope = Scope::UNRESOLVED;
+    uint32_t index = 0;
+};
+
 // ============================================================================
 // Expressions
 // ============================================================================
 
+// Node kind tags - used for switch-based dispatch instead of dynamic_cast chains
+enum class ExprKind : unsigned char {
+    LITERAL,
+    REGEX,
+    VARIABLE,
+    FIELD,
+    ARRAY_ACCESS,
+    BINARY,
+    UNARY,
+    TERNARY,
+    ASSIGN,
+    CALL,
+    INDIRECT_CALL,
+    MATCH,
+    CONCAT,
+    GETLINE,
+    IN,
+    UPDATE
+};
+
 // Base struct for all expressions
 struct Expr {
+    const ExprKind kind;
     size_t line = 0;
     size_t column = 0;
 
+    explicit Expr(ExprKind k) : kind(k) {}
     virtual ~Expr() = default;
 
     // Visitor pattern support
@@ -37,8 +79,8 @@ struct Expr {
 struct LiteralExpr : Expr {
     std::variant<double, std::string> value;
 
-    explicit LiteralExpr(double num) : value(num) {}
-    explicit LiteralExpr(std::string str) : value(std::move(str)) {}
+    explicit LiteralExpr(double num) : Expr(ExprKind::LITERAL), value(num) {}
+    explicit LiteralExpr(std::string str) : Expr(ExprKind::LITERAL), value(std::move(str)) {}
 
     bool is_number() const { return std::holds_alternative<double>(value); }
     bool is_string() const { return std::holds_alternative<std::string>(value); }
@@ -51,30 +93,37 @@ struct LiteralExpr : Expr {
 struct RegexExpr : Expr {
     std::string pattern;
 
-    explicit RegexExpr(std::string pat) : pattern(std::move(pat)) {}
+    // Compiled matcher, built by the interpreter on first use and rebuilt
+    // only when the regex flags (IGNORECASE) change
+    std::shared_ptr<Regex> compiled;
+    unsigned compiled_flags = 0;
+
+    explicit RegexExpr(std::string pat) : Expr(ExprKind::REGEX), pattern(std::move(pat)) {}
 };
 
 // Variable
 struct VariableExpr : Expr {
     std::string name;
+    VarRef ref;
 
-    explicit VariableExpr(std::string n) : name(std::move(n)) {}
+    explicit VariableExpr(std::string n) : Expr(ExprKind::VARIABLE), name(std::move(n)) {}
 };
 
 // Field access ($0, $1, $NF, $(expr))
 struct FieldExpr : Expr {
     ExprPtr index;
 
-    explicit FieldExpr(ExprPtr idx) : index(std::move(idx)) {}
+    explicit FieldExpr(ExprPtr idx) : Expr(ExprKind::FIELD), index(std::move(idx)) {}
 };
 
 // Array access (arr[key] or arr[k1, k2, ...])
 struct ArrayAccessExpr : Expr {
     std::string name;
     std::vector<ExprPtr> indices;
+    VarRef ref;
 
     ArrayAccessExpr(std::string n, std::vector<ExprPtr> idx)
-        : name(std::move(n)), indices(std::move(idx)) {}
+        : Expr(ExprKind::ARRAY_ACCESS), name(std::move(n)), indices(std::move(idx)) {}
 };
 
 // Binary expression
@@ -84,7 +133,7 @@ struct BinaryExpr : Expr {
     ExprPtr right;
 
     BinaryExpr(ExprPtr l, TokenType o, ExprPtr r)
-        : left(std::move(l)), op(o), right(std::move(r)) {}
+        : Expr(ExprKind::BINARY), left(std::move(l)), op(o), right(std::move(r)) {}
 };
 
 // Unary expression (!, -, +, ++, --)
@@ -94,7 +143,7 @@ struct UnaryExpr : Expr {
     bool prefix;  // true for ++x, false for x++
 
     UnaryExpr(TokenType o, ExprPtr expr, bool pre = true)
-        : op(o), operand(std::move(expr)), prefix(pre) {}
+        : Expr(ExprKind::UNARY), op(o), operand(std::move(expr)), prefix(pre) {}
 };
 
 // Ternary expression (cond ? then : else)
@@ -104,7 +153,8 @@ struct TernaryExpr : Expr {
     ExprPtr else_expr;
 
     TernaryExpr(ExprPtr cond, ExprPtr then_e, ExprPtr else_e)
-        : condition(std::move(cond))
+        : Expr(ExprKind::TERNARY)
+        , condition(std::move(cond))
         , then_expr(std::move(then_e))
         , else_expr(std::move(else_e)) {}
 };
@@ -116,7 +166,7 @@ struct AssignExpr : Expr {
     ExprPtr value;
 
     AssignExpr(ExprPtr tgt, TokenType o, ExprPtr val)
-        : target(std::move(tgt)), op(o), value(std::move(val)) {}
+        : Expr(ExprKind::ASSIGN), target(std::move(tgt)), op(o), value(std::move(val)) {}
 };
 
 // Function call
@@ -125,7 +175,7 @@ struct CallExpr : Expr {
     std::vector<ExprPtr> arguments;
 
     CallExpr(std::string name, std::vector<ExprPtr> args)
-        : function_name(std::move(name)), arguments(std::move(args)) {}
+        : Expr(ExprKind::CALL), function_name(std::move(name)), arguments(std::move(args)) {}
 };
 
 // Indirect function call (gawk extension: @varname(args))
@@ -134,7 +184,7 @@ struct IndirectCallExpr : Expr {
     std::vector<ExprPtr> arguments;
 
     IndirectCallExpr(ExprPtr name_expr, std::vector<ExprPtr> args)
-        : func_name_expr(std::move(name_expr)), arguments(std::move(args)) {}
+        : Expr(ExprKind::INDIRECT_CALL), func_name_expr(std::move(name_expr)), arguments(std::move(args)) {}
 };
 
 // Regex match (str ~ /regex/ or str !~ /regex/)
@@ -144,14 +194,14 @@ struct MatchExpr : Expr {
     bool negated;   // true for !~
 
     MatchExpr(ExprPtr str, ExprPtr re, bool neg = false)
-        : string(std::move(str)), regex(std::move(re)), negated(neg) {}
+        : Expr(ExprKind::MATCH), string(std::move(str)), regex(std::move(re)), negated(neg) {}
 };
 
 // String concatenation (implicit by adjacency)
 struct ConcatExpr : Expr {
     std::vector<ExprPtr> parts;
 
-    explicit ConcatExpr(std::vector<ExprPtr> p) : parts(std::move(p)) {}
+    explicit ConcatExpr(std::vector<ExprPtr> p) : Expr(ExprKind::CONCAT), parts(std::move(p)) {}
 };
 
 // Getline expression
@@ -162,7 +212,8 @@ struct GetlineExpr : Expr {
     bool coprocess;    // |&
 
     GetlineExpr()
-        : variable(nullptr)
+        : Expr(ExprKind::GETLINE)
+        , variable(nullptr)
         , file(nullptr)
         , command(nullptr)
         , coprocess(false) {}
@@ -172,20 +223,58 @@ struct GetlineExpr : Expr {
 struct InExpr : Expr {
     std::vector<ExprPtr> keys;  // Kann mehrere Keys haben (k1, k2) in arr
     std::string array_name;
+    VarRef array_ref;
 
     InExpr(std::vector<ExprPtr> k, std::string arr)
-        : keys(std::move(k)), array_name(std::move(arr)) {}
+        : Expr(ExprKind::IN), keys(std::move(k)), array_name(std::move(arr)) {}
+};
+
+// Numeric update of a variable or array element in place: ++x, x--,
+// a[k] += e, x = x - e. The parser builds it instead of a UnaryExpr or
+// AssignExpr when the target is a plain variable or element, so counters
+// look the target up once and store a number without AWKValue temporaries.
+struct UpdateExpr : Expr {
+    ExprPtr target;  // VariableExpr or ArrayAccessExpr
+    TokenType op;    // PLUS, MINUS, STAR, SLASH, PERCENT or CARET
+    ExprPtr value;   // nullptr for ++ and -- (operand 1)
+    bool postfix;    // Result is the number before the update (x++)
+
+    UpdateExpr(ExprPtr tgt, TokenType o, ExprPtr val, bool post = false)
+        : Expr(ExprKind::UPDATE), target(std::move(tgt)), op(o), value(std::move(val)), postfix(post) {}
 };
 
 // ============================================================================
 // Statements
 // ============================================================================
 
+// Node kind tags for statements
+enum class StmtKind : unsigned char {
+    EXPR,
+    PRINT,
+    PRINTF,
+    BLOCK,
+    IF,
+    WHILE,
+    DO_WHILE,
+    FOR,
+    FOR_IN,
+    SWITCH,
+    BREAK,
+    CONTINUE,
+    NEXT,
+    NEXTFILE,
+    EXIT,
+    RETURN,
+    DELETE
+};
+
 // Base struct for all statements
 struct Stmt {
+    const StmtKind kind;
     size_t line = 0;
     size_t column = 0;
 
+    explicit Stmt(StmtKind k) : kind(k) {}
     virtual ~Stmt() = default;
 
     template<typename R, typename Visitor>
@@ -196,7 +285,7 @@ struct Stmt {
 struct ExprStmt : Stmt {
     ExprPtr expression;
 
-    explicit ExprStmt(ExprPtr expr) : expression(std::move(expr)) {}
+    explicit ExprStmt(ExprPtr expr) : Stmt(StmtKind::EXPR), expression(std::move(expr)) {}
 };
 
 // Redirect type for print/printf
@@ -214,8 +303,8 @@ struct PrintStmt : Stmt {
     ExprPtr output_redirect;
     RedirectType redirect_type = RedirectType::NONE;
 
-    PrintStmt() = default;
-    explicit PrintStmt(std::vector<ExprPtr> args) : arguments(std::move(args)) {}
+    PrintStmt() : Stmt(StmtKind::PRINT) {}
+    explicit PrintStmt(std::vector<ExprPtr> args) : Stmt(StmtKind::PRINT), arguments(std::move(args)) {}
 };
 
 // Printf Statement
@@ -225,15 +314,19 @@ struct PrintfStmt : Stmt {
     ExprPtr output_redirect;
     RedirectType redirect_type = RedirectType::NONE;
 
-    explicit PrintfStmt(ExprPtr fmt) : format(std::move(fmt)) {}
+    // Compiled format, built by the interpreter on first use when the
+    // format is a string literal
+    std::shared_ptr<const FormatProgram> compiled_format;
+
+    explicit PrintfStmt(ExprPtr fmt) : Stmt(StmtKind::PRINTF), format(std::move(fmt)) {}
 };
 
 // Block Statement
 struct BlockStmt : Stmt {
     std::vector<StmtPtr> statements;
 
-    BlockStmt() = default;
-    explicit BlockStmt(std::vector<StmtPtr> stmts) : statements(std::move(stmts)) {}
+    BlockStmt() : Stmt(StmtKind::BLOCK) {}
+    explicit BlockStmt(std::vector<StmtPtr> stmts) : Stmt(StmtKind::BLOCK), statements(std::move(stmts)) {}
 };
 
 // If Statement
@@ -243,7 +336,8 @@ struct IfStmt : Stmt {
     StmtPtr else_branch;  // Optional
 
     IfStmt(ExprPtr cond, StmtPtr then_b, StmtPtr else_b = nullptr)
-        : condition(std::move(cond))
+        : Stmt(StmtKind::IF)
+        , condition(std::move(cond))
         , then_branch(std::move(then_b))
         , else_branch(std::move(else_b)) {}
 };
@@ -254,7 +348,7 @@ struct WhileStmt : Stmt {
     StmtPtr body;
 
     WhileStmt(ExprPtr cond, StmtPtr b)
-        : condition(std::move(cond)), body(std::move(b)) {}
+        : Stmt(StmtKind::WHILE), condition(std::move(cond)), body(std::move(b)) {}
 };
 
 // Do-While Statement
@@ -263,7 +357,7 @@ struct DoWhileStmt : Stmt {
     ExprPtr condition;
 
     DoWhileStmt(StmtPtr b, ExprPtr cond)
-        : body(std::move(b)), condition(std::move(cond)) {}
+        : Stmt(StmtKind::DO_WHILE), body(std::move(b)), condition(std::move(cond)) {}
 };
 
 // For Statement (C-style)
@@ -274,7 +368,8 @@ struct ForStmt : Stmt {
     StmtPtr body;
 
     ForStmt(StmtPtr i, ExprPtr c, ExprPtr u, StmtPtr b)
-        : init(std::move(i))
+        : Stmt(StmtKind::FOR)
+        , init(std::move(i))
         , condition(std::move(c))
         , update(std::move(u))
         , body(std::move(b)) {}
@@ -285,9 +380,12 @@ struct ForInStmt : Stmt {
     std::string variable;
     std::string array_name;
     StmtPtr body;
+    VarRef variable_ref;
+    VarRef array_ref;
 
     ForInStmt(std::string var, std::string arr, StmtPtr b)
-        : variable(std::move(var))
+        : Stmt(StmtKind::FOR_IN)
+        , variable(std::move(var))
         , array_name(std::move(arr))
         , body(std::move(b)) {}
 };
@@ -299,36 +397,45 @@ struct SwitchStmt : Stmt {
     StmtPtr default_case;  // Optional
 
     explicit SwitchStmt(ExprPtr expr)
-        : expression(std::move(expr)), default_case(nullptr) {}
+        : Stmt(StmtKind::SWITCH), expression(std::move(expr)), default_case(nullptr) {}
 };
 
 // Control flow statements
-struct BreakStmt : Stmt {};
-struct ContinueStmt : Stmt {};
-struct NextStmt : Stmt {};
-struct NextfileStmt : Stmt {};
+struct BreakStmt : Stmt {
+    BreakStmt() : Stmt(StmtKind::BREAK) {}
+};
+struct ContinueStmt : Stmt {
+    ContinueStmt() : Stmt(StmtKind::CONTINUE) {}
+};
+struct NextStmt : Stmt {
+    NextStmt() : Stmt(StmtKind::NEXT) {}
+};
+struct NextfileStmt : Stmt {
+    NextfileStmt() : Stmt(StmtKind::NEXTFILE) {}
+};
 
 struct ExitStmt : Stmt {
     ExprPtr status;  // Optional
 
-    ExitStmt() : status(nullptr) {}
-    explicit ExitStmt(ExprPtr s) : status(std::move(s)) {}
+    ExitStmt() : Stmt(StmtKind::EXIT), status(nullptr) {}
+    explicit ExitStmt(ExprPtr s) : Stmt(StmtKind::EXIT), status(std::move(s)) {}
 };
 
 struct ReturnStmt : Stmt {
     ExprPtr value;  // Optional
 
-    ReturnStmt() : value(nullptr) {}
-    explicit ReturnStmt(ExprPtr v) : value(std::move(v)) {}
+    ReturnStmt() : Stmt(StmtKind::RETURN), value(nullptr) {}
+    explicit ReturnStmt(ExprPtr v) : Stmt(StmtKind::RETURN), value(std::move(v)) {}
 };
 
 // Delete Statement
 struct DeleteStmt : Stmt {
     std::string array_name;
     std::vector<ExprPtr> indices;  // Empty = delete entire array
+    VarRef array_ref;
 
     DeleteStmt(std::string arr, std::vector<ExprPtr> idx)
-        : array_name(std::move(arr)), indices(std::move(idx)) {}
+        : Stmt(StmtKind::DELETE), array_name(std::move(arr)), indices(std::move(idx)) {}
 };
 
 // ============================================================================
@@ -0,0 +1,229 @@
+#ifndef AWK_BYTECODE_HPP
+#define AWK_BYTECODE_HPP
+
+#include "ast.hpp"
+#include "value.hpp"
+#include "array.hpp"
+#include "environment.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace awk {
+
+// ============================================================================
+// Instruction Set
+// ============================================================================
+//
+// The VM is a stack machine: instructions pop their operands from the value
+// stack and push their result. Stack layouts are noted as [inputs] -> [outputs]
+// with the top of the stack on the right.
+
+enum class OpCode : unsigned char {
+    // Constants and stack manipulation
+    PUSH_CONST,      // a: constant index                 [] -> [value]
+    PUSH_UNINIT,     //                                   [] -> [uninitialized]
+    POP,             //                                   [x] -> []
+    DUP,             //                                   [x] -> [x, x]
+
+    // Variables (a: variable index)
+    LOAD_VAR,        //                                   [] -> [value]
+    STORE_VAR,       //                                   [value] -> [value]
+    APPEND_VAR,      // var = var part ... optimization   [part] -> []
+    INCR_VAR,        // b: IncrFlags                      [] -> [result]
+    AUG_VAR,         // b: arithmetic OpCode              [value] -> [result]
+
+    // Fields
+    LOAD_FIELD,      //                                   [index] -> [field]
+    STORE_FIELD,     //                                   [value, index] -> [field]
+    INCR_FIELD,      // b: IncrFlags                      [index] -> [result]
+    AUG_FIELD,       // b: arithmetic OpCode              [value, index] -> [result]
+
+    // Arrays (a: variable index, low 16 bits of b: number of subscripts)
+    LOAD_ELEM,       //                                   [keys...] -> [element]
+    STORE_ELEM,      //                                   [value, keys...] -> [value]
+    INCR_ELEM,       // b >> 16: IncrFlags                [keys...] -> [result]
+    AUG_ELEM,        // b >> 16: arithmetic OpCode        [value, keys...] -> [result]
+    IN_ARRAY,        //                                   [keys...] -> [0|1]
+    DELETE_ELEM,     //                                   [keys...] -> []
+    DELETE_ARRAY,    //                                   [] -> []
+
+    // Arithmetic                                         [l, r] -> [result]
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    MOD,
+    POW,
+    NEG,             //                                   [x] -> [-x]
+    PLUS,            //                                   [x] -> [+x]
+    NOT,             //                                   [x] -> [!x]
+
+    // Comparison                                         [l, r] -> [0|1]
+    EQ,
+    NE,
+    LT,
+    GT,
+    LE,
+    GE,
+
+    // Strings and regular expressions
+    CONCAT,          // a: number of parts                [parts...] -> [string]
+    MATCH,           //                                   [text, pattern] -> [0|1]
+    NOT_MATCH,
+    MATCH_REGEX,     // a: regex literal, b: 1 if negated [text] -> [0|1]
+    MATCH_RECORD,    // a: regex literal                  [] -> [0|1]
+
+    // Control flow (a: target instruction)
+    JUMP,
+    JUMP_IF_FALSE,   //                                   [cond] -> []
+    JUMP_IF_TRUE,    //                                   [cond] -> []
+
+    // Calls (b: argument count)
+    // Calls (low 16 bits of b: number of arguments; for user functions,
+    // b >> 16 is 1 + an index into Chunk::call_args, or 0)
+    CALL_BUILTIN,    // a: builtin index                  [args...] -> [result]
+    CALL_USER,       // a: function index                 [args...] -> [result]
+    CALL_NAMED,      // a: name index, resolved per call  [args...] -> [result]
+    EVAL_EXPR,       // a: expression delegated to the tree walker
+    EXEC_STMT,       // a: statement delegated to the tree walker
+
+    // Statements
+    PRINT,           // a: argc, b: RedirectType          [target?, args...] -> []
+    PRINTF,          // a: argc incl. format, b: RedirectType
+    FORIN_BEGIN,     // a: array variable index
+    FORIN_NEXT,      // a: loop variable index, b: exit target
+    FORIN_END,       // drop the innermost for-in iterator (break)
+    NEXT,
+    NEXTFILE,
+    EXIT,            // a: 1 if the status is on the stack
+    RETURN,          // a: 1 if the return value is on the stack
+    HALT
+};
+
+// Flags for INCR_* instructions
+enum IncrFlags : int32_t {
+    INCR_DECREMENT = 1,  // -- instead of ++
+    INCR_POSTFIX = 2     // Result is the value before the update
+};
+
+struct Instruction {
+    OpCode op;
+    int32_t a = 0;
+    int32_t b = 0;
+};
+
+// Variable operand of an instruction
+struct ChunkVar {
+    std::string name;
+    VarRef ref;
+};
+
+// A compiled unit of code (rule pattern, rule action or function body)
+struct Chunk {
+    std::vector<Instruction> code;
+    std::vector<AWKValue> constants;
+    std::vector<ChunkVar> vars;
+    std::vector<std::string> names;  // Functions resolved at run time
+    std::vector<const BuiltinFunction*> builtins;
+    std::vector<RegexExpr*> regexes;  // Literals keep their compiled matcher
+    std::vector<Expr*> exprs;  // Nodes delegated to the tree walker
+    std::vector<Stmt*> stmts;
+    // Per user-function call: variable index of each argument that is a
+    // plain variable, else -1 (untyped arguments may become arrays)
+    std::vector<std::vector<int32_t>> call_args;
+
+    bool empty() const { return code.empty(); }
+};
+
+// Compiled form of a rule, parallel to Program::rules
+struct CompiledRule {
+    Chunk pattern;    // EXPRESSION, REGEX and the start of a RANGE
+    Chunk range_end;  // End of a RANGE
+    Chunk action;
+};
+
+// Compiled form of a whole program
+struct CompiledProgram {
+    std::vector<CompiledRule> rules;
+    std::vector<Chunk> functions;           // Parallel to Program::functions
+    std::vector<FunctionDef*> function_defs;
+    std::unordered_map<const FunctionDef*, size_t> function_index;
+};
+
+// Runtime state of an active for-in loop in the VM
+struct VMIterator {
+    ArrayCursor cursor;
+};
+
+// ============================================================================
+// Compiler - lowers the AST of a Program into bytecode
+// ============================================================================
+class Compiler {
+public:
+    // Built-ins are resolved against the environment at compile time
+    explicit Compiler(Environment& env);
+
+    std::unique_ptr<CompiledProgram> compile(Program& program);
+
+private:
+    // Break/continue bookkeeping for loops and switch statements
+    struct JumpContext {
+        bool is_switch = false;
+        size_t break_temps = 0;      // Stack temporaries to keep when breaking
+        size_t break_iters = 0;      // For-in iterators to keep when breaking
+        size_t continue_temps = 0;
+        size_t continue_iters = 0;
+        std::vector<size_t> break_jumps;
+        std::vector<size_t> continue_jumps;
+    };
+
+    Environment& env_;
+    CompiledProgram* program_ = nullptr;
+    Chunk* chunk_ = nullptr;
+    std::vector<JumpContext> contexts_;
+    size_t temps_ = 0;  // Switch values currently held on the stack
+    size_t iters_ = 0;  // Active for-in iterators
+
+    void compile_chunk(Chunk& chunk, Stmt* body, bool is_function);
+    void compile_pattern(Chunk& chunk, Expr* expr);
+
+    // Statements
+    void compile(Stmt& stmt);
+    void compile_print(PrintStmt& stmt);
+    void compile_printf(PrintfStmt& stmt);
+    void compile_if(IfStmt& stmt);
+    void compile_while(WhileStmt& stmt);
+    void compile_do_while(DoWhileStmt& stmt);
+    void compile_for(ForStmt& stmt);
+    void compile_for_in(ForInStmt& stmt);
+    void compile_switch(SwitchStmt& stmt);
+    void compile_break(Stmt& stmt, bool is_continue);
+    void compile_delete(DeleteStmt& stmt);
+
+    // Expressions
+    void compile(Expr& expr);
+    void compile_binary(BinaryExpr& expr);
+    void compile_unary(UnaryExpr& expr);
+    void compile_assign(AssignExpr& expr);
+    void compile_update(UpdateExpr& expr);
+    void compile_call(CallExpr& expr);
+    void compile_keys(std::vector<ExprPtr>& keys);
+
+    // Emission helpers
+    size_t emit(OpCode op, int32_t a = 0, int32_t b = 0);
+    void patch(size_t at);
+    size_t here() const { return chunk_->code.size(); }
+    int32_t add_constant(AWKValue value);
+    int32_t add_name(const std::string& name);
+    int32_t add_var(const std::string& name, const VarRef& ref);
+    int32_t add_regex(RegexExpr& regex);
+    void delegate(Expr& expr);
+    void delegate(Stmt& stmt);
+};
+
+} // namespace awk
+
+#endif // AWK_BYTECODE_HPP
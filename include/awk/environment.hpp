@@ -3,6 +3,7 @@
 
 #include "value.hpp"
 #include "ast.hpp"
+#include <deque>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -17,6 +18,31 @@ class Interpreter;
 // Type for built-in functions
 using BuiltinFunction = std::function<AWKValue(std::vector<AWKValue>&, Interpreter&)>;
 
+// Special variables live in fixed global slots, in this order
+enum SpecialVar : uint32_t {
+    VAR_FS,
+    VAR_RS,
+    VAR_OFS,
+    VAR_ORS,
+    VAR_NR,
+    VAR_NF,
+    VAR_FNR,
+    VAR_FILENAME,
+    VAR_SUBSEP,
+    VAR_CONVFMT,
+    VAR_OFMT,
+    VAR_RSTART,
+    VAR_RLENGTH,
+    VAR_ARGC,
+    VAR_ARGV,
+    VAR_ENVIRON,
+    VAR_IGNORECASE,
+    VAR_RT,
+    VAR_FPAT,
+    VAR_TEXTDOMAIN,
+    SPECIAL_VAR_COUNT
+};
+
 // Runtime environment for AWK
 class Environment {
 public:
@@ -39,107 +65,124 @@ public:
     void delete_variable(const std::string& name);
 
     // ========================================================================
-    // Scope Management for Functions
+    // Global Slots
     // ========================================================================
 
-    // Create new scope (for function calls)
-    void push_scope();
+    // Slot of a global variable (creates it if needed). Slots never move, so
+    // resolved references stay valid for the lifetime of the environment.
+    uint32_t global_slot(const std::string& name);
+
+    // Access a global variable by slot
+    AWKValue& global(uint32_t slot) { return global_slots_[slot]; }
+    const AWKValue& global(uint32_t slot) const { return global_slots_[slot]; }
+
+    // Special variables occupy slots [0, SPECIAL_VAR_COUNT)
+    static bool is_special_slot(uint32_t slot) { return slot < SPECIAL_VAR_COUNT; }
+
+    // Check if a variable is a special built-in AWK variable
+    // (used for namespace fallback lookup)
+    static bool is_special_variable(const std::string& name);
+
+    // ========================================================================
+    // Call Frames for Functions
+    // ========================================================================
 
-    // Leave scope
-    void pop_scope();
+    // Enter a function: its locals are the next parameters.size() slots of
+    // the frame stack, initialized from args (moved) or left uninitialized
+    void push_frame(const FunctionDef& func, std::vector<AWKValue>& args);
 
-    // Get local variable
-    AWKValue& get_local(const std::string& name);
+    // Leave the current function (only moves the stack pointer)
+    void pop_frame() { frame_top_ = frames_.back().base; frames_.pop_back(); }
 
-    // Set local variable
-    void set_local(const std::string& name, AWKValue value);
+    // Access a local variable of the current function by parameter index
+    AWKValue& local(uint32_t index) { return frame_values_[frames_.back().base + index]; }
 
     // Check if in a function scope
-    bool in_function_scope() const { return !scope_stack_.empty(); }
+    bool in_function_scope() const { return !frames_.empty(); }
 
     // ========================================================================
-    // Built-in Variables (Shortcuts)
+    // Built-in Variables (Shortcuts, fixed slots - no name lookup)
     // ========================================================================
 
     // Field Separator
-    AWKValue& FS() { return get_variable("FS"); }
-    const AWKValue& FS() const { return const_cast<Environment*>(this)->FS(); }
+    AWKValue& FS() { return global_slots_[VAR_FS]; }
+    const AWKValue& FS() const { return global_slots_[VAR_FS]; }
 
     // Record Separator
-    AWKValue& RS() { return get_variable("RS"); }
-    const AWKValue& RS() const { return const_cast<Environment*>(this)->RS(); }
+    AWKValue& RS() { return global_slots_[VAR_RS]; }
+    const AWKValue& RS() const { return global_slots_[VAR_RS]; }
 
     // Output Field Separator
-    AWKValue& OFS() { return get_variable("OFS"); }
-    const AWKValue& OFS() const { return const_cast<Environment*>(this)->OFS(); }
+    AWKValue& OFS() { return global_slots_[VAR_OFS]; }
+    const AWKValue& OFS() const { return global_slots_[VAR_OFS]; }
 
     // Output Record Separator
-    AWKValue& ORS() { return get_variable("ORS"); }
-    const AWKValue& ORS() const { return const_cast<Environment*>(this)->ORS(); }
+    AWKValue& ORS() { return global_slots_[VAR_ORS]; }
+    const AWKValue& ORS() const { return global_slots_[VAR_ORS]; }
 
     // Number of Records (total)
-    AWKValue& NR() { return get_variable("NR"); }
-    const AWKValue& NR() const { return const_cast<Environment*>(this)->NR(); }
+    AWKValue& NR() { return global_slots_[VAR_NR]; }
+    const AWKValue& NR() const { return global_slots_[VAR_NR]; }
 
     // Number of Fields
-    AWKValue& NF() { return get_variable("NF"); }
-    const AWKValue& NF() const { return const_cast<Environment*>(this)->NF(); }
+    AWKValue& NF() { return global_slots_[VAR_NF]; }
+    const AWKValue& NF() const { return global_slots_[VAR_NF]; }
 
     // File Number of Records
-    AWKValue& FNR() { return get_variable("FNR"); }
-    const AWKValue& FNR() const { return const_cast<Environment*>(this)->FNR(); }
+    AWKValue& FNR() { return global_slots_[VAR_FNR]; }
+    const AWKValue& FNR() const { return global_slots_[VAR_FNR]; }
 
     // Current filename
-    AWKValue& FILENAME() { return get_variable("FILENAME"); }
-    const AWKValue& FILENAME() const { return const_cast<Environment*>(this)->FILENAME(); }
+    AWKValue& FILENAME() { return global_slots_[VAR_FILENAME]; }
+    const AWKValue& FILENAME() const { return global_slots_[VAR_FILENAME]; }
 
     // Array-Subscript-Separator
-    AWKValue& SUBSEP() { return get_variable("SUBSEP"); }
-    const AWKValue& SUBSEP() const { return const_cast<Environment*>(this)->SUBSEP(); }
+    AWKValue& SUBSEP() { return global_slots_[VAR_SUBSEP]; }
+    const AWKValue& SUBSEP() const { return global_slots_[VAR_SUBSEP]; }
 
     // Conversion format
-    AWKValue& CONVFMT() { return get_variable("CONVFMT"); }
-    const AWKValue& CONVFMT() const { return const_cast<Environment*>(this)->CONVFMT(); }
+    AWKValue& CONVFMT() { return global_slots_[VAR_CONVFMT]; }
+    const AWKValue& CONVFMT() const { return global_slots_[VAR_CONVFMT]; }
 
     // Output-Format
-    AWKValue& OFMT() { return get_variable("OFMT"); }
-    const AWKValue& OFMT() const { return const_cast<Environment*>(this)->OFMT(); }
+    AWKValue& OFMT() { return global_slots_[VAR_OFMT]; }
+    const AWKValue& OFMT() const { return global_slots_[VAR_OFMT]; }
 
     // Match position (from match())
-    AWKValue& RSTART() { return get_variable("RSTART"); }
-    const AWKValue& RSTART() const { return const_cast<Environment*>(this)->RSTART(); }
+    AWKValue& RSTART() { return global_slots_[VAR_RSTART]; }
+    const AWKValue& RSTART() const { return global_slots_[VAR_RSTART]; }
 
     // Match length (from match())
-    AWKValue& RLENGTH() { return get_variable("RLENGTH"); }
-    const AWKValue& RLENGTH() const { return const_cast<Environment*>(this)->RLENGTH(); }
+    AWKValue& RLENGTH() { return global_slots_[VAR_RLENGTH]; }
+    const AWKValue& RLENGTH() const { return global_slots_[VAR_RLENGTH]; }
 
     // Argument count
-    AWKValue& ARGC() { return get_variable("ARGC"); }
-    const AWKValue& ARGC() const { return const_cast<Environment*>(this)->ARGC(); }
+    AWKValue& ARGC() { return global_slots_[VAR_ARGC]; }
+    const AWKValue& ARGC() const { return global_slots_[VAR_ARGC]; }
 
     // Arguments (array)
-    AWKValue& ARGV() { return get_variable("ARGV"); }
-    const AWKValue& ARGV() const { return const_cast<Environment*>(this)->ARGV(); }
+    AWKValue& ARGV() { return global_slots_[VAR_ARGV]; }
+    const AWKValue& ARGV() const { return global_slots_[VAR_ARGV]; }
 
     // Environment variables (array)
-    AWKValue& ENVIRON() { return get_variable("ENVIRON"); }
-    const AWKValue& ENVIRON() const { return const_cast<Environment*>(this)->ENVIRON(); }
+    AWKValue& ENVIRON() { return global_slots_[VAR_ENVIRON]; }
+    const AWKValue& ENVIRON() const { return global_slots_[VAR_ENVIRON]; }
 
     // Case-Insensitive Matching (gawk Extension)
-    AWKValue& IGNORECASE() { return get_variable("IGNORECASE"); }
-    const AWKValue& IGNORECASE() const { return const_cast<Environment*>(this)->IGNORECASE(); }
+    AWKValue& IGNORECASE() { return global_slots_[VAR_IGNORECASE]; }
+    const AWKValue& IGNORECASE() const { return global_slots_[VAR_IGNORECASE]; }
 
     // Record Terminator (gawk extension) - the actual separator found
-    AWKValue& RT() { return get_variable("RT"); }
-    const AWKValue& RT() const { return const_cast<Environment*>(this)->RT(); }
+    AWKValue& RT() { return global_slots_[VAR_RT]; }
+    const AWKValue& RT() const { return global_slots_[VAR_RT]; }
 
     // Field Pattern (gawk extension) - alternative to FS
-    AWKValue& FPAT() { return get_variable("FPAT"); }
-    const AWKValue& FPAT() const { return const_cast<Environment*>(this)->FPAT(); }
+    AWKValue& FPAT() { return global_slots_[VAR_FPAT]; }
+    const AWKValue& FPAT() const { return global_slots_[VAR_FPAT]; }
 
     // Text Domain for i18n (gawk extension) - default is "messages"
-    AWKValue& TEXTDOMAIN() { return get_variable("TEXTDOMAIN"); }
-    const AWKValue& TEXTDOMAIN() const { return const_cast<Environment*>(this)->TEXTDOMAIN(); }
+    AWKValue& TEXTDOMAIN() { return global_slots_[VAR_TEXTDOMAIN]; }
+    const AWKValue& TEXTDOMAIN() const { return global_slots_[VAR_TEXTDOMAIN]; }
 
     // ========================================================================
     // Function Registry
@@ -166,6 +209,10 @@ public:
     // Get built-in function
     BuiltinFunction get_builtin(const std::string& name);
 
+    // Get built-in function without copying (nullptr if not found).
+    // The pointer stays valid until the built-in table is modified.
+    const BuiltinFunction* find_builtin(const std::string& name) const;
+
     // Check if built-in exists
     bool has_builtin(const std::string& name) const;
 
@@ -183,11 +230,23 @@ public:
     void set_argv(const std::vector<std::string>& args);
 
 private:
-    // Global variables
-    std::unordered_map<std::string, AWKValue> globals_;
+    // Global variables, addressed by slot (deque: references stay stable)
+    std::deque<AWKValue> global_slots_;
+
+    // Name -> slot map for lookup by name (SYMTAB, indirect access, -v)
+    std::unordered_map<std::string, uint32_t> global_index_;
+
+    // Active function call
+    struct Frame {
+        const FunctionDef* function;
+        size_t base;  // First slot of the frame in frame_values_
+    };
 
-    // Scope stack for functions (local variables)
-    std::vector<std::unordered_map<std::string, AWKValue>> scope_stack_;
+    // Frame stack for functions. Slots are kept when a frame is popped and
+    // overwritten by the next call, so calls do not allocate once warm.
+    std::deque<AWKValue> frame_values_;
+    size_t frame_top_ = 0;
+    std::vector<Frame> frames_;
 
     // User-defined functions
     std::unordered_map<std::string, FunctionDef*> user_functions_;
@@ -195,9 +254,11 @@ private:
     // Built-in functions
     std::unordered_map<std::string, BuiltinFunction> builtin_functions_;
 
-    // Check if a variable is a special built-in AWK variable
-    // (used for namespace fallback lookup)
-    static bool is_special_variable(const std::string& name);
+    // Local of the current function by name (nullptr if not a parameter)
+    AWKValue* find_local(const std::string& name);
+
+    // Global by name (creates if needed)
+    AWKValue& global_by_name(const std::string& name) { return global_slots_[global_slot(name)]; }
 };
 
 } // namespace awk
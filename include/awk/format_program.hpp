@@ -0,0 +1,53 @@
+#ifndef AWK_FORMAT_PROGRAM_HPP
+#define AWK_FORMAT_PROGRAM_HPP
+
+#include "value.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace awk {
+
+// ============================================================================
+// FormatProgram - printf/sprintf format compiled once
+// ============================================================================
+//
+// A format string is parsed into a list of literal texts and conversions
+// when it is first used; running the program only fetches the arguments
+// and formats them. %d, %i, %s, %c and %e/%f/%g with the '-' and '0' flags
+// (and any width or precision) are formatted straight into the output
+// string; everything else goes through snprintf with the conversion's own
+// spec.
+class FormatProgram {
+public:
+    explicit FormatProgram(std::string_view format);
+
+    const std::string& source() const { return source_; }
+
+    // Appends the formatted args to out. Missing arguments are
+    // uninitialized; extra ones are ignored.
+    void run(const AWKValue* args, size_t count, std::string& out) const;
+
+private:
+    struct Op {
+        std::string text;     // Literal text, or the printf spec of a conversion
+        char conv = 0;        // Conversion character; 0 for literal text
+        bool left = false;    // '-' flag
+        bool zero = false;    // '0' flag
+        bool other_flags = false;  // '+', ' ' or '#'
+        bool width_arg = false;      // Width is '*'
+        bool precision_arg = false;  // Precision is '*'
+        int width = 0;
+        int precision = -1;  // -1 if not given
+    };
+
+    std::string source_;
+    std::vector<Op> ops_;
+
+    void format_conversion(const Op& op, const AWKValue* args, size_t count,
+                           size_t& next, std::string& out) const;
+};
+
+} // namespace awk
+
+#endif // AWK_FORMAT_PROGRAM_HPP
@@ -3,7 +3,14 @@
 
 #include "ast.hpp"
 #include "value.hpp"
+#include "array.hpp"
 #include "environment.hpp"
+#include "bytecode.hpp"
+#include "record_reader.hpp"
+#include "format_program.hpp"
+#include "output_file_pool.hpp"
+#include "output_sink.hpp"
+#include "regex.hpp"
 #include <string>
 #include <vector>
 #include <iostream>
@@ -11,8 +18,8 @@
 #include <memory>
 #include <unordered_map>
 #include <cstdio>
-#include <streambuf>
-#include <regex>
+#include <string_view>
+#include <limits>
 
 namespace awk {
 
@@ -26,9 +33,8 @@ public:
 
     RegexCache() = default;
 
-    // Get regex from cache or compile it
-    const std::regex& get(const std::string& pattern,
-                          std::regex_constants::syntax_option_type flags);
+    // Get regex from cache or compile it (throws RegexError if invalid)
+    const Regex& get(const std::string& pattern, unsigned flags);
 
     // Clear cache (e.g., when IGNORECASE changes)
     void clear() {
@@ -51,7 +57,7 @@ private:
     // Cache entry with pattern + flags as key
     struct CacheKey {
         std::string pattern;
-        std::regex_constants::syntax_option_type flags;
+        unsigned flags;
 
         bool operator==(const CacheKey& other) const {
             return pattern == other.pattern && flags == other.flags;
@@ -61,12 +67,12 @@ private:
     struct CacheKeyHash {
         size_t operator()(const CacheKey& key) const {
             size_t h1 = std::hash<std::string>{}(key.pattern);
-            size_t h2 = std::hash<unsigned int>{}(static_cast<unsigned int>(key.flags));
+            size_t h2 = std::hash<unsigned int>{}(key.flags);
             return h1 ^ (h2 << 1);
         }
     };
 
-    std::unordered_map<CacheKey, std::shared_ptr<std::regex>, CacheKeyHash> cache_;
+    std::unordered_map<CacheKey, std::shared_ptr<Regex>, CacheKeyHash> cache_;
     size_t hits_ = 0;
     size_t misses_ = 0;
 
@@ -75,74 +81,30 @@ private:
 };
 
 // ============================================================================
-// PipeStreamBuf - streambuf wrapper for FILE* pipes
+// OutputPipe - print | command
 // ============================================================================
-class PipeStreamBuf : public std::streambuf {
-public:
-    explicit PipeStreamBuf(FILE* pipe) : pipe_(pipe) {}
-
-    ~PipeStreamBuf() override {
-        sync();
-    }
-
-    // Close the pipe and return the exit code
-    int close_pipe() {
-        if (pipe_) {
-            sync();
-#ifdef _WIN32
-            int result = _pclose(pipe_);
-#else
-            int result = pclose(pipe_);
-#endif
-            pipe_ = nullptr;
-            return result;
-        }
-        return -1;
-    }
-
-    bool is_open() const { return pipe_ != nullptr; }
-
-protected:
-    int_type overflow(int_type c) override {
-        if (c != traits_type::eof() && pipe_) {
-            if (fputc(c, pipe_) == EOF) {
-                return traits_type::eof();
-            }
-        }
-        return c;
-    }
+struct OutputPipe {
+    FILE* pipe = nullptr;              // popen()ed command; nullptr for a coprocess
+    std::unique_ptr<OutputSink> sink;  // Writes fileno(pipe) or the coprocess's stdin
 
-    std::streamsize xsputn(const char* s, std::streamsize n) override {
-        if (pipe_) {
-            return static_cast<std::streamsize>(fwrite(s, 1, n, pipe_));
-        }
-        return 0;
-    }
+    OutputPipe() = default;
+    OutputPipe(const OutputPipe&) = delete;
+    OutputPipe& operator=(const OutputPipe&) = delete;
 
-    int sync() override {
-        if (pipe_) {
-            return fflush(pipe_) == 0 ? 0 : -1;
-        }
-        return 0;
+    ~OutputPipe() {
+        close();
     }
 
-private:
-    FILE* pipe_;
+    // Flush the output, then close the pipe and return the exit code
+    int close();
 };
 
 // ============================================================================
-// PipeOStream - ostream wrapper for pipes
+// InputPipe - command | getline
 // ============================================================================
-class PipeOStream : public std::ostream {
-public:
-    explicit PipeOStream(FILE* pipe)
-        : std::ostream(&buf_), buf_(pipe) {}
-
-    int close_pipe() { return buf_.close_pipe(); }
-    bool is_open() const { return buf_.is_open(); }
-
-private:
-    PipeStreamBuf buf_;
+struct InputPipe {
+    FILE* pipe = nullptr;                  // Closed with pclose() by the owner
+    std::unique_ptr<RecordReader> reader;  // Reads fileno(pipe)
 };
 
 // ============================================================================
@@ -187,61 +149,36 @@ struct Coprocess {
 };
 
 // ============================================================================
-// Utility Functions
+// Control Flow
 // ============================================================================
 
-// Convert AWK-style replacement string to std::regex replacement format
-// & -> $& (matched text), \& -> literal &, \\ -> literal backslash
-// If support_backrefs is true, \1-\9 -> $1-$9 (for gensub)
-inline std::string convert_awk_replacement(const std::string& replacement, bool support_backrefs = false) {
-    std::string result;
-    result.reserve(replacement.length() * 2);
-
-    for (size_t i = 0; i < replacement.length(); ++i) {
-        if (replacement[i] == '\\' && i + 1 < replacement.length()) {
-            char next = replacement[i + 1];
-            if (support_backrefs && next >= '0' && next <= '9') {
-                // \1-\9 -> $1-$9 (gensub backreferences)
-                result += '$';
-                result += next;
-                ++i;
-            } else if (next == '&') {
-                result += '&';  // \& -> literal &
-                ++i;
-            } else if (next == '\\') {
-                result += '\\'; // \\ -> literal backslash
-                ++i;
-            } else {
-                result += replacement[i];
-            }
-        } else if (replacement[i] == '&') {
-            result += "$&";  // & -> $& (matched text)
-        } else {
-            result += replacement[i];
-        }
-    }
-
-    return result;
-}
-
-// ============================================================================
-// Control Flow Exceptions
-// ============================================================================
+// How control leaves a statement. Statements return their completion to the
+// enclosing loop, function call or rule driver instead of throwing.
+enum class Completion : unsigned char {
+    NORMAL,
+    BREAK,
+    CONTINUE,
+    NEXT,
+    NEXTFILE,
+    RETURN,  // Value in return_value_
+    EXIT     // Status in exit_status_
+};
 
-// Control flow exceptions
-struct BreakException {};
-struct ContinueException {};
+// next, nextfile and exit inside a function have to abort the expression that
+// called it, so call_user_function rethrows those completions as exceptions
 struct NextException {};
 struct NextfileException {};
-struct ReturnException {
-    AWKValue value;
-    explicit ReturnException(AWKValue v = AWKValue()) : value(std::move(v)) {}
-};
 struct ExitException {
     int status;
     explicit ExitException(int s = 0) : status(s) {}
 };
 
+// Execution engine for rule actions, patterns and function bodies
+enum class Engine {
+    TREE,  // Walk the AST directly
+    VM     // Compile to bytecode and run it on the stack VM
+};
+
 // The AWK interpreter
 class Interpreter {
 public:
@@ -250,6 +187,19 @@ public:
     // Execute program
     void run(Program& program, const std::vector<std::string>& input_files);
 
+    // Select the execution engine (takes effect on the next run())
+    void set_engine(Engine engine) { engine_ = engine; }
+    Engine engine() const { return engine_; }
+
+    // Memory-map regular input files (default) instead of reading them
+    void set_mmap_input(bool enabled) { mmap_input_ = enabled; }
+    bool mmap_input() const { return mmap_input_; }
+
+    // Output files held open at once; colder ones are closed and reopened
+    // for appending when written to again
+    void set_max_open_files(size_t max_open) { output_files_.set_max_open(max_open); }
+    size_t max_open_files() const { return output_files_.max_open(); }
+
     // For built-in functions: access to environment
     Environment& environment() { return env_; }
     const Environment& environment() const { return env_; }
@@ -260,16 +210,20 @@ public:
     int field_count() const;
 
     // Current record
-    const std::string& current_record() const { return current_record_; }
+    std::string_view current_record() const { return current_record_; }
     void set_record(const std::string& record);
 
     // Output
-    std::ostream& output_stream() { return *output_; }
-    void set_output_stream(std::ostream& os) { output_ = &os; }
+    std::ostream& output_stream() {
+        output_sink_->flush();
+        return *output_;
+    }
+    void set_output_stream(std::ostream& os);
+    OutputSink& output_sink() { return *output_sink_; }
 
     // Error output
     std::ostream& error_stream() { return *error_; }
-    void set_error_stream(std::ostream& os) { error_ = &os; }
+    void set_error_stream(std::ostream& os);
 
     // File management for close() and fflush()
     bool close_file(const std::string& filename);
@@ -277,12 +231,8 @@ public:
     void flush_all_files();
 
     // Regex flags based on IGNORECASE
-    std::regex_constants::syntax_option_type get_regex_flags() const {
-        auto flags = std::regex_constants::extended;
-        if (env_.IGNORECASE().to_bool()) {
-            flags |= std::regex_constants::icase;
-        }
-        return flags;
+    unsigned get_regex_flags() const {
+        return env_.IGNORECASE().to_bool() ? Regex::ICASE : Regex::NONE;
     }
 
     // i18n (internationalization)
@@ -290,7 +240,11 @@ public:
     std::string get_textdomain_directory(const std::string& domain) const;
 
     // Regex cache for performance
-    const std::regex& get_cached_regex(const std::string& pattern);
+    const Regex& get_cached_regex(const std::string& pattern);
+
+    // Compiled matcher of a regex literal, built on first use and after
+    // IGNORECASE changes (nullptr if the pattern is invalid)
+    const Regex* literal_regex(RegexExpr& expr);
     RegexCache& regex_cache() { return regex_cache_; }
     const RegexCache& regex_cache() const { return regex_cache_; }
 
@@ -298,9 +252,33 @@ private:
     Environment env_;
     Program* current_program_ = nullptr;
 
-    // Fields
-    std::string current_record_;
-    std::vector<std::string> fields_;
+    // Bytecode engine state (compiled_ is only set while running with Engine::VM)
+    Engine engine_ = Engine::TREE;
+    std::unique_ptr<CompiledProgram> compiled_;
+    std::vector<AWKValue> vm_stack_;
+    std::vector<VMIterator> vm_iterators_;
+
+    // Payload of the RETURN and EXIT completions
+    AWKValue return_value_;
+    int exit_status_ = 0;
+
+    // $0 is a view: into record_storage_, or straight into a memory-mapped
+    // input file while that file is being read (see detach_record()).
+    // Fields: a field is an (offset, length) span of current_record_ until it
+    // is assigned. Assigned fields keep their text in field_texts_ (parallel
+    // to fields_) until rebuild_record() joins them into a new record.
+    struct FieldSpan {
+        size_t offset = 0;
+        size_t length = 0;
+        bool assigned = false;
+    };
+
+    std::string_view current_record_;
+    std::string record_storage_;
+    std::vector<FieldSpan> fields_;
+    std::vector<std::string> field_texts_;
+    std::string rebuild_buffer_;  // Reused by rebuild_record()
+    size_t field_limit_ = std::numeric_limits<size_t>::max();  // From FieldDemand
     bool fields_dirty_ = false;
     bool record_dirty_ = false;
 
@@ -314,16 +292,30 @@ private:
     std::ostream* output_ = &std::cout;
     std::ostream* error_ = &std::cerr;
 
+    // print/printf output: output_sink_ writes output_ (fd 1 for std::cout),
+    // error_sink_ writes error_ for "/dev/stderr", null_sink_ drops "/dev/null"
+    std::unique_ptr<OutputSink> output_sink_;
+    std::unique_ptr<OutputSink> error_sink_;
+    OutputSink null_sink_;
+
     // Open files/pipes
-    std::unordered_map<std::string, std::unique_ptr<std::ofstream>> output_files_;
-    std::unordered_map<std::string, std::unique_ptr<std::ifstream>> input_files_;
-    std::unordered_map<std::string, FILE*> input_pipes_;  // For command | getline
-    std::unordered_map<std::string, std::unique_ptr<PipeOStream>> output_pipes_;  // For print | command
+    OutputFilePool output_files_;
+    std::unordered_map<std::string, std::unique_ptr<RecordReader>> input_files_;
+    std::unordered_map<std::string, InputPipe> input_pipes_;  // For command | getline
+    std::unique_ptr<RecordReader> stdin_reader_;  // Shared by main input, getline and "-"
+    RecordReader* main_input_ = nullptr;  // Input of the record loop, if running
+    bool mmap_input_ = true;  // Map regular input files instead of reading them
+    std::unordered_map<std::string, std::unique_ptr<OutputPipe>> output_pipes_;  // For print | command
     std::unordered_map<std::string, std::unique_ptr<Coprocess>> coprocesses_;  // For |& (gawk extension)
 
     // Regex cache for performance
     RegexCache regex_cache_;
 
+    // Compiled printf/sprintf formats by format string
+    static constexpr size_t MAX_FORMAT_CACHE_SIZE = 64;
+    std::unordered_map<std::string, std::shared_ptr<const FormatProgram>> format_cache_;
+    std::string format_buffer_;  // Output of a printf statement, reused
+
     // Cached special variable values (performance optimization)
     // These are frequently accessed but rarely change
     mutable std::string cached_rs_;
@@ -350,38 +342,54 @@ private:
     // Execution
     // ========================================================================
 
-    void execute_begin_rules();
-    void execute_end_rules();
-    void execute_beginfile_rules();
-    void execute_endfile_rules();
-    void execute_main_rules();
+    Completion execute_begin_rules();
+    Completion execute_end_rules();
+    Completion execute_beginfile_rules();
+    Completion execute_endfile_rules();
+    Completion execute_main_rules();
+    Completion execute_action(size_t rule_index);
 
-    void process_file(const std::string& filename);
-    void process_stream(std::istream& input, const std::string& filename);
-    bool read_record(std::istream& input);
+    Completion process_file(const std::string& filename);
+    Completion process_stream(RecordReader& input, const std::string& filename);
+    bool read_record(RecordReader& input);
+    RecordReader& stdin_reader();
+    void detach_record();
 
     // ========================================================================
     // Pattern Matching
     // ========================================================================
 
-    bool pattern_matches(Pattern& pattern);
+    bool pattern_matches(Pattern& pattern, const CompiledRule* compiled = nullptr);
+
+    // ========================================================================
+    // Bytecode Execution
+    // ========================================================================
+
+    // Leaves the value of a RETURN in return_value_
+    Completion run_chunk(const Chunk& chunk);
+
+    // Run a pattern chunk and test its result
+    bool chunk_matches(const Chunk& chunk) {
+        run_chunk(chunk);
+        return is_truthy(return_value_);
+    }
 
     // ========================================================================
     // Statement Execution
     // ========================================================================
 
-    void execute(Stmt& stmt);
-    void execute(BlockStmt& stmt);
-    void execute(IfStmt& stmt);
-    void execute(WhileStmt& stmt);
-    void execute(DoWhileStmt& stmt);
-    void execute(ForStmt& stmt);
-    void execute(ForInStmt& stmt);
-    void execute(SwitchStmt& stmt);
-    void execute(PrintStmt& stmt);
-    void execute(PrintfStmt& stmt);
-    void execute(ExprStmt& stmt);
-    void execute(DeleteStmt& stmt);
+    Completion execute(Stmt& stmt);
+    Completion execute(BlockStmt& stmt);
+    Completion execute(IfStmt& stmt);
+    Completion execute(WhileStmt& stmt);
+    Completion execute(DoWhileStmt& stmt);
+    Completion execute(ForStmt& stmt);
+    Completion execute(ForInStmt& stmt);
+    Completion execute(SwitchStmt& stmt);
+    Completion execute(PrintStmt& stmt);
+    Completion execute(PrintfStmt& stmt);
+    Completion execute(ExprStmt& stmt);
+    Completion execute(DeleteStmt& stmt);
 
     // ========================================================================
     // Expression Evaluation
@@ -403,6 +411,7 @@ private:
     AWKValue evaluate(ConcatExpr& expr);
     AWKValue evaluate(GetlineExpr& expr);
     AWKValue evaluate(InExpr& expr);
+    AWKValue evaluate(UpdateExpr& expr);
 
     // ========================================================================
     // Helper Functions
@@ -414,20 +423,85 @@ private:
     // Parse fields
     void parse_fields();
     void rebuild_record();
+    void add_field(size_t offset, size_t length) { fields_.push_back({offset, length, false}); }
+
+    // Text of field i (0-based), without copying spans
+    std::string_view field_text(size_t i) const {
+        const FieldSpan& field = fields_[i];
+        if (field.assigned) {
+            return field_texts_[i];
+        }
+        return std::string_view(current_record_).substr(field.offset, field.length);
+    }
 
-    // Function call
-    AWKValue call_function(const std::string& name, std::vector<AWKValue>& args);
-    AWKValue call_user_function(FunctionDef* func, std::vector<AWKValue>& args);
+    // Function call. Arrays are passed by reference. untyped, if given,
+    // has one entry per argument: the caller's variable when the argument
+    // was a plain uninitialized variable, else nullptr; if the callee makes
+    // that parameter an array, the variable becomes the same array.
+    AWKValue call_function(const std::string& name, std::vector<AWKValue>& args,
+                           AWKValue* const* untyped = nullptr);
+    AWKValue call_user_function(FunctionDef* func, std::vector<AWKValue>& args,
+                                AWKValue* const* untyped = nullptr);
+
+    // Caller's variable for each argument that may become an array alias
+    // (see call_function); false if no argument is an uninitialized variable
+    bool collect_untyped_args(std::vector<ExprPtr>& arguments, std::vector<AWKValue*>& untyped);
 
     // Get LValue reference
     AWKValue& get_lvalue(Expr& expr);
 
+    // ========================================================================
+    // Array Subscripts
+    // ========================================================================
+    //
+    // a[k1, k2, ...] without building the SUBSEP-joined key: one integer
+    // subscript indexes dense arrays, several are looked up as a TupleKey.
+
+    // Evaluates subscripts into inline_keys (TupleKey::MAX_PARTS values) or,
+    // if there are more, into more_keys; returns the one that was used
+    AWKValue* evaluate_subscripts(std::vector<ExprPtr>& indices, AWKValue* inline_keys,
+                                  std::vector<AWKValue>& more_keys);
+
+    AWKValue& array_element(AWKValue& array, const AWKValue* keys, size_t count);
+    bool array_has_element(const AWKValue& array, const AWKValue* keys, size_t count);
+    void delete_array_element(AWKValue& array, const AWKValue* keys, size_t count);
+
+    // The joined key (SYMTAB, FUNCTAB)
+    std::string join_subscripts(const AWKValue* keys, size_t count);
+
+    // Storage of a resolved variable (falls back to lookup by name)
+    AWKValue& variable(const std::string& name, const VarRef& ref) {
+        switch (ref.scope) {
+            case VarRef::Scope::GLOBAL:
+                return env_.global(ref.index);
+            case VarRef::Scope::LOCAL:
+                return env_.local(ref.index);
+            case VarRef::Scope::UNRESOLVED:
+                break;
+        }
+        return env_.get_variable(name);
+    }
+
+    AWKValue& variable(const ChunkVar& var) { return variable(var.name, var.ref); }
+
+    // Call before writing through a reference: assignments to FS, OFS, etc.
+    // must refresh the cached special variables
+    void note_store(const VarRef& ref) {
+        if (ref.scope == VarRef::Scope::GLOBAL && Environment::is_special_slot(ref.index)) {
+            special_vars_dirty_ = true;
+        }
+    }
+
     // Output redirect
-    std::ostream* get_output_stream(const std::string& target, RedirectType type);
+    OutputSink* get_output_sink(const std::string& target, RedirectType type);
 
     // Regex matching
     bool regex_match(const AWKValue& text, const AWKValue& pattern);
 
+    // Match text (default: $0) against a regex literal without copying it
+    bool regex_match(std::string_view text, RegexExpr& regex);
+    bool match_record(RegexExpr& regex) { return regex_match(current_record_, regex); }
+
     // Register built-in functions
     void register_builtins();
     void register_math_builtins();
@@ -437,13 +511,17 @@ private:
     void register_bit_builtins();
     void register_type_builtins();
 
-    // sprintf implementation
-    std::string do_sprintf(const std::string& format, const std::vector<AWKValue>& args);
+    // Compiled form of a printf/sprintf format, from format_cache_
+    std::shared_ptr<const FormatProgram> format_program(const std::string& format);
+
+    // Format of a printf statement: compiled once into the node if it is
+    // a string literal, otherwise evaluated and looked up
+    std::shared_ptr<const FormatProgram> format_program(PrintfStmt& stmt);
 
     // getline helper functions
-    std::istream* get_input_file(const std::string& filename);
-    FILE* get_input_pipe(const std::string& command);
-    int getline_from_stream(std::istream& stream, Expr* variable, bool update_nr);
+    RecordReader* get_input_file(const std::string& filename);
+    RecordReader* get_input_pipe(const std::string& command);
+    int getline_from_reader(RecordReader& input, Expr* variable, bool update_nr);
     int getline_from_pipe(FILE* pipe, Expr* variable, bool update_nr);
 
     // Coprocess helper functions (gawk |& extension)
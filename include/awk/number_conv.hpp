@@ -0,0 +1,41 @@
+#ifndef AWK_NUMBER_CONV_HPP
+#define AWK_NUMBER_CONV_HPP
+
+#include <cstddef>
+
+namespace awk {
+namespace numconv {
+
+// ============================================================================
+// Number <-> string conversion kernels
+// ============================================================================
+//
+// Every numeric field read, every print of a computed number and every
+// numeric subscript converts between text and double. These replace the
+// snprintf/strtod round trips with std::to_chars/std::from_chars where the
+// standard library provides them for floating point (printf-exact fixed
+// precision output, Eisel-Lemire parsing); otherwise, and for anything
+// they do not cover, they fall back to the C library with the same result.
+
+// Longest integer value formatted by format_integer
+constexpr size_t INTEGER_DIGITS = 20;
+
+// Writes the decimal digits of value (with a leading '-' if negative) to
+// buf, which has room for INTEGER_DIGITS characters; returns the end
+char* format_integer(long long value, char* buf);
+
+// Formats num as snprintf(buf, size, format, num) would and, like
+// snprintf, returns the length of the complete result (if that is not
+// less than size, the output was truncated). "%g", "%.Ng", "%.Nf" and
+// "%.Ne" are formatted without going through printf.
+size_t format_double(double num, const char* format, char* buf, size_t size);
+
+// AWK string-to-number: skips leading whitespace and converts the longest
+// numeric prefix of [str, str + size), or returns 0 if there is none.
+// str[size] must be readable (a NUL terminator).
+double parse_number(const char* str, size_t size);
+
+} // namespace numconv
+} // namespace awk
+
+#endif // AWK_NUMBER_CONV_HPP
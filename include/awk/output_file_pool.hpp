@@ -0,0 +1,77 @@
+#ifndef AWK_OUTPUT_FILE_POOL_HPP
+#define AWK_OUTPUT_FILE_POOL_HPP
+
+#include "output_sink.hpp"
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace awk {
+
+// ============================================================================
+// OutputFilePool - Files of print > and print >>
+// ============================================================================
+//
+// A file keeps its sink until it is closed, but at most max_open() of them
+// hold a descriptor and a buffer. Opening one more releases the least
+// recently used file, which is reopened for appending when it is written
+// to again; only the first open of a file (or the first after close())
+// truncates it. print > ("out/" $1) can therefore write any number of
+// files.
+class OutputFilePool {
+public:
+    // Open files allowed by the descriptor limit, leaving room for input
+    // files and pipes
+    static size_t default_max_open();
+
+    OutputFilePool() : OutputFilePool(default_max_open()) {}
+    explicit OutputFilePool(size_t max_open);
+
+    OutputFilePool(const OutputFilePool&) = delete;
+    OutputFilePool& operator=(const OutputFilePool&) = delete;
+
+    // Sink of path, opened if needed; nullptr with errno set if it cannot
+    // be opened
+    OutputSink* get(const std::string& path, bool append);
+
+    // Sink of path if it was opened and not closed since
+    OutputSink* find(const std::string& path);
+
+    // Flushes and closes path; false if it is not an output file
+    bool close(const std::string& path);
+
+    void flush_all();
+    void clear();
+
+    size_t max_open() const { return max_open_; }
+    void set_max_open(size_t max_open);
+
+    size_t size() const { return files_.size(); }
+    size_t open_count() const { return lru_.size(); }
+
+private:
+    struct Entry;
+    using LruList = std::list<Entry*>;
+
+    struct Entry {
+        std::unique_ptr<OutputSink> sink;
+        LruList::iterator lru;  // Valid while the sink is open
+    };
+
+    std::unordered_map<std::string, Entry> files_;
+    LruList lru_;  // Open files, most recently used first
+    size_t max_open_;
+
+    // Releases the least recently used files until at most keep are open
+    void release_until(size_t keep);
+
+    // Runs open (true on success) with a free slot, releasing more files
+    // while it fails for lack of descriptors
+    template <typename Open>
+    bool open_with_room(Open open);
+};
+
+} // namespace awk
+
+#endif // AWK_OUTPUT_FILE_POOL_HPP
@@ -0,0 +1,100 @@
+#ifndef AWK_OUTPUT_SINK_HPP
+#define AWK_OUTPUT_SINK_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace awk {
+
+// ============================================================================
+// OutputSink - Buffered output of print and printf
+// ============================================================================
+//
+// print and printf copy their text into the sink's buffer; a full buffer is
+// written with one write() call, or together with a large piece of text
+// with one writev() call. A sink writes a file descriptor (stdout, files,
+// pipes), an std::ostream (set_output_stream, /dev/stderr) or nothing
+// (/dev/null). A line-buffered sink is flushed at the end of every print
+// or printf statement; stdout is line-buffered when it is a terminal.
+class OutputSink {
+public:
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+
+    // Discards everything
+    OutputSink();
+
+    // Writes fd, which is closed with the sink if owns_fd
+    OutputSink(int fd, bool owns_fd, size_t buffer_size = DEFAULT_BUFFER_SIZE);
+
+    // Writes stream; flush() also flushes the stream
+    explicit OutputSink(std::ostream& stream, size_t buffer_size = DEFAULT_BUFFER_SIZE);
+
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    ~OutputSink();
+
+    // Opens path for print > (truncating) or print >> (appending); nullptr
+    // with errno set if it cannot be opened
+    static std::unique_ptr<OutputSink> open_file(const std::string& path, bool append);
+
+    // A file sink can give up its descriptor and buffer while it is not
+    // written to, and open its file again for appending
+    bool is_open() const { return fd_ >= 0; }
+    bool release();
+    bool reopen();
+
+    // Sink for the standard output: fd 1 (line-buffered on a terminal) for
+    // std::cout, otherwise the stream itself
+    static std::unique_ptr<OutputSink> for_stream(std::ostream& stream);
+
+    void write(const char* data, size_t size) {
+        if (size <= capacity_ - used_) {  // capacity_ is 0 until the first write
+            std::memcpy(buffer_.get() + used_, data, size);
+            used_ += size;
+        } else {
+            write_through(data, size);
+        }
+    }
+    void write(std::string_view text) { write(text.data(), text.size()); }
+
+    // End of a print or printf statement
+    void end_statement() {
+        if (line_buffered_) flush();
+    }
+
+    // Writes out the buffer; false if the output failed
+    bool flush();
+
+    // Flushes, then closes an owned descriptor; false if either failed
+    bool close();
+
+    bool line_buffered() const { return line_buffered_; }
+    void set_line_buffered(bool line_buffered) { line_buffered_ = line_buffered; }
+
+private:
+    std::unique_ptr<char[]> buffer_;
+    size_t buffer_size_ = 0;  // 0 for a discarding sink
+    size_t capacity_ = 0;     // Allocated part of buffer_size_
+    size_t used_ = 0;
+    int fd_ = -1;
+    bool owns_fd_ = false;
+    std::string path_;  // File sinks only
+    std::ostream* stream_ = nullptr;
+    bool line_buffered_ = false;
+    bool failed_ = false;
+
+    // Text that does not fit the rest of the buffer
+    void write_through(const char* data, size_t size);
+
+    // Writes buffered text followed by data (either may be empty)
+    void emit(const char* data, size_t size);
+};
+
+} // namespace awk
+
+#endif // AWK_OUTPUT_SINK_HPP
@@ -126,6 +126,10 @@ private:
     // Checks if an expression can be used as an lvalue
     bool is_lvalue(const Expr* expr) const;
 
+    // UpdateExpr for target op= value (++/-- when value is nullptr), or
+    // nullptr if target is not a plain variable or array element
+    static ExprPtr make_update(ExprPtr& target, TokenType op, ExprPtr& value, bool postfix);
+
     // ========================================================================
     // @include Processing (gawk extension)
     // ========================================================================
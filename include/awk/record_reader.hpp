@@ -0,0 +1,82 @@
+#ifndef AWK_RECORD_READER_HPP
+#define AWK_RECORD_READER_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace awk {
+
+// ============================================================================
+// RecordReader - block-buffered record input
+// ============================================================================
+//
+// Reads a file descriptor in large blocks with read(2) and splits the data
+// into records with memchr. Records are returned as views into the buffer
+// and stay valid until the next call. A record that crosses a block
+// boundary is moved to the front of the buffer (which grows if a single
+// record is larger than a block) before more data is read.
+//
+// Regular files can instead be memory-mapped (open() with allow_mmap): the
+// whole file is then the buffer, nothing is copied and records stay valid
+// until the reader is destroyed.
+class RecordReader {
+public:
+    static constexpr size_t BLOCK_SIZE = size_t(1) << 20;  // 1 MiB
+
+    // Reads from fd; the descriptor is closed on destruction if owns_fd
+    explicit RecordReader(int fd, bool owns_fd = false);
+    ~RecordReader();
+
+    RecordReader(const RecordReader&) = delete;
+    RecordReader& operator=(const RecordReader&) = delete;
+
+    // Opens a file for reading (nullptr on failure, errno is set). With
+    // allow_mmap, non-empty regular files are mapped instead of read; other
+    // files, or a failed mapping, fall back to block reads.
+    static std::unique_ptr<RecordReader> open(const std::string& path, bool allow_mmap = false);
+
+    // Reads the next record as separated by rs:
+    //   "\n" or any single character: records end at that character
+    //   ""  : paragraph mode, records end at one or more blank lines
+    //   longer separators: line by line (regex RS is not supported)
+    // rt receives the terminator that was found (empty at end of input).
+    // Returns false at end of input or on a read error.
+    bool read_record(const std::string& rs, std::string_view& record, std::string_view& rt);
+
+    // True if input stopped because of a read error rather than EOF
+    bool failed() const { return failed_; }
+
+    // True if the input is memory-mapped: records are never moved or reused
+    bool mapped() const { return mapping_ != nullptr; }
+
+private:
+    int fd_;
+    bool owns_fd_;
+    bool eof_ = false;
+    bool failed_ = false;
+
+    const char* data_ = nullptr;  // buffer_ or the mapping
+    std::unique_ptr<char[]> buffer_;
+    size_t capacity_ = 0;
+    size_t begin_ = 0;  // Start of unconsumed data
+    size_t end_ = 0;    // End of valid data
+
+    void* mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+
+    // Maps the whole file as the buffer; false leaves the reader streaming
+    bool map_file(size_t size);
+
+    // Moves unconsumed data to the front and reads another block after it.
+    // Offsets relative to begin_ stay valid. Returns false at EOF or error.
+    bool fill();
+
+    bool read_delimited(char delimiter, std::string_view& record, std::string_view& rt);
+    bool read_paragraph(std::string_view& record, std::string_view& rt);
+};
+
+} // namespace awk
+
+#endif // AWK_RECORD_READER_HPP
@@ -0,0 +1,156 @@
+#ifndef AWK_REGEX_HPP
+#define AWK_REGEX_HPP
+
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace awk {
+
+namespace regex_detail {
+struct Program;  // Compiled NFA (regex.cpp)
+class Dfa;       // Lazily built DFA over a Program
+} // namespace regex_detail
+
+// Invalid pattern; what() is the reason
+class RegexError : public std::runtime_error {
+public:
+    explicit RegexError(const std::string& message) : std::runtime_error(message) {}
+};
+
+// ============================================================================
+// Regex - POSIX extended regular expressions as AWK uses them
+// ============================================================================
+//
+// The pattern is parsed into a Thompson NFA, which is run as a DFA whose
+// states are built the first time the input reaches them and cached (with
+// a memory bound: a full cache is dropped and rebuilt). Every byte of text
+// costs one table lookup once the states it needs exist, so matching time
+// is linear in the text whatever the pattern. Matches are leftmost-longest:
+// a forward DFA finds where the leftmost match ends, a DFA of the reversed
+// pattern run back from there finds where it starts.
+//
+// Subexpressions are only tracked by find_groups() and captures(), which
+// run the NFA directly (Pike VM) over the span the DFA found; within it
+// earlier alternatives and longer repetitions take precedence. Patterns
+// with word assertions (\y \B \< \>) always run on the NFA.
+//
+// Besides POSIX ERE: gawk's \y \B \< \> \` \' \w \W \s \S, the escapes
+// \n \t \r \f \v \a \b \/ \" and octal/hex codes, a '{' that does not start
+// an interval is literal, and '.' and [^...] match newlines.
+//
+// Matching caches DFA states inside the object, so a Regex must not be
+// used by two threads at once.
+class Regex {
+public:
+    enum Flags : unsigned {
+        NONE = 0,
+        ICASE = 1  // IGNORECASE
+    };
+
+    static constexpr size_t npos = std::string_view::npos;
+
+    // [begin, end) of a match or subexpression; npos if it did not match
+    struct Span {
+        size_t begin = npos;
+        size_t end = npos;
+
+        bool matched() const { return begin != npos; }
+        size_t length() const { return end - begin; }
+    };
+
+    // Throws RegexError if the pattern is invalid
+    explicit Regex(std::string_view pattern, unsigned flags = NONE);
+    ~Regex();
+
+    Regex(const Regex&) = delete;
+    Regex& operator=(const Regex&) = delete;
+
+    const std::string& pattern() const { return pattern_; }
+    unsigned flags() const { return flags_; }
+
+    // Number of parenthesized subexpressions
+    size_t group_count() const { return groups_; }
+
+    // True if text contains a match; stops at the first one
+    bool search(std::string_view text) const;
+
+    // Leftmost-longest match starting at or after from. ^ only matches at
+    // the start of text, not at from.
+    bool find(std::string_view text, size_t from, Span& match) const;
+
+    // Subexpressions of a match that find() returned: groups[0] is the
+    // match itself, groups[i] the i-th subexpression
+    void captures(std::string_view text, Span match, std::vector<Span>& groups) const;
+
+    // find() followed by captures()
+    bool find_groups(std::string_view text, size_t from, std::vector<Span>& groups) const;
+
+    // Calls f(Span) for the successive matches that gsub, split and FPAT
+    // see: non-overlapping, left to right, and without an empty match
+    // right after the previous match. f returns false to stop. Returns the
+    // number of matches passed to f.
+    template <typename F>
+    size_t for_each_match(std::string_view text, F&& f) const {
+        size_t count = 0;
+        size_t pos = 0;
+        size_t previous_end = npos;
+        Span match;
+        while (pos <= text.size() && find(text, pos, match)) {
+            if (match.begin == match.end && match.begin == previous_end) {
+                pos = match.begin + 1;
+                continue;
+            }
+            ++count;
+            if (!f(match)) break;
+            previous_end = match.end;
+            pos = match.end > match.begin ? match.end : match.end + 1;
+        }
+        return count;
+    }
+
+private:
+    using Program = regex_detail::Program;
+    using Dfa = regex_detail::Dfa;
+
+    std::string pattern_;
+    unsigned flags_;
+    size_t groups_ = 0;
+    bool nfa_only_ = false;  // Word assertions: no DFA
+
+    // Patterns that are plain text (possibly anchored) skip the automata
+    bool literal_ = false;
+    bool literal_begin_ = false;  // ^text
+    bool literal_end_ = false;    // text$
+    std::string literal_text_;
+
+    std::unique_ptr<Program> forward_;
+    std::unique_ptr<Program> reverse_;  // Reversed pattern, no subexpressions
+
+    // Built on first use
+    mutable std::unique_ptr<Dfa> search_dfa_;    // Any match
+    mutable std::unique_ptr<Dfa> leftmost_dfa_;  // End of the leftmost-longest match
+    mutable std::unique_ptr<Dfa> reverse_dfa_;   // Its start
+
+    bool find_literal(std::string_view text, size_t from, Span& match) const;
+
+    // NFA simulation, for word assertions and subexpressions. With
+    // required_end set, only a match of [from, required_end) is accepted.
+    bool pike(std::string_view text, size_t from, size_t required_end,
+              std::vector<Span>* groups, Span& match) const;
+};
+
+// The replacement of sub and gsub: & is the matched text, \& a literal &
+// and \\ a backslash. With backrefs (gensub) \0 is the matched text and
+// \1-\9 its subexpressions. which = 0 replaces every match, otherwise only
+// the which-th. Returns the number of replacements; out receives text
+// with them made.
+size_t substitute(const Regex& re, std::string_view text, std::string_view replacement,
+                  bool backrefs, size_t which, std::string& out);
+
+} // namespace awk
+
+#endif // AWK_REGEX_HPP
@@ -0,0 +1,54 @@
+#ifndef AWK_RESOLVER_HPP
+#define AWK_RESOLVER_HPP
+
+#include "ast.hpp"
+#include "environment.hpp"
+#include <cstddef>
+#include <limits>
+#include <string>
+
+namespace awk {
+
+// Fields a program can observe, used to bound record splitting
+struct FieldDemand {
+    bool all = false;      // NF, $expr, field assignment or SYMTAB: split everything
+    size_t max_index = 0;  // Otherwise the highest constant $N read (0: no splitting)
+
+    // Number of fields parse_fields() has to produce
+    size_t limit() const { return all ? std::numeric_limits<size_t>::max() : max_index; }
+};
+
+// ============================================================================
+// Resolver - assigns storage slots to variable references
+// ============================================================================
+//
+// Walks the AST once before execution and fills in the VarRef of every
+// named variable or array: function parameters become LOCAL (indexed by
+// parameter position), everything else gets a GLOBAL slot in the
+// Environment. SYMTAB and FUNCTAB stay unresolved and are looked up by name.
+// The same walk records which fields the program references (FieldDemand).
+class Resolver {
+public:
+    explicit Resolver(Environment& env);
+
+    void resolve(Program& program);
+
+    const FieldDemand& field_demand() const { return field_demand_; }
+
+private:
+    Environment& env_;
+    const FunctionDef* function_ = nullptr;  // Function being resolved, if any
+    FieldDemand field_demand_;
+
+    VarRef resolve_name(const std::string& name);
+    void note_field_read(FieldExpr& field);
+    void note_store(Expr& target);
+
+    void resolve(Stmt& stmt);
+    void resolve(Expr& expr);
+    void resolve(std::vector<ExprPtr>& exprs);
+};
+
+} // namespace awk
+
+#endif // AWK_RESOLVER_HPP
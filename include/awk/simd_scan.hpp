@@ -0,0 +1,116 @@
+#ifndef AWK_SIMD_SCAN_HPP
+#define AWK_SIMD_SCAN_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace awk {
+namespace simd {
+
+// ============================================================================
+// SIMD separator scanning
+// ============================================================================
+//
+// Separators are found 64 bytes at a time: a kernel compares a block with
+// the separator and packs the result into a 64-bit mask (bit i set when
+// byte i matches), and the caller walks the set bits. The kernel set (AVX2,
+// SSE2 or scalar) is chosen once from CPUID.
+
+enum class Level { SCALAR, SSE2, AVX2 };
+
+struct Kernels {
+    Level level;
+    const char* name;
+    // Bit i set when block[i] == c; block has 64 readable bytes
+    uint64_t (*char_mask)(const char* block, char c);
+    // Bit i set when block[i] is ' ', '\t', '\n', '\v', '\f' or '\r'
+    uint64_t (*space_mask)(const char* block);
+};
+
+// Best kernels supported by this CPU
+const Kernels& kernels();
+
+// Kernels of a given level (for testing); nullptr if the CPU lacks it
+const Kernels* kernels_for(Level level);
+
+inline unsigned count_trailing_zeros(uint64_t mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#endif
+}
+
+// Calls fn(position) for every c in [data, data + size), in order, until fn
+// returns false.
+template <typename Fn>
+void for_each_char(const Kernels& k, const char* data, size_t size, char c, Fn&& fn) {
+    for (size_t base = 0; base < size; base += 64) {
+        size_t count = size - base;
+        uint64_t mask;
+        if (count >= 64) {
+            mask = k.char_mask(data + base, c);
+        } else {
+            char tail[64] = {};
+            std::memcpy(tail, data + base, count);
+            mask = k.char_mask(tail, c) & ((uint64_t(1) << count) - 1);
+        }
+        while (mask) {
+            if (!fn(base + count_trailing_zeros(mask))) {
+                return;
+            }
+            mask &= mask - 1;
+        }
+    }
+}
+
+// Calls fn(start, length) for every run of non-whitespace in
+// [data, data + size), in order, until fn returns false.
+template <typename Fn>
+void for_each_word(const Kernels& k, const char* data, size_t size, Fn&& fn) {
+    bool in_word = false;
+    size_t start = 0;
+    for (size_t base = 0; base < size; base += 64) {
+        size_t count = size - base;
+        uint64_t space;
+        if (count >= 64) {
+            space = k.space_mask(data + base);
+        } else {
+            // Bytes past the end count as whitespace and close the last word
+            char tail[64] = {};
+            std::memcpy(tail, data + base, count);
+            space = k.space_mask(tail) | ~((uint64_t(1) << count) - 1);
+        }
+        // A bit differs from the one before it where a word starts or ends
+        uint64_t before = (space << 1) | (in_word ? 0 : 1);
+        uint64_t edges = space ^ before;
+        while (edges) {
+            size_t pos = base + count_trailing_zeros(edges);
+            if (in_word) {
+                in_word = false;
+                if (!fn(start, pos - start)) {
+                    return;
+                }
+            } else {
+                in_word = true;
+                start = pos;
+            }
+            edges &= edges - 1;
+        }
+    }
+    if (in_word) {
+        fn(start, size - start);
+    }
+}
+
+} // namespace simd
+} // namespace awk
+
+#endif // AWK_SIMD_SCAN_HPP
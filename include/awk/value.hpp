@@ -2,22 +2,26 @@
 #define AWK_VALUE_HPP
 
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include <cmath>
-#include <regex>
+#include <cstdint>
 
 namespace awk {
 
 // Forward declaration
 class AWKValue;
 
-// Type alias for arrays
-using AWKArray = std::unordered_map<std::string, AWKValue>;
+// Associative array and multi-subscript key (array.hpp)
+class AWKArray;
+class TupleKey;
+
+// Compiled pattern (regex.hpp)
+class Regex;
 
 // AWK value types
-enum class ValueType {
+enum class ValueType : unsigned char {
     UNINITIALIZED,  // Never assigned
     NUMBER,         // Numeric value
     STRING,         // String value
@@ -27,6 +31,17 @@ enum class ValueType {
 };
 
 // Main value class for all AWK values
+//
+// 24 bytes: a type tag plus a union of the payloads. Strings of up to
+// INLINE_CAPACITY characters are stored in the value itself; longer ones in
+// a reference-counted StringRep block on the heap, shared between copies
+// and copied only when a shared string is modified (append_string).
+// Arrays are reference-counted and shared by copies; regexes are owned
+// pointers.
+//
+// STRING and STRNUM values parse their text once: the number and whether
+// the text looks numeric are cached in number_ (inline strings) or in the
+// StringRep (heap strings) and reset whenever the text changes.
 class AWKValue {
 public:
     // ========================================================================
@@ -47,7 +62,7 @@ public:
     explicit AWKValue(const char* str);
 
     // STRNUM (string from input that might be numeric)
-    static AWKValue strnum(const std::string& str);
+    static AWKValue strnum(std::string_view str);
 
     // Copy/Move
     AWKValue(const AWKValue& other);
@@ -55,7 +70,9 @@ public:
     AWKValue& operator=(const AWKValue& other);
     AWKValue& operator=(AWKValue&& other) noexcept;
 
-    ~AWKValue();
+    ~AWKValue() {
+        if (owns_heap()) release();
+    }
 
     // ========================================================================
     // Type queries
@@ -70,13 +87,18 @@ public:
     bool is_regex() const { return type_ == ValueType::REGEX; }
     bool is_array() const { return type_ == ValueType::ARRAY; }
 
-    // Is this value numeric or looks numeric?
+    // Is this value numeric or looks numeric? A STRNUM only counts as a
+    // number if its text looks like one (" 42 " does, "abc" and "" do not)
     bool is_numeric() const {
         return type_ == ValueType::NUMBER ||
-               type_ == ValueType::STRNUM ||
-               type_ == ValueType::UNINITIALIZED;
+               type_ == ValueType::UNINITIALIZED ||
+               (type_ == ValueType::STRNUM && looks_numeric());
     }
 
+    // Does the text of a STRING/STRNUM value look like a number? Cached
+    // along with to_number()
+    bool looks_numeric() const;
+
     // Type name for typeof()
     std::string type_name() const;
 
@@ -91,6 +113,11 @@ public:
     std::string to_string() const;
     std::string to_string(const std::string& convfmt) const;
 
+    // String form without copying: a view of the value's own text, or of
+    // scratch for numbers. Valid while both are alive and unmodified.
+    std::string_view to_string_view(std::string& scratch) const;
+    std::string_view to_string_view(std::string& scratch, const std::string& convfmt) const;
+
     // Convert to boolean (for conditions)
     bool to_bool() const;
 
@@ -114,6 +141,13 @@ public:
     AWKValue& operator/=(const AWKValue& other);
     AWKValue& operator%=(const AWKValue& other);
 
+    // Replace with a number in place (counters and x op= y)
+    void set_number(double num) {
+        if (owns_heap()) release();
+        number_ = num;
+        type_ = ValueType::NUMBER;
+    }
+
     // Increment/Decrement
     AWKValue& pre_increment();
     AWKValue& pre_decrement();
@@ -141,7 +175,11 @@ public:
     AWKValue concatenate(const AWKValue& other) const;
 
     // In-place string append (for optimization of s = s ... patterns)
-    void append_string(const std::string& str);
+    void append_string(std::string_view str);
+
+    // Replace with a string value, reusing an unshared heap block that is
+    // large enough (loop variables assigned once per iteration)
+    void assign_string(std::string_view str);
 
     // ========================================================================
     // Array Operations
@@ -150,6 +188,15 @@ public:
     // Access array element (creates if needed)
     AWKValue& array_access(const std::string& key);
 
+    // Element std::to_string(index), indexed directly while the array is
+    // dense (its keys are 1..n); split() and asort() fill arrays this way
+    AWKValue& array_access(long long index);
+
+    // Element key.join(), looked up without joining the key
+    AWKValue& array_access(const TupleKey& key);
+    bool array_contains(const TupleKey& key) const;
+    void array_delete(const TupleKey& key);
+
     // Access without creation
     const AWKValue* array_get(const std::string& key) const;
 
@@ -176,6 +223,10 @@ public:
     static std::string make_array_key(const std::vector<AWKValue>& indices,
                                       const std::string& subsep);
 
+    // Positive integer a numeric subscript stands for (a[1] and a["1"] are
+    // the same element), or 0 if the subscript has to be converted to a key
+    static long long integer_subscript(const AWKValue& subscript);
+
     // ========================================================================
     // Regex Operations
     // ========================================================================
@@ -183,62 +234,132 @@ public:
     // Set as regex
     void set_regex(const std::string& pattern);
 
+    // Set as regex with an already compiled matcher (shared, not copied)
+    void set_regex(const std::string& pattern, std::shared_ptr<Regex> compiled);
+
     // Regex match
     bool regex_match(const std::string& text) const;
 
     // Get regex pattern (for IGNORECASE)
-    const std::string& regex_pattern() const { return regex_pattern_; }
+    const std::string& regex_pattern() const;
 
-    // Regex for sub/gsub
+    // Regex for sub/gsub (& and \\& in replacement as in sub)
     std::string regex_replace(const std::string& text,
                               const std::string& replacement,
                               bool global) const;
 
 private:
+    // Heap block of a string too long to store inline: this header, then
+    // the characters and a terminating NUL. Shared by copies of a value; the
+    // count is not atomic since values never cross threads.
+    struct StringRep {
+        size_t size;
+        size_t capacity;
+        size_t refs;
+        double number;          // Cached numeric value of the text
+        unsigned char numeric;  // NumericState of number
+
+        char* data() { return reinterpret_cast<char*>(this + 1); }
+        const char* data() const { return reinterpret_cast<const char*>(this + 1); }
+
+        static StringRep* create(const char* text, size_t size, size_t capacity);
+        static void release(StringRep* rep);  // Frees it with the last reference
+    };
+
+    // An array and the number of values referring to it (value.cpp)
+    struct ArrayRep;
+
+    struct RegexRep {
+        std::string pattern;  // Original pattern (for IGNORECASE and to_string)
+        std::shared_ptr<Regex> compiled;
+    };
+
+    // What is known about the number of a string's text
+    enum NumericState : unsigned char {
+        NUMERIC_UNPARSED = 0,  // Not converted yet
+        NUMERIC_STRING,        // Converted; the text looks numeric
+        NUMERIC_PREFIX         // Converted from a leading prefix ("12ab" is 12, "ab" is 0)
+    };
+
+    static constexpr size_t INLINE_CAPACITY = 12;      // Characters stored without allocation
+    static constexpr unsigned char HEAP_STRING = 0xFF;  // inline_size_ of a StringRep string
+
+    union {
+        mutable double number_;  // NUMBER, or the cached number of an inline string
+        StringRep* heap_;
+        ArrayRep* array_;
+        RegexRep* regex_;
+    };
+    char inline_[INLINE_CAPACITY + 1];  // NUL-terminated
+    unsigned char inline_size_ = 0;  // Length of an inline string, or HEAP_STRING
     ValueType type_ = ValueType::UNINITIALIZED;
-    double number_value_ = 0.0;
-    std::string string_value_;
-    std::unique_ptr<AWKArray> array_value_;
-    std::shared_ptr<std::regex> regex_value_;
-    std::string regex_pattern_;  // Original pattern for debugging
+    mutable unsigned char numeric_ = NUMERIC_UNPARSED;  // NumericState of an inline string
+
+    // Payload access for STRING/STRNUM values (always NUL-terminated)
+    bool heap_string() const { return inline_size_ == HEAP_STRING; }
+    const char* string_data() const { return heap_string() ? heap_->data() : inline_; }
+    size_t string_size() const { return heap_string() ? heap_->size : inline_size_; }
+    std::string_view text() const { return std::string_view(string_data(), string_size()); }
+
+    // True if destruction has to free something
+    bool owns_heap() const {
+        return type_ == ValueType::ARRAY || type_ == ValueType::REGEX ||
+               ((type_ == ValueType::STRING || type_ == ValueType::STRNUM) && heap_string());
+    }
 
-    // Helper functions
-    void copy_from(const AWKValue& other);
-    void move_from(AWKValue&& other) noexcept;
+    // Frees the payload and leaves the value UNINITIALIZED
+    void release() noexcept;
 
-    // Convert string to number (AWK semantics)
-    static double string_to_number(const std::string& str);
+    // Moves other's payload into this value (whose payload must already be
+    // released) and leaves other UNINITIALIZED
+    void take(AWKValue& other) noexcept;
 
-    // Check if string is numeric
-    static bool looks_numeric(const std::string& str);
+    // Stores a string payload (the current payload must already be released)
+    void set_string(const char* text, size_t size, ValueType type);
+
+    // NumericState of a STRING/STRNUM value, parsing the text on first use
+    NumericState numeric_state() const {
+        NumericState state = static_cast<NumericState>(heap_string() ? heap_->numeric : numeric_);
+        return state != NUMERIC_UNPARSED ? state : parse_number();
+    }
 
-    // Convert number to string
-    static std::string number_to_string(double num, const std::string& format = "%.6g");
+    // Converts the text and fills the cache
+    NumericState parse_number() const;
+
+    // Check if string is numeric; str is NUL-terminated
+    static bool text_looks_numeric(const char* str);
+
+    // Convert number to string: integral values as integers, others with
+    // format (CONVFMT or OFMT). The result replaces out's contents.
+    static void number_to_string(double num, const std::string& format, std::string& out);
 };
 
 // ============================================================================
 // Inline implementations for performance
 // ============================================================================
 
-inline AWKValue::AWKValue() : type_(ValueType::UNINITIALIZED), number_value_(0.0) {}
+inline AWKValue::AWKValue() : number_(0.0), inline_size_(0), type_(ValueType::UNINITIALIZED) {}
 
-inline AWKValue::AWKValue(double num) : type_(ValueType::NUMBER), number_value_(num) {}
+inline AWKValue::AWKValue(double num) : number_(num), inline_size_(0), type_(ValueType::NUMBER) {}
 
-inline AWKValue::AWKValue(int num) : type_(ValueType::NUMBER), number_value_(static_cast<double>(num)) {}
+inline AWKValue::AWKValue(int num)
+    : number_(static_cast<double>(num)), inline_size_(0), type_(ValueType::NUMBER) {}
 
-inline AWKValue::AWKValue(long long num) : type_(ValueType::NUMBER), number_value_(static_cast<double>(num)) {}
+inline AWKValue::AWKValue(long long num)
+    : number_(static_cast<double>(num)), inline_size_(0), type_(ValueType::NUMBER) {}
 
 inline AWKValue::AWKValue(const char* str) : AWKValue(std::string(str)) {}
 
 inline double AWKValue::to_number() const {
     switch (type_) {
         case ValueType::NUMBER:
-            return number_value_;
+            return number_;
         case ValueType::UNINITIALIZED:
             return 0.0;
         case ValueType::STRING:
         case ValueType::STRNUM:
-            return string_to_number(string_value_);
+            numeric_state();
+            return heap_string() ? heap_->number : number_;
         case ValueType::ARRAY:
         case ValueType::REGEX:
             return 0.0;
@@ -246,17 +367,22 @@ inline double AWKValue::to_number() const {
     return 0.0;
 }
 
+inline bool AWKValue::looks_numeric() const {
+    return (type_ == ValueType::STRING || type_ == ValueType::STRNUM) &&
+           numeric_state() == NUMERIC_STRING;
+}
+
 inline bool AWKValue::to_bool() const {
     switch (type_) {
         case ValueType::NUMBER:
-            return number_value_ != 0.0;
+            return number_ != 0.0;
         case ValueType::UNINITIALIZED:
             return false;
         case ValueType::STRING:
         case ValueType::STRNUM:
-            return !string_value_.empty();
+            return string_size() != 0;
         case ValueType::ARRAY:
-            return array_value_ && !array_value_->empty();
+            return array_size() != 0;
         case ValueType::REGEX:
             return true;
     }
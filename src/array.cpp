@@ -0,0 +1,578 @@
+// ============================================================================
+// array.cpp - Insertion-ordered open-addressing hash table for AWK arrays
+// ============================================================================
+
+#include "awk/array.hpp"
+#include "awk/simd_scan.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+namespace awk {
+
+namespace {
+
+// ============================================================================
+// Control Byte Groups
+// ============================================================================
+//
+// A group is GROUP_SIZE control bytes loaded as one 64-bit word; byte i of
+// the group corresponds to bits 8i..8i+7. The match functions return a mask
+// with the high bit of each selected byte set.
+
+constexpr uint64_t LSBS = 0x0101010101010101ull;
+constexpr uint64_t MSBS = 0x8080808080808080ull;
+
+inline uint64_t load_group(const uint8_t* control) {
+    uint64_t group;
+    std::memcpy(&group, control, sizeof(group));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    group = __builtin_bswap64(group);
+#endif
+    return group;
+}
+
+// Bytes equal to h2. May report a false positive next to a true match;
+// callers compare the entry anyway.
+inline uint64_t match_byte(uint64_t group, uint8_t h2) {
+    uint64_t x = group ^ (LSBS * h2);
+    return (x - LSBS) & ~x & MSBS;
+}
+
+// EMPTY (0x80) is the only control value with bit 7 set and bit 1 clear
+inline uint64_t match_empty(uint64_t group) {
+    return group & ~(group << 6) & MSBS;
+}
+
+// EMPTY and DELETED are the only control values with bit 7 set and bit 0 clear
+inline uint64_t match_empty_or_deleted(uint64_t group) {
+    return group & ~(group << 7) & MSBS;
+}
+
+inline size_t byte_index(uint64_t mask) {
+    return simd::count_trailing_zeros(mask) / 8;
+}
+
+// Top 7 bits of the hash go to the control byte, the low bits pick the group
+inline uint8_t h2_of(uint32_t hash) {
+    return static_cast<uint8_t>(hash >> 25);
+}
+
+inline uint64_t load_word(const char* p, size_t n) {
+    uint64_t word = 0;
+    std::memcpy(&word, p, n);
+    return word;
+}
+
+// Key comparison for find_slot: plain keys and TupleKeys
+inline bool key_equals(std::string_view stored, std::string_view key) { return stored == key; }
+inline bool key_equals(std::string_view stored, const TupleKey& key) { return key.equals(stored); }
+
+inline std::string key_string(std::string_view key) { return std::string(key); }
+inline std::string key_string(const TupleKey& key) { return key.join(); }
+
+// ============================================================================
+// Hashing
+// ============================================================================
+//
+// 8 bytes per multiply, then a final avalanche (MurmurHash3 fmix64). The
+// hasher takes the key in pieces and buffers partial words, so a TupleKey
+// hashes exactly like its joined string.
+
+class Hasher {
+public:
+    explicit Hasher(size_t size) : h_(size * K) {}
+
+    void update(const char* p, size_t n) {
+        if (pending_ > 0) {
+            size_t take = std::min(n, 8 - pending_);
+            std::memcpy(buffer_ + pending_, p, take);
+            pending_ += take;
+            p += take;
+            n -= take;
+            if (pending_ < 8) {
+                return;
+            }
+            mix(load_word(buffer_, 8));
+            pending_ = 0;
+        }
+        for (; n >= 8; p += 8, n -= 8) {
+            mix(load_word(p, 8));
+        }
+        std::memcpy(buffer_, p, n);
+        pending_ = n;
+    }
+
+    uint32_t finish() {
+        if (pending_ > 0) {
+            mix(load_word(buffer_, pending_));
+        }
+        uint64_t h = h_;
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDull;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ull;
+        h ^= h >> 33;
+        return static_cast<uint32_t>(h ^ (h >> 32));
+    }
+
+private:
+    static constexpr uint64_t K = 0x9E3779B97F4A7C15ull;
+
+    uint64_t h_;
+    char buffer_[8];
+    size_t pending_ = 0;
+
+    void mix(uint64_t word) {
+        h_ = (h_ ^ word) * K;
+        h_ ^= h_ >> 29;
+    }
+};
+
+} // namespace
+
+uint32_t AWKArray::hash(std::string_view key) {
+    Hasher hasher(key.size());
+    hasher.update(key.data(), key.size());
+    return hasher.finish();
+}
+
+uint32_t AWKArray::hash(const TupleKey& key) {
+    Hasher hasher(key.size());
+    for (size_t i = 0; i < key.count(); ++i) {
+        if (i > 0) {
+            hasher.update(key.subsep().data(), key.subsep().size());
+        }
+        hasher.update(key.part(i).data(), key.part(i).size());
+    }
+    return hasher.finish();
+}
+
+// ============================================================================
+// Tuple Keys
+// ============================================================================
+
+TupleKey::TupleKey(const AWKValue* values, size_t count, std::string_view subsep)
+    : count_(count), subsep_(subsep) {
+    for (size_t i = 0; i < count; ++i) {
+        parts_[i] = values[i].to_string_view(scratch_[i]);
+    }
+}
+
+size_t TupleKey::size() const {
+    size_t size = subsep_.size() * (count_ - 1);
+    for (size_t i = 0; i < count_; ++i) {
+        size += parts_[i].size();
+    }
+    return size;
+}
+
+std::string TupleKey::join() const {
+    std::string key;
+    key.reserve(size());
+    for (size_t i = 0; i < count_; ++i) {
+        if (i > 0) {
+            key += subsep_;
+        }
+        key += parts_[i];
+    }
+    return key;
+}
+
+bool TupleKey::equals(std::string_view key) const {
+    for (size_t i = 0; i < count_; ++i) {
+        if (i > 0) {
+            if (key.compare(0, subsep_.size(), subsep_) != 0) {
+                return false;
+            }
+            key.remove_prefix(subsep_.size());
+        }
+        if (key.compare(0, parts_[i].size(), parts_[i]) != 0) {
+            return false;
+        }
+        key.remove_prefix(parts_[i].size());
+    }
+    return key.empty();
+}
+
+// ============================================================================
+// Integer Keys
+// ============================================================================
+
+long long AWKArray::parse_index(std::string_view key) {
+    // Up to 18 digits cannot overflow
+    if (key.empty() || key.size() > 18 || key[0] == '0') {
+        return 0;
+    }
+    long long index = 0;
+    for (char c : key) {
+        if (c < '0' || c > '9') {
+            return 0;
+        }
+        index = index * 10 + (c - '0');
+    }
+    return index;
+}
+
+std::string_view AWKArray::format_index(long long index, char* buffer) {
+    auto result = std::to_chars(buffer, buffer + 20, index);
+    return std::string_view(buffer, static_cast<size_t>(result.ptr - buffer));
+}
+
+// ============================================================================
+// Probing
+// ============================================================================
+//
+// Groups are aligned to GROUP_SIZE and visited in triangular order (steps
+// of 1, 2, 3... groups), which covers every group of a power-of-two table.
+// A lookup stops at the first group with an EMPTY byte: an insertion would
+// have used that group.
+
+template <typename Key>
+size_t AWKArray::find_slot(const Key& key, uint32_t hash) const {
+    if (control_.empty()) {
+        return NOT_FOUND;
+    }
+    const size_t mask = control_.size() - 1;
+    const uint8_t h2 = h2_of(hash);
+    size_t pos = hash & mask & ~(GROUP_SIZE - 1);
+    for (size_t step = GROUP_SIZE;; step += GROUP_SIZE) {
+        uint64_t group = load_group(&control_[pos]);
+        for (uint64_t match = match_byte(group, h2); match; match &= match - 1) {
+            size_t slot = pos + byte_index(match);
+            const Entry& entry = entries_[slots_[slot]];
+            if (entry.hash == hash && key_equals(entry.key, key)) {
+                return slot;
+            }
+        }
+        if (match_empty(group)) {
+            return NOT_FOUND;
+        }
+        pos = (pos + step) & mask;
+    }
+}
+
+size_t AWKArray::find_free_slot(uint32_t hash) const {
+    const size_t mask = control_.size() - 1;
+    size_t pos = hash & mask & ~(GROUP_SIZE - 1);
+    for (size_t step = GROUP_SIZE;; step += GROUP_SIZE) {
+        uint64_t free = match_empty_or_deleted(load_group(&control_[pos]));
+        if (free) {
+            return pos + byte_index(free);
+        }
+        pos = (pos + step) & mask;
+    }
+}
+
+// ============================================================================
+// Element Access
+// ============================================================================
+
+AWKValue* AWKArray::find(std::string_view key) {
+    return const_cast<AWKValue*>(static_cast<const AWKArray*>(this)->find(key));
+}
+
+const AWKValue* AWKArray::find(std::string_view key) const {
+    if (!hashed_) {
+        long long index = parse_index(key);
+        return index > 0 && static_cast<size_t>(index) <= dense_.size() ? &dense_[index - 1] : nullptr;
+    }
+    size_t slot = find_slot(key, hash(key));
+    return slot == NOT_FOUND ? nullptr : &entries_[slots_[slot]].value;
+}
+
+AWKValue* AWKArray::find(long long index) {
+    if (!hashed_) {
+        return index > 0 && static_cast<size_t>(index) <= dense_.size() ? &dense_[index - 1] : nullptr;
+    }
+    char buffer[24];
+    return find(format_index(index, buffer));
+}
+
+const AWKValue& AWKArray::at(std::string_view key) const {
+    const AWKValue* value = find(key);
+    if (!value) {
+        throw std::out_of_range("AWKArray::at: no such element");
+    }
+    return *value;
+}
+
+AWKValue& AWKArray::operator[](std::string_view key) {
+    if (!hashed_) {
+        long long index = parse_index(key);
+        if (index > 0 && static_cast<size_t>(index) <= dense_.size() + 1) {
+            return (*this)[index];
+        }
+        convert_to_hashed();
+    }
+    return insert_hashed(key);
+}
+
+AWKValue& AWKArray::operator[](long long index) {
+    if (!hashed_) {
+        if (index > 0 && static_cast<size_t>(index) <= dense_.size()) {
+            return dense_[index - 1];
+        }
+        if (index > 0 && static_cast<size_t>(index) == dense_.size() + 1) {
+            dense_.emplace_back();
+            ++size_;
+            return dense_.back();
+        }
+        convert_to_hashed();
+    }
+    char buffer[24];
+    return insert_hashed(format_index(index, buffer));
+}
+
+template <typename Key>
+AWKValue& AWKArray::insert_hashed(const Key& key) {
+    uint32_t h = hash(key);
+    size_t slot = find_slot(key, h);
+    if (slot != NOT_FOUND) {
+        return entries_[slots_[slot]].value;
+    }
+
+    // Rebuild when the index is full, or when tombstones outnumber live
+    // entries (inserting moves entries anyway)
+    if (growth_left_ == 0 || (erased_ > size_ && cursors_ == 0)) {
+        rehash(size_ + 1);
+    }
+    slot = find_free_slot(h);
+    if (control_[slot] == EMPTY) {
+        --growth_left_;
+    }
+    control_[slot] = h2_of(h);
+    slots_[slot] = static_cast<uint32_t>(entries_.size());
+    entries_.push_back(Entry{key_string(key), AWKValue(), h, false});
+    ++size_;
+    return entries_.back().value;
+}
+
+size_t AWKArray::erase(std::string_view key) {
+    if (!hashed_) {
+        long long index = parse_index(key);
+        if (index <= 0 || static_cast<size_t>(index) > dense_.size()) {
+            return 0;
+        }
+        if (static_cast<size_t>(index) == dense_.size()) {
+            dense_.pop_back();
+            --size_;
+            return 1;
+        }
+        convert_to_hashed();
+    }
+
+    size_t slot = find_slot(key, hash(key));
+    if (slot == NOT_FOUND) {
+        return 0;
+    }
+    erase_slot(slot);
+    return 1;
+}
+
+AWKValue* AWKArray::find(const TupleKey& key) {
+    if (!hashed_) {
+        return find(key.join());  // Only dense while empty or keyed 1..n
+    }
+    size_t slot = find_slot(key, hash(key));
+    return slot == NOT_FOUND ? nullptr : &entries_[slots_[slot]].value;
+}
+
+AWKValue& AWKArray::operator[](const TupleKey& key) {
+    if (!hashed_) {
+        return (*this)[key.join()];
+    }
+    return insert_hashed(key);
+}
+
+size_t AWKArray::erase(const TupleKey& key) {
+    if (!hashed_) {
+        return erase(key.join());
+    }
+    size_t slot = find_slot(key, hash(key));
+    if (slot == NOT_FOUND) {
+        return 0;
+    }
+    erase_slot(slot);
+    return 1;
+}
+
+void AWKArray::erase_slot(size_t slot) {
+    Entry& entry = entries_[slots_[slot]];
+    entry.erased = true;
+    std::string().swap(entry.key);
+    entry.value = AWKValue();
+    --size_;
+    ++erased_;
+
+    if (size_ == 0) {
+        clear();
+        return;
+    }
+
+    // Lookups stop at a group with an EMPTY byte, so if this group has one
+    // no probe sequence continues past it and the slot can be EMPTY again
+    size_t group = slot & ~(GROUP_SIZE - 1);
+    if (match_empty(load_group(&control_[group]))) {
+        control_[slot] = EMPTY;
+        ++growth_left_;
+    } else {
+        control_[slot] = DELETED;
+    }
+}
+
+void AWKArray::clear() {
+    ++generation_;
+    hashed_ = false;
+    std::vector<AWKValue>().swap(dense_);
+    std::vector<Entry>().swap(entries_);
+    std::vector<uint8_t>().swap(control_);
+    std::vector<uint32_t>().swap(slots_);
+    size_ = 0;
+    erased_ = 0;
+    growth_left_ = 0;
+}
+
+void AWKArray::reserve(size_t count) {
+    if (!hashed_) {
+        dense_.reserve(count);
+        return;
+    }
+    if (count > size_ + growth_left_) {
+        rehash(count);
+    }
+    entries_.reserve(count + erased_);
+}
+
+// ============================================================================
+// Rebuilding
+// ============================================================================
+
+void AWKArray::rehash(size_t count) {
+    // Drop tombstones, keeping the order of live entries; open cursors
+    // hold positions in entries_, so then they stay
+    if (erased_ > 0 && cursors_ == 0) {
+        size_t out = 0;
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            if (!entries_[i].erased) {
+                if (out != i) {
+                    entries_[out] = std::move(entries_[i]);
+                }
+                ++out;
+            }
+        }
+        entries_.resize(out);
+        erased_ = 0;
+    }
+
+    // Room for twice the requested count at a maximum load of 7/8, so a
+    // rebuild is followed by as many insertions as it had entries
+    size_t capacity = MIN_CAPACITY;
+    while (capacity / 8 * 7 < count * 2) {
+        capacity *= 2;
+    }
+
+    control_.assign(capacity, EMPTY);
+    slots_.assign(capacity, 0);
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        if (entries_[i].erased) {
+            continue;
+        }
+        size_t slot = find_free_slot(entries_[i].hash);
+        control_[slot] = h2_of(entries_[i].hash);
+        slots_[slot] = static_cast<uint32_t>(i);
+    }
+    growth_left_ = capacity / 8 * 7 - size_;
+}
+
+void AWKArray::convert_to_hashed() {
+    hashed_ = true;
+    entries_.reserve(dense_.size());
+    char buffer[24];
+    for (size_t i = 0; i < dense_.size(); ++i) {
+        std::string_view key = format_index(static_cast<long long>(i + 1), buffer);
+        entries_.push_back(Entry{std::string(key), std::move(dense_[i]), hash(key), false});
+    }
+    std::vector<AWKValue>().swap(dense_);
+    rehash(entries_.size());
+}
+
+// ============================================================================
+// Cursors
+// ============================================================================
+
+ArrayCursor::ArrayCursor(AWKValue& array) {
+    if (!array.is_array()) {
+        return;
+    }
+    array_ = array;
+    table_ = &array_.as_array();
+    end_ = table_->hashed_ ? table_->entries_.size() : table_->dense_.size();
+    generation_ = table_->generation_;
+    ++table_->cursors_;
+}
+
+ArrayCursor::ArrayCursor(ArrayCursor&& other) noexcept
+    : array_(std::move(other.array_)),
+      table_(other.table_),
+      position_(other.position_),
+      end_(other.end_),
+      generation_(other.generation_) {
+    other.table_ = nullptr;
+}
+
+ArrayCursor& ArrayCursor::operator=(ArrayCursor&& other) noexcept {
+    if (this != &other) {
+        close();
+        array_ = std::move(other.array_);
+        table_ = other.table_;
+        position_ = other.position_;
+        end_ = other.end_;
+        generation_ = other.generation_;
+        other.table_ = nullptr;
+    }
+    return *this;
+}
+
+ArrayCursor::~ArrayCursor() {
+    close();
+}
+
+void ArrayCursor::close() {
+    if (table_) {
+        --table_->cursors_;
+        table_ = nullptr;
+    }
+}
+
+bool ArrayCursor::next(std::string_view& key) {
+    if (!table_) {
+        return false;
+    }
+    AWKArray& table = *table_;
+    if (table.generation_ == generation_) {
+        // A dense array that became hashed kept its elements' positions;
+        // deleting its last elements only shortens it
+        if (!table.hashed_) {
+            if (position_ < std::min(end_, table.dense_.size())) {
+                ++position_;
+                key = AWKArray::format_index(static_cast<long long>(position_), buffer_);
+                return true;
+            }
+        } else {
+            size_t end = std::min(end_, table.entries_.size());
+            while (position_ < end) {
+                AWKArray::Entry& entry = table.entries_[position_++];
+                if (!entry.erased) {
+                    key = entry.key;
+                    return true;
+                }
+            }
+        }
+    }
+    close();
+    return false;
+}
+
+} // namespace awk
@@ -0,0 +1,834 @@
+// ============================================================================
+// compiler.cpp - AST to Bytecode Compiler
+// ============================================================================
+//
+// Lowers the AST into the stack bytecode executed by Interpreter::run_chunk.
+// Constructs whose semantics are tied to the tree walker (getline, the
+// lvalue-taking built-ins, indirect calls, SYMTAB/FUNCTAB) are compiled to
+// EVAL_EXPR / EXEC_STMT, which hand the node back to the tree walker.
+
+#include "awk/bytecode.hpp"
+
+namespace awk {
+
+namespace {
+
+// Built-ins that need lvalue access to their arguments
+bool is_lvalue_builtin(const std::string& name) {
+    return name == "sub" || name == "gsub" || name == "split" ||
+           name == "match" || name == "patsplit" ||
+           name == "asort" || name == "asorti";
+}
+
+bool is_special_array(const std::string& name) {
+    return name == "SYMTAB" || name == "FUNCTAB";
+}
+
+// Map a compound assignment operator to its arithmetic opcode
+OpCode arithmetic_op(TokenType op) {
+    switch (op) {
+        case TokenType::PLUS:
+        case TokenType::PLUS_ASSIGN:    return OpCode::ADD;
+        case TokenType::MINUS:
+        case TokenType::MINUS_ASSIGN:   return OpCode::SUB;
+        case TokenType::STAR:
+        case TokenType::STAR_ASSIGN:    return OpCode::MUL;
+        case TokenType::SLASH:
+        case TokenType::SLASH_ASSIGN:   return OpCode::DIV;
+        case TokenType::PERCENT:
+        case TokenType::PERCENT_ASSIGN: return OpCode::MOD;
+        case TokenType::CARET:
+        case TokenType::CARET_ASSIGN:   return OpCode::POW;
+        default:                        return OpCode::HALT;
+    }
+}
+
+} // anonymous namespace
+
+Compiler::Compiler(Environment& env) : env_(env) {}
+
+// ============================================================================
+// Program
+// ============================================================================
+
+std::unique_ptr<CompiledProgram> Compiler::compile(Program& program) {
+    auto compiled = std::make_unique<CompiledProgram>();
+    program_ = compiled.get();
+
+    // Index functions first so that calls can be resolved in any order
+    compiled->functions.resize(program.functions.size());
+    for (size_t i = 0; i < program.functions.size(); ++i) {
+        FunctionDef* func = program.functions[i].get();
+        compiled->function_defs.push_back(func);
+        compiled->function_index[func] = i;
+    }
+
+    for (size_t i = 0; i < program.functions.size(); ++i) {
+        compile_chunk(compiled->functions[i], program.functions[i]->body.get(), true);
+    }
+
+    compiled->rules.resize(program.rules.size());
+    for (size_t i = 0; i < program.rules.size(); ++i) {
+        Rule& rule = *program.rules[i];
+        CompiledRule& out = compiled->rules[i];
+
+        switch (rule.pattern.type) {
+            case PatternType::EXPRESSION:
+            case PatternType::REGEX:
+                compile_pattern(out.pattern, rule.pattern.expr.get());
+                break;
+            case PatternType::RANGE:
+                compile_pattern(out.pattern, rule.pattern.expr.get());
+                compile_pattern(out.range_end, rule.pattern.range_end.get());
+                break;
+            default:
+                break;
+        }
+
+        if (rule.action) {
+            compile_chunk(out.action, rule.action.get(), false);
+        }
+    }
+
+    program_ = nullptr;
+    return compiled;
+}
+
+void Compiler::compile_chunk(Chunk& chunk, Stmt* body, bool is_function) {
+    chunk_ = &chunk;
+    contexts_.clear();
+    temps_ = 0;
+    iters_ = 0;
+
+    if (body) {
+        compile(*body);
+    }
+    emit(is_function ? OpCode::RETURN : OpCode::HALT, 0);
+    chunk_ = nullptr;
+}
+
+void Compiler::compile_pattern(Chunk& chunk, Expr* expr) {
+    chunk_ = &chunk;
+
+    // A bare regex as a pattern matches against $0
+    if (expr->kind == ExprKind::REGEX) {
+        emit(OpCode::MATCH_RECORD, add_regex(static_cast<RegexExpr&>(*expr)));
+    } else {
+        compile(*expr);
+    }
+    emit(OpCode::RETURN, 1);
+    chunk_ = nullptr;
+}
+
+// ============================================================================
+// Statements
+// ============================================================================
+
+void Compiler::compile(Stmt& stmt) {
+    switch (stmt.kind) {
+        case StmtKind::EXPR:
+            compile(*static_cast<ExprStmt&>(stmt).expression);
+            emit(OpCode::POP);
+            break;
+        case StmtKind::PRINT:
+            compile_print(static_cast<PrintStmt&>(stmt));
+            break;
+        case StmtKind::PRINTF:
+            compile_printf(static_cast<PrintfStmt&>(stmt));
+            break;
+        case StmtKind::BLOCK:
+            for (auto& s : static_cast<BlockStmt&>(stmt).statements) {
+                compile(*s);
+            }
+            break;
+        case StmtKind::IF:
+            compile_if(static_cast<IfStmt&>(stmt));
+            break;
+        case StmtKind::WHILE:
+            compile_while(static_cast<WhileStmt&>(stmt));
+            break;
+        case StmtKind::DO_WHILE:
+            compile_do_while(static_cast<DoWhileStmt&>(stmt));
+            break;
+        case StmtKind::FOR:
+            compile_for(static_cast<ForStmt&>(stmt));
+            break;
+        case StmtKind::FOR_IN:
+            compile_for_in(static_cast<ForInStmt&>(stmt));
+            break;
+        case StmtKind::SWITCH:
+            compile_switch(static_cast<SwitchStmt&>(stmt));
+            break;
+        case StmtKind::BREAK:
+            compile_break(stmt, false);
+            break;
+        case StmtKind::CONTINUE:
+            compile_break(stmt, true);
+            break;
+        case StmtKind::NEXT:
+            emit(OpCode::NEXT);
+            break;
+        case StmtKind::NEXTFILE:
+            emit(OpCode::NEXTFILE);
+            break;
+        case StmtKind::EXIT: {
+            auto& exit_stmt = static_cast<ExitStmt&>(stmt);
+            if (exit_stmt.status) {
+                compile(*exit_stmt.status);
+            }
+            emit(OpCode::EXIT, exit_stmt.status ? 1 : 0);
+            break;
+        }
+        case StmtKind::RETURN: {
+            auto& ret = static_cast<ReturnStmt&>(stmt);
+            if (ret.value) {
+                compile(*ret.value);
+            }
+            emit(OpCode::RETURN, ret.value ? 1 : 0);
+            break;
+        }
+        case StmtKind::DELETE:
+            compile_delete(static_cast<DeleteStmt&>(stmt));
+            break;
+    }
+}
+
+void Compiler::compile_print(PrintStmt& stmt) {
+    if (stmt.output_redirect) {
+        compile(*stmt.output_redirect);
+    }
+    for (auto& arg : stmt.arguments) {
+        compile(*arg);
+    }
+    emit(OpCode::PRINT, static_cast<int32_t>(stmt.arguments.size()),
+         static_cast<int32_t>(stmt.redirect_type));
+}
+
+void Compiler::compile_printf(PrintfStmt& stmt) {
+    if (stmt.output_redirect) {
+        compile(*stmt.output_redirect);
+    }
+    compile(*stmt.format);
+    for (auto& arg : stmt.arguments) {
+        compile(*arg);
+    }
+    emit(OpCode::PRINTF, static_cast<int32_t>(stmt.arguments.size() + 1),
+         static_cast<int32_t>(stmt.redirect_type));
+}
+
+void Compiler::compile_if(IfStmt& stmt) {
+    compile(*stmt.condition);
+    size_t to_else = emit(OpCode::JUMP_IF_FALSE);
+    compile(*stmt.then_branch);
+
+    if (stmt.else_branch) {
+        size_t to_end = emit(OpCode::JUMP);
+        patch(to_else);
+        compile(*stmt.else_branch);
+        patch(to_end);
+    } else {
+        patch(to_else);
+    }
+}
+
+void Compiler::compile_while(WhileStmt& stmt) {
+    JumpContext ctx;
+    ctx.break_temps = ctx.continue_temps = temps_;
+    ctx.break_iters = ctx.continue_iters = iters_;
+    contexts_.push_back(ctx);
+
+    size_t loop_start = here();
+    compile(*stmt.condition);
+    size_t to_exit = emit(OpCode::JUMP_IF_FALSE);
+    compile(*stmt.body);
+    emit(OpCode::JUMP, static_cast<int32_t>(loop_start));
+    patch(to_exit);
+
+    JumpContext done = std::move(contexts_.back());
+    contexts_.pop_back();
+    for (size_t at : done.break_jumps) patch(at);
+    for (size_t at : done.continue_jumps) chunk_->code[at].a = static_cast<int32_t>(loop_start);
+}
+
+void Compiler::compile_do_while(DoWhileStmt& stmt) {
+    JumpContext ctx;
+    ctx.break_temps = ctx.continue_temps = temps_;
+    ctx.break_iters = ctx.continue_iters = iters_;
+    contexts_.push_back(ctx);
+
+    size_t body_start = here();
+    compile(*stmt.body);
+
+    // continue re-evaluates the condition
+    size_t condition_start = here();
+    compile(*stmt.condition);
+    emit(OpCode::JUMP_IF_TRUE, static_cast<int32_t>(body_start));
+
+    JumpContext done = std::move(contexts_.back());
+    contexts_.pop_back();
+    for (size_t at : done.break_jumps) patch(at);
+    for (size_t at : done.continue_jumps) chunk_->code[at].a = static_cast<int32_t>(condition_start);
+}
+
+void Compiler::compile_for(ForStmt& stmt) {
+    if (stmt.init) {
+        compile(*stmt.init);
+    }
+
+    JumpContext ctx;
+    ctx.break_temps = ctx.continue_temps = temps_;
+    ctx.break_iters = ctx.continue_iters = iters_;
+    contexts_.push_back(ctx);
+
+    size_t loop_start = here();
+    size_t to_exit = 0;
+    if (stmt.condition) {
+        compile(*stmt.condition);
+        to_exit = emit(OpCode::JUMP_IF_FALSE);
+    }
+    compile(*stmt.body);
+
+    // continue runs the update expression
+    size_t update_start = here();
+    if (stmt.update) {
+        compile(*stmt.update);
+        emit(OpCode::POP);
+    }
+    emit(OpCode::JUMP, static_cast<int32_t>(loop_start));
+    if (stmt.condition) {
+        patch(to_exit);
+    }
+
+    JumpContext done = std::move(contexts_.back());
+    contexts_.pop_back();
+    for (size_t at : done.break_jumps) patch(at);
+    for (size_t at : done.continue_jumps) chunk_->code[at].a = static_cast<int32_t>(update_start);
+}
+
+void Compiler::compile_for_in(ForInStmt& stmt) {
+    if (is_special_array(stmt.array_name)) {
+        delegate(stmt);
+        return;
+    }
+
+    JumpContext ctx;
+    ctx.break_temps = ctx.continue_temps = temps_;
+    ctx.break_iters = iters_;        // break drops this loop's iterator
+    ctx.continue_iters = iters_ + 1;
+    contexts_.push_back(ctx);
+
+    emit(OpCode::FORIN_BEGIN, add_var(stmt.array_name, stmt.array_ref));
+    ++iters_;
+
+    // FORIN_NEXT drops the iterator itself once the keys are exhausted
+    size_t loop_start = emit(OpCode::FORIN_NEXT, add_var(stmt.variable, stmt.variable_ref));
+    compile(*stmt.body);
+    emit(OpCode::JUMP, static_cast<int32_t>(loop_start));
+    --iters_;
+    chunk_->code[loop_start].b = static_cast<int32_t>(here());
+
+    JumpContext done = std::move(contexts_.back());
+    contexts_.pop_back();
+    for (size_t at : done.break_jumps) patch(at);
+    for (size_t at : done.continue_jumps) chunk_->code[at].a = static_cast<int32_t>(loop_start);
+}
+
+void Compiler::compile_switch(SwitchStmt& stmt) {
+    // The switch value stays on the stack while the cases are tested
+    compile(*stmt.expression);
+    ++temps_;
+
+    JumpContext ctx;
+    ctx.is_switch = true;
+    ctx.break_temps = temps_;  // Breaking jumps to the POP of the switch value
+    ctx.break_iters = iters_;
+    contexts_.push_back(ctx);
+
+    std::vector<size_t> to_body;
+    for (auto& [case_expr, case_body] : stmt.cases) {
+        emit(OpCode::DUP);
+        compile(*case_expr);
+        emit(OpCode::EQ);
+        to_body.push_back(emit(OpCode::JUMP_IF_TRUE));
+    }
+    size_t no_match = emit(OpCode::JUMP);
+
+    // Case bodies fall through into each other
+    for (size_t i = 0; i < stmt.cases.size(); ++i) {
+        patch(to_body[i]);
+        compile(*stmt.cases[i].second);
+    }
+
+    if (stmt.default_case) {
+        size_t to_end = emit(OpCode::JUMP);
+        patch(no_match);
+        compile(*stmt.default_case);
+        patch(to_end);
+    } else {
+        patch(no_match);
+    }
+
+    JumpContext done = std::move(contexts_.back());
+    contexts_.pop_back();
+    for (size_t at : done.break_jumps) patch(at);
+
+    emit(OpCode::POP);
+    --temps_;
+}
+
+void Compiler::compile_break(Stmt& stmt, bool is_continue) {
+    // Find the innermost construct that accepts this statement
+    JumpContext* target = nullptr;
+    for (auto it = contexts_.rbegin(); it != contexts_.rend(); ++it) {
+        if (!is_continue || !it->is_switch) {
+            target = &*it;
+            break;
+        }
+    }
+
+    if (!target) {
+        // Outside of any loop: keep the tree walker's behaviour
+        delegate(stmt);
+        return;
+    }
+
+    // Unwind switch values and for-in iterators of the constructs being left
+    size_t keep_temps = is_continue ? target->continue_temps : target->break_temps;
+    size_t keep_iters = is_continue ? target->continue_iters : target->break_iters;
+    for (size_t i = keep_temps; i < temps_; ++i) {
+        emit(OpCode::POP);
+    }
+    for (size_t i = keep_iters; i < iters_; ++i) {
+        emit(OpCode::FORIN_END);
+    }
+
+    size_t jump = emit(OpCode::JUMP);
+    if (is_continue) {
+        target->continue_jumps.push_back(jump);
+    } else {
+        target->break_jumps.push_back(jump);
+    }
+}
+
+void Compiler::compile_delete(DeleteStmt& stmt) {
+    int32_t name = add_var(stmt.array_name, stmt.array_ref);
+    if (stmt.indices.empty()) {
+        emit(OpCode::DELETE_ARRAY, name);
+    } else {
+        compile_keys(stmt.indices);
+        emit(OpCode::DELETE_ELEM, name, static_cast<int32_t>(stmt.indices.size()));
+    }
+}
+
+// ============================================================================
+// Expressions
+// ============================================================================
+
+void Compiler::compile(Expr& expr) {
+    switch (expr.kind) {
+        case ExprKind::LITERAL: {
+            auto& lit = static_cast<LiteralExpr&>(expr);
+            emit(OpCode::PUSH_CONST, add_constant(lit.is_number() ? AWKValue(lit.as_number())
+                                                                  : AWKValue(lit.as_string())));
+            break;
+        }
+        case ExprKind::REGEX: {
+            // Compiled once here instead of on every evaluation
+            AWKValue regex;
+            regex.set_regex(static_cast<RegexExpr&>(expr).pattern);
+            emit(OpCode::PUSH_CONST, add_constant(std::move(regex)));
+            break;
+        }
+        case ExprKind::VARIABLE: {
+            auto& var = static_cast<VariableExpr&>(expr);
+            emit(OpCode::LOAD_VAR, add_var(var.name, var.ref));
+            break;
+        }
+        case ExprKind::FIELD:
+            compile(*static_cast<FieldExpr&>(expr).index);
+            emit(OpCode::LOAD_FIELD);
+            break;
+        case ExprKind::ARRAY_ACCESS: {
+            auto& access = static_cast<ArrayAccessExpr&>(expr);
+            if (is_special_array(access.name)) {
+                delegate(expr);
+                break;
+            }
+            compile_keys(access.indices);
+            emit(OpCode::LOAD_ELEM, add_var(access.name, access.ref),
+                 static_cast<int32_t>(access.indices.size()));
+            break;
+        }
+        case ExprKind::BINARY:
+            compile_binary(static_cast<BinaryExpr&>(expr));
+            break;
+        case ExprKind::UNARY:
+            compile_unary(static_cast<UnaryExpr&>(expr));
+            break;
+        case ExprKind::TERNARY: {
+            auto& ternary = static_cast<TernaryExpr&>(expr);
+            compile(*ternary.condition);
+            size_t to_else = emit(OpCode::JUMP_IF_FALSE);
+            compile(*ternary.then_expr);
+            size_t to_end = emit(OpCode::JUMP);
+            patch(to_else);
+            compile(*ternary.else_expr);
+            patch(to_end);
+            break;
+        }
+        case ExprKind::ASSIGN:
+            compile_assign(static_cast<AssignExpr&>(expr));
+            break;
+        case ExprKind::CALL:
+            compile_call(static_cast<CallExpr&>(expr));
+            break;
+        case ExprKind::MATCH: {
+            auto& match = static_cast<MatchExpr&>(expr);
+            compile(*match.string);
+            if (match.regex->kind == ExprKind::REGEX) {
+                emit(OpCode::MATCH_REGEX, add_regex(static_cast<RegexExpr&>(*match.regex)),
+                     match.negated ? 1 : 0);
+                break;
+            }
+            compile(*match.regex);
+            emit(match.negated ? OpCode::NOT_MATCH : OpCode::MATCH);
+            break;
+        }
+        case ExprKind::CONCAT: {
+            auto& concat = static_cast<ConcatExpr&>(expr);
+            for (auto& part : concat.parts) {
+                compile(*part);
+            }
+            emit(OpCode::CONCAT, static_cast<int32_t>(concat.parts.size()));
+            break;
+        }
+        case ExprKind::IN: {
+            auto& in = static_cast<InExpr&>(expr);
+            if (is_special_array(in.array_name)) {
+                delegate(expr);
+                break;
+            }
+            compile_keys(in.keys);
+            emit(OpCode::IN_ARRAY, add_var(in.array_name, in.array_ref), static_cast<int32_t>(in.keys.size()));
+            break;
+        }
+        case ExprKind::UPDATE:
+            compile_update(static_cast<UpdateExpr&>(expr));
+            break;
+        case ExprKind::INDIRECT_CALL:
+        case ExprKind::GETLINE:
+            delegate(expr);
+            break;
+    }
+}
+
+void Compiler::compile_binary(BinaryExpr& expr) {
+    // Short-circuit operators always yield 0 or 1
+    if (expr.op == TokenType::AND || expr.op == TokenType::OR) {
+        bool is_and = expr.op == TokenType::AND;
+        OpCode test = is_and ? OpCode::JUMP_IF_FALSE : OpCode::JUMP_IF_TRUE;
+        compile(*expr.left);
+        size_t short_left = emit(test);
+        compile(*expr.right);
+        size_t short_right = emit(test);
+        emit(OpCode::PUSH_CONST, add_constant(AWKValue(is_and ? 1.0 : 0.0)));
+        size_t to_end = emit(OpCode::JUMP);
+        patch(short_left);
+        patch(short_right);
+        emit(OpCode::PUSH_CONST, add_constant(AWKValue(is_and ? 0.0 : 1.0)));
+        patch(to_end);
+        return;
+    }
+
+    compile(*expr.left);
+    compile(*expr.right);
+
+    switch (expr.op) {
+        case TokenType::PLUS:    emit(OpCode::ADD); break;
+        case TokenType::MINUS:   emit(OpCode::SUB); break;
+        case TokenType::STAR:    emit(OpCode::MUL); break;
+        case TokenType::SLASH:   emit(OpCode::DIV); break;
+        case TokenType::PERCENT: emit(OpCode::MOD); break;
+        case TokenType::CARET:   emit(OpCode::POW); break;
+        case TokenType::EQ:      emit(OpCode::EQ); break;
+        case TokenType::NE:      emit(OpCode::NE); break;
+        case TokenType::LT:      emit(OpCode::LT); break;
+        case TokenType::GT:      emit(OpCode::GT); break;
+        case TokenType::LE:      emit(OpCode::LE); break;
+        case TokenType::GE:      emit(OpCode::GE); break;
+        default:
+            // Unknown operator: discard operands like the tree walker
+            emit(OpCode::POP);
+            emit(OpCode::POP);
+            emit(OpCode::PUSH_UNINIT);
+            break;
+    }
+}
+
+void Compiler::compile_unary(UnaryExpr& expr) {
+    switch (expr.op) {
+        case TokenType::NOT:
+            // !/regex/ tests $0
+            if (expr.operand->kind == ExprKind::REGEX) {
+                emit(OpCode::MATCH_RECORD, add_regex(static_cast<RegexExpr&>(*expr.operand)));
+            } else {
+                compile(*expr.operand);
+            }
+            emit(OpCode::NOT);
+            return;
+        case TokenType::MINUS:
+            compile(*expr.operand);
+            emit(OpCode::NEG);
+            return;
+        case TokenType::PLUS:
+            compile(*expr.operand);
+            emit(OpCode::PLUS);
+            return;
+        case TokenType::INCREMENT:
+        case TokenType::DECREMENT:
+            break;
+        default:
+            emit(OpCode::PUSH_UNINIT);
+            return;
+    }
+
+    int32_t flags = (expr.op == TokenType::DECREMENT ? INCR_DECREMENT : 0) |
+                    (expr.prefix ? 0 : INCR_POSTFIX);
+    Expr& operand = *expr.operand;
+
+    switch (operand.kind) {
+        case ExprKind::VARIABLE: {
+            auto& var = static_cast<VariableExpr&>(operand);
+            emit(OpCode::INCR_VAR, add_var(var.name, var.ref), flags);
+            return;
+        }
+        case ExprKind::FIELD:
+            compile(*static_cast<FieldExpr&>(operand).index);
+            emit(OpCode::INCR_FIELD, 0, flags);
+            return;
+        case ExprKind::ARRAY_ACCESS: {
+            auto& access = static_cast<ArrayAccessExpr&>(operand);
+            if (is_special_array(access.name)) {
+                break;
+            }
+            compile_keys(access.indices);
+            emit(OpCode::INCR_ELEM, add_var(access.name, access.ref),
+                 static_cast<int32_t>(access.indices.size()) | (flags << 16));
+            return;
+        }
+        default:
+            break;
+    }
+    delegate(expr);
+}
+
+void Compiler::compile_assign(AssignExpr& expr) {
+    Expr& target = *expr.target;
+
+    // var = var ... appends in place (see Interpreter::evaluate(AssignExpr&))
+    if (expr.op == TokenType::ASSIGN && target.kind == ExprKind::VARIABLE &&
+        expr.value->kind == ExprKind::CONCAT) {
+        auto& var = static_cast<VariableExpr&>(target);
+        auto& concat = static_cast<ConcatExpr&>(*expr.value);
+        if (!concat.parts.empty() && concat.parts[0]->kind == ExprKind::VARIABLE &&
+            static_cast<VariableExpr&>(*concat.parts[0]).name == var.name) {
+            int32_t slot = add_var(var.name, var.ref);
+            for (size_t i = 1; i < concat.parts.size(); ++i) {
+                compile(*concat.parts[i]);
+                emit(OpCode::APPEND_VAR, slot);
+            }
+            emit(OpCode::LOAD_VAR, slot);  // Shares the string, no copy
+            return;
+        }
+    }
+
+    bool plain = expr.op == TokenType::ASSIGN;
+    OpCode arith = arithmetic_op(expr.op);
+    if (!plain && arith == OpCode::HALT) {
+        delegate(expr);
+        return;
+    }
+
+    switch (target.kind) {
+        case ExprKind::VARIABLE: {
+            auto& var = static_cast<VariableExpr&>(target);
+            int32_t name = add_var(var.name, var.ref);
+            compile(*expr.value);
+            if (plain) {
+                emit(OpCode::STORE_VAR, name);
+            } else {
+                emit(OpCode::AUG_VAR, name, static_cast<int32_t>(arith));
+            }
+            return;
+        }
+        case ExprKind::FIELD:
+            // The value is evaluated before the field index
+            compile(*expr.value);
+            compile(*static_cast<FieldExpr&>(target).index);
+            if (plain) {
+                emit(OpCode::STORE_FIELD);
+            } else {
+                emit(OpCode::AUG_FIELD, 0, static_cast<int32_t>(arith));
+            }
+            return;
+        case ExprKind::ARRAY_ACCESS: {
+            auto& access = static_cast<ArrayAccessExpr&>(target);
+            if (is_special_array(access.name)) {
+                break;
+            }
+            int32_t name = add_var(access.name, access.ref);
+            int32_t count = static_cast<int32_t>(access.indices.size());
+            compile(*expr.value);
+            compile_keys(access.indices);
+            if (plain) {
+                emit(OpCode::STORE_ELEM, name, count);
+            } else {
+                emit(OpCode::AUG_ELEM, name, count | (static_cast<int32_t>(arith) << 16));
+            }
+            return;
+        }
+        default:
+            break;
+    }
+    delegate(expr);
+}
+
+void Compiler::compile_update(UpdateExpr& expr) {
+    // ++ and -- have their own instructions; other updates are op=
+    bool step = !expr.value;
+    int32_t flags = (expr.op == TokenType::MINUS ? INCR_DECREMENT : 0) |
+                    (expr.postfix ? INCR_POSTFIX : 0);
+    int32_t arith = static_cast<int32_t>(arithmetic_op(expr.op));
+    if (!step) {
+        compile(*expr.value);
+    }
+
+    if (expr.target->kind == ExprKind::VARIABLE) {
+        auto& var = static_cast<VariableExpr&>(*expr.target);
+        int32_t name = add_var(var.name, var.ref);
+        emit(step ? OpCode::INCR_VAR : OpCode::AUG_VAR, name, step ? flags : arith);
+        return;
+    }
+
+    auto& access = static_cast<ArrayAccessExpr&>(*expr.target);
+    int32_t count = static_cast<int32_t>(access.indices.size());
+    compile_keys(access.indices);
+    emit(step ? OpCode::INCR_ELEM : OpCode::AUG_ELEM, add_var(access.name, access.ref),
+         count | ((step ? flags : arith) << 16));
+}
+
+void Compiler::compile_call(CallExpr& expr) {
+    const std::string& name = expr.function_name;
+    if (is_lvalue_builtin(name)) {
+        delegate(expr);
+        return;
+    }
+
+    for (auto& arg : expr.arguments) {
+        compile(*arg);
+    }
+    int32_t argc = static_cast<int32_t>(expr.arguments.size());
+
+    // Same lookup order as Interpreter::call_function: built-in (qualified,
+    // then unqualified), then user-defined function
+    const BuiltinFunction* builtin = env_.find_builtin(name);
+    size_t sep_pos = name.find("::");
+    if (!builtin && sep_pos != std::string::npos) {
+        builtin = env_.find_builtin(name.substr(sep_pos + 2));
+    }
+    if (builtin) {
+        chunk_->builtins.push_back(builtin);
+        emit(OpCode::CALL_BUILTIN, static_cast<int32_t>(chunk_->builtins.size() - 1), argc);
+        return;
+    }
+
+    // Plain variables may be uninitialized and become arrays in the callee
+    std::vector<int32_t> vars;
+    bool has_vars = false;
+    for (auto& arg : expr.arguments) {
+        if (arg->kind == ExprKind::VARIABLE) {
+            auto& var = static_cast<VariableExpr&>(*arg);
+            vars.push_back(add_var(var.name, var.ref));
+            has_vars = true;
+        } else {
+            vars.push_back(-1);
+        }
+    }
+    if (has_vars) {
+        chunk_->call_args.push_back(std::move(vars));
+        argc |= static_cast<int32_t>(chunk_->call_args.size()) << 16;
+    }
+
+    for (size_t i = 0; i < program_->function_defs.size(); ++i) {
+        if (program_->function_defs[i]->name == name) {
+            emit(OpCode::CALL_USER, static_cast<int32_t>(i), argc);
+            return;
+        }
+    }
+
+    // Unknown at compile time: resolve (and report) when called
+    emit(OpCode::CALL_NAMED, add_name(name), argc);
+}
+
+void Compiler::compile_keys(std::vector<ExprPtr>& keys) {
+    for (auto& key : keys) {
+        compile(*key);
+    }
+}
+
+// ============================================================================
+// Emission Helpers
+// ============================================================================
+
+size_t Compiler::emit(OpCode op, int32_t a, int32_t b) {
+    chunk_->code.push_back(Instruction{op, a, b});
+    return chunk_->code.size() - 1;
+}
+
+void Compiler::patch(size_t at) {
+    chunk_->code[at].a = static_cast<int32_t>(here());
+}
+
+int32_t Compiler::add_constant(AWKValue value) {
+    chunk_->constants.push_back(std::move(value));
+    return static_cast<int32_t>(chunk_->constants.size() - 1);
+}
+
+int32_t Compiler::add_name(const std::string& name) {
+    auto& names = chunk_->names;
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (names[i] == name) {
+            return static_cast<int32_t>(i);
+        }
+    }
+    names.push_back(name);
+    return static_cast<int32_t>(names.size() - 1);
+}
+
+int32_t Compiler::add_regex(RegexExpr& regex) {
+    chunk_->regexes.push_back(&regex);
+    return static_cast<int32_t>(chunk_->regexes.size() - 1);
+}
+
+int32_t Compiler::add_var(const std::string& name, const VarRef& ref) {
+    auto& vars = chunk_->vars;
+    for (size_t i = 0; i < vars.size(); ++i) {
+        if (vars[i].name == name) {
+            return static_cast<int32_t>(i);
+        }
+    }
+    vars.push_back(ChunkVar{name, ref});
+    return static_cast<int32_t>(vars.size() - 1);
+}
+
+void Compiler::delegate(Expr& expr) {
+    chunk_->exprs.push_back(&expr);
+    emit(OpCode::EVAL_EXPR, static_cast<int32_t>(chunk_->exprs.size() - 1));
+}
+
+void Compiler::delegate(Stmt& stmt) {
+    chunk_->stmts.push_back(&stmt);
+    emit(OpCode::EXEC_STMT, static_cast<int32_t>(chunk_->stmts.size() - 1));
+}
+
+} // namespace awk
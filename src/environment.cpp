@@ -13,6 +13,16 @@ extern char** environ;
 namespace awk {
 
 Environment::Environment() {
+    // Special variables get the fixed slots of the SpecialVar enum
+    static const char* const special_names[SPECIAL_VAR_COUNT] = {
+        "FS", "RS", "OFS", "ORS", "NR", "NF", "FNR", "FILENAME", "SUBSEP",
+        "CONVFMT", "OFMT", "RSTART", "RLENGTH", "ARGC", "ARGV", "ENVIRON",
+        "IGNORECASE", "RT", "FPAT", "TEXTDOMAIN"
+    };
+    for (const char* name : special_names) {
+        global_slot(name);
+    }
+
     init_builtins();
 }
 
@@ -21,12 +31,10 @@ Environment::Environment() {
 // ============================================================================
 
 AWKValue& Environment::get_variable(const std::string& name) {
-    // First search in local scopes (from inner to outer)
-    for (auto it = scope_stack_.rbegin(); it != scope_stack_.rend(); ++it) {
-        auto var_it = it->find(name);
-        if (var_it != it->end()) {
-            return var_it->second;
-        }
+    // Locals of the current function (AWK scoping is lexical: a function
+    // never sees the locals of its caller)
+    if (AWKValue* local_var = find_local(name)) {
+        return *local_var;
     }
 
     // Check if name is namespace-qualified (contains ::)
@@ -34,87 +42,95 @@ AWKValue& Environment::get_variable(const std::string& name) {
     if (sep_pos != std::string::npos) {
         std::string unqualified = name.substr(sep_pos + 2);
 
-        // Also check local scopes with unqualified name
+        // Also check local scope with unqualified name
         // (function parameters are stored without namespace prefix)
-        for (auto it = scope_stack_.rbegin(); it != scope_stack_.rend(); ++it) {
-            auto var_it = it->find(unqualified);
-            if (var_it != it->end()) {
-                return var_it->second;
-            }
+        if (AWKValue* local_var = find_local(unqualified)) {
+            return *local_var;
         }
 
-        // Check if unqualified name is a special built-in variable
-        auto it = globals_.find(unqualified);
-        if (it != globals_.end()) {
-            // Only fall back for special AWK variables (not user-defined)
-            if (is_special_variable(unqualified)) {
-                return it->second;
+        // Only fall back for special AWK variables (not user-defined)
+        if (is_special_variable(unqualified)) {
+            auto it = global_index_.find(unqualified);
+            if (it != global_index_.end()) {
+                return global_slots_[it->second];
             }
         }
     }
 
     // Search in global variables (creates if needed)
-    return globals_[name];
+    return global_by_name(name);
 }
 
 void Environment::set_variable(const std::string& name, AWKValue value) {
-    // If in a scope, check if variable exists there
-    for (auto it = scope_stack_.rbegin(); it != scope_stack_.rend(); ++it) {
-        auto var_it = it->find(name);
-        if (var_it != it->end()) {
-            var_it->second = std::move(value);
-            return;
-        }
-    }
-
-    // Otherwise set globally
-    globals_[name] = std::move(value);
+    get_variable(name) = std::move(value);
 }
 
 bool Environment::has_variable(const std::string& name) const {
-    // Search in scopes
-    for (auto it = scope_stack_.rbegin(); it != scope_stack_.rend(); ++it) {
-        if (it->find(name) != it->end()) {
-            return true;
+    if (!frames_.empty()) {
+        for (const auto& param : frames_.back().function->parameters) {
+            if (param == name) {
+                return true;
+            }
         }
     }
-
-    // Search in global variables
-    return globals_.find(name) != globals_.end();
+    return global_index_.find(name) != global_index_.end();
 }
 
 void Environment::delete_variable(const std::string& name) {
-    // Only delete from global variables
-    globals_.erase(name);
+    // Slots are never reused, so the variable is only reset
+    auto it = global_index_.find(name);
+    if (it != global_index_.end()) {
+        global_slots_[it->second] = AWKValue();
+    }
+}
+
+uint32_t Environment::global_slot(const std::string& name) {
+    auto it = global_index_.find(name);
+    if (it != global_index_.end()) {
+        return it->second;
+    }
+    uint32_t slot = static_cast<uint32_t>(global_slots_.size());
+    global_slots_.emplace_back();
+    global_index_.emplace(name, slot);
+    return slot;
 }
 
 // ============================================================================
-// Scope Management
+// Call Frames
 // ============================================================================
 
-void Environment::push_scope() {
-    scope_stack_.emplace_back();
-}
-
-void Environment::pop_scope() {
-    if (!scope_stack_.empty()) {
-        scope_stack_.pop_back();
+void Environment::push_frame(const FunctionDef& func, std::vector<AWKValue>& args) {
+    size_t base = frame_top_;
+    size_t count = func.parameters.size();
+    frame_top_ += count;
+    while (frame_values_.size() < frame_top_) {
+        frame_values_.emplace_back();
     }
-}
 
-AWKValue& Environment::get_local(const std::string& name) {
-    if (scope_stack_.empty()) {
-        return globals_[name];
+    // Extra arguments are ignored (AWK allows more arguments than parameters)
+    for (size_t i = 0; i < count; ++i) {
+        if (i < args.size()) {
+            frame_values_[base + i] = std::move(args[i]);
+        } else {
+            frame_values_[base + i] = AWKValue();
+        }
     }
-    return scope_stack_.back()[name];
+
+    frames_.push_back({&func, base});
 }
 
-void Environment::set_local(const std::string& name, AWKValue value) {
-    if (scope_stack_.empty()) {
-        globals_[name] = std::move(value);
-    } else {
-        scope_stack_.back()[name] = std::move(value);
+AWKValue* Environment::find_local(const std::string& name) {
+    if (frames_.empty()) {
+        return nullptr;
     }
+    const Frame& frame = frames_.back();
+    const auto& params = frame.function->parameters;
+    for (size_t i = 0; i < params.size(); ++i) {
+        if (params[i] == name) {
+            return &frame_values_[frame.base + i];
+        }
+    }
+    return nullptr;
 }
 
 // ============================================================================
@@ -139,8 +155,8 @@ bool Environment::has_function(const std::string& name) const {
 
 std::vector<std::string> Environment::get_all_variable_names() const {
     std::vector<std::string> names;
-    names.reserve(globals_.size());
-    for (const auto& [name, value] : globals_) {
+    names.reserve(global_index_.size());
+    for (const auto& [name, slot] : global_index_) {
         names.push_back(name);
     }
     return names;
@@ -170,6 +186,11 @@ BuiltinFunction Environment::get_builtin(const std::string& name) {
     return nullptr;
 }
 
+const BuiltinFunction* Environment::find_builtin(const std::string& name) const {
+    auto it = builtin_functions_.find(name);
+    return it != builtin_functions_.end() ? &it->second : nullptr;
+}
+
 bool Environment::has_builtin(const std::string& name) const {
     return builtin_functions_.find(name) != builtin_functions_.end();
 }
@@ -180,44 +201,44 @@ bool Environment::has_builtin(const std::string& name) const {
 
 void Environment::init_builtins() {
     // Field/Record Separators
-    globals_["FS"] = AWKValue(" ");
-    globals_["RS"] = AWKValue("\n");
-    globals_["OFS"] = AWKValue(" ");
-    globals_["ORS"] = AWKValue("\n");
+    FS() = AWKValue(" ");
+    RS() = AWKValue("\n");
+    OFS() = AWKValue(" ");
+    ORS() = AWKValue("\n");
 
     // Counters
-    globals_["NR"] = AWKValue(0);
-    globals_["NF"] = AWKValue(0);
-    globals_["FNR"] = AWKValue(0);
+    NR() = AWKValue(0);
+    NF() = AWKValue(0);
+    FNR() = AWKValue(0);
 
     // Filename
-    globals_["FILENAME"] = AWKValue("");
+    FILENAME() = AWKValue("");
 
     // Array subscript separator (SUBSEP = 034 = 0x1C = FS)
-    globals_["SUBSEP"] = AWKValue(std::string(1, '\034'));
+    SUBSEP() = AWKValue(std::string(1, '\034'));
 
     // Format strings
-    globals_["CONVFMT"] = AWKValue("%.6g");
-    globals_["OFMT"] = AWKValue("%.6g");
+    CONVFMT() = AWKValue("%.6g");
+    OFMT() = AWKValue("%.6g");
 
     // Match results
-    globals_["RSTART"] = AWKValue(0);
-    globals_["RLENGTH"] = AWKValue(0);
+    RSTART() = AWKValue(0);
+    RLENGTH() = AWKValue(0);
 
     // Case-insensitive matching (gawk extension)
-    globals_["IGNORECASE"] = AWKValue(0);
+    IGNORECASE() = AWKValue(0);
 
     // Record terminator (gawk extension) - the actual separator found
-    globals_["RT"] = AWKValue("");
+    RT() = AWKValue("");
 
     // Field pattern (gawk extension) - alternative to FS (empty = disabled)
-    globals_["FPAT"] = AWKValue("");
+    FPAT() = AWKValue("");
 
     // Text domain for i18n (gawk extension) - default is "messages"
-    globals_["TEXTDOMAIN"] = AWKValue("messages");
+    TEXTDOMAIN() = AWKValue("messages");
 
     // Arguments
-    globals_["ARGC"] = AWKValue(0);
+    ARGC() = AWKValue(0);
     // ARGV is created as array when needed
 
     // Load environment variables
@@ -225,7 +246,7 @@ void Environment::init_builtins() {
 }
 
 void Environment::load_environ() {
-    AWKValue& env_array = globals_["ENVIRON"];
+    AWKValue& env_array = ENVIRON();
 
     if (environ != nullptr) {
         for (char** env = environ; *env != nullptr; ++env) {
@@ -241,9 +262,9 @@ void Environment::load_environ() {
 }
 
 void Environment::set_argv(const std::vector<std::string>& args) {
-    globals_["ARGC"] = AWKValue(static_cast<double>(args.size()));
+    ARGC() = AWKValue(static_cast<double>(args.size()));
 
-    AWKValue& argv_array = globals_["ARGV"];
+    AWKValue& argv_array = ARGV();
     for (size_t i = 0; i < args.size(); ++i) {
         argv_array.array_access(std::to_string(i)) = AWKValue(args[i]);
     }
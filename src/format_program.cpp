@@ -0,0 +1,285 @@
+// ============================================================================
+// format_program.cpp - Compiled printf/sprintf formats
+// ============================================================================
+
+#include "awk/format_program.hpp"
+#include "awk/number_conv.hpp"
+#include <cmath>
+#include <cstdio>
+
+namespace awk {
+
+namespace {
+
+// Appends snprintf(spec, value) to out, however long the result is
+template <typename T>
+void append_printf(std::string& out, const char* spec, T value) {
+    constexpr size_t GUESS = 64;
+    size_t start = out.size();
+    out.resize(start + GUESS);
+    int written = std::snprintf(&out[start], GUESS + 1, spec, value);
+    if (written < 0) {
+        out.resize(start);
+        return;
+    }
+    size_t length = static_cast<size_t>(written);
+    if (length > GUESS) {
+        out.resize(start + length);
+        std::snprintf(&out[start], length + 1, spec, value);
+    }
+    out.resize(start + length);
+}
+
+// Appends text right-justified in width (left-justified with '-'); with
+// '0' the padding goes between the sign and the digits
+void append_padded(std::string& out, std::string_view text, int width, bool left, bool zero) {
+    size_t fill = width > 0 && static_cast<size_t>(width) > text.size()
+        ? static_cast<size_t>(width) - text.size() : 0;
+    if (fill == 0) {
+        out.append(text);
+    } else if (left) {
+        out.append(text);
+        out.append(fill, ' ');
+    } else if (zero) {
+        if (!text.empty() && (text[0] == '-' || text[0] == '+' || text[0] == ' ')) {
+            out += text[0];
+            text.remove_prefix(1);
+        }
+        out.append(fill, '0');
+        out.append(text);
+    } else {
+        out.append(fill, ' ');
+        out.append(text);
+    }
+}
+
+bool is_integer_conversion(char conv) {
+    return conv == 'd' || conv == 'i' || conv == 'o' || conv == 'x' || conv == 'X' || conv == 'u';
+}
+
+// Appends the decimal digits of value to spec
+void append_number(std::string& spec, int value) {
+    char digits[numconv::INTEGER_DIGITS];
+    spec.append(digits, numconv::format_integer(value, digits));
+}
+
+} // namespace
+
+FormatProgram::FormatProgram(std::string_view format) : source_(format) {
+    std::string literal;
+    auto flush_literal = [&]() {
+        if (!literal.empty()) {
+            Op op;
+            op.text = std::move(literal);
+            ops_.push_back(std::move(op));
+            literal.clear();
+        }
+    };
+    auto is_digit = [](char c) { return c >= '0' && c <= '9'; };
+
+    size_t i = 0;
+    size_t n = format.size();
+    while (i < n) {
+        if (format[i] != '%') {
+            literal += format[i++];
+            continue;
+        }
+
+        i++;  // Skip %
+
+        if (i >= n) {
+            literal += '%';
+            break;
+        }
+
+        if (format[i] == '%') {
+            literal += '%';
+            i++;
+            continue;
+        }
+
+        Op op;
+        size_t spec_start = i - 1;
+
+        // Flags (-+ #0)
+        while (i < n && (format[i] == '-' || format[i] == '+' || format[i] == ' ' ||
+                         format[i] == '#' || format[i] == '0')) {
+            switch (format[i++]) {
+                case '-': op.left = true; break;
+                case '0': op.zero = true; break;
+                default: op.other_flags = true; break;
+            }
+        }
+
+        // Width (number or * for dynamic)
+        if (i < n && format[i] == '*') {
+            op.width_arg = true;
+            i++;
+        } else {
+            while (i < n && is_digit(format[i])) {
+                op.width = op.width * 10 + (format[i++] - '0');
+            }
+        }
+
+        // Precision (.number or .* for dynamic)
+        if (i < n && format[i] == '.') {
+            i++;
+            if (i < n && format[i] == '*') {
+                op.precision_arg = true;
+                i++;
+            } else {
+                op.precision = 0;
+                while (i < n && is_digit(format[i])) {
+                    op.precision = op.precision * 10 + (format[i++] - '0');
+                }
+            }
+        }
+
+        // A spec cut off by the end of the format prints nothing
+        if (i >= n) break;
+        op.conv = format[i++];
+        op.text.assign(format.substr(spec_start, i - 1 - spec_start));
+        if (is_integer_conversion(op.conv)) {
+            op.text += "ll";  // The value is passed as a long long
+        }
+        op.text += op.conv;
+
+        flush_literal();
+        ops_.push_back(std::move(op));
+    }
+    flush_literal();
+}
+
+void FormatProgram::run(const AWKValue* args, size_t count, std::string& out) const {
+    size_t next = 0;
+    for (const Op& op : ops_) {
+        if (op.conv == 0) {
+            out += op.text;
+        } else {
+            format_conversion(op, args, count, next, out);
+        }
+    }
+}
+
+void FormatProgram::format_conversion(const Op& op, const AWKValue* args, size_t count,
+                                      size_t& next, std::string& out) const {
+    static const AWKValue missing;
+
+    int width = op.width;
+    int precision = op.precision;
+    bool left = op.left;
+    if (op.width_arg) {
+        width = next < count ? static_cast<int>(args[next++].to_number()) : 0;
+        if (width < 0) {
+            left = true;
+            width = -width;
+        }
+    }
+    if (op.precision_arg) {
+        precision = next < count ? static_cast<int>(args[next++].to_number()) : 0;
+        if (precision < 0) {
+            precision = -1;  // As if omitted
+        }
+    }
+    const AWKValue& arg = next < count ? args[next++] : missing;
+
+    // Spec for snprintf, with '*' replaced by the values taken
+    std::string dynamic_spec;
+    auto spec = [&]() -> const char* {
+        if (!op.width_arg && !op.precision_arg) {
+            return op.text.c_str();
+        }
+        dynamic_spec = "%";
+        if (left) dynamic_spec += '-';
+        for (char c : op.text) {
+            if (c == '+' || c == ' ' || c == '#' || c == '0') {
+                dynamic_spec += c;
+            } else if (c != '%' && c != '-') {
+                break;
+            }
+        }
+        if (width > 0) append_number(dynamic_spec, width);
+        if (precision >= 0) {
+            dynamic_spec += '.';
+            append_number(dynamic_spec, precision);
+        }
+        if (is_integer_conversion(op.conv)) {
+            dynamic_spec += "ll";
+        }
+        dynamic_spec += op.conv;
+        return dynamic_spec.c_str();
+    };
+
+    switch (op.conv) {
+        case 'd':
+        case 'i': {
+            long long value = static_cast<long long>(arg.to_number());
+            if (precision < 0 && !op.other_flags) {
+                char digits[numconv::INTEGER_DIGITS];
+                char* end = numconv::format_integer(value, digits);
+                append_padded(out, std::string_view(digits, static_cast<size_t>(end - digits)),
+                              width, left, op.zero);
+            } else {
+                append_printf(out, spec(), value);
+            }
+            break;
+        }
+        case 'o':
+        case 'x':
+        case 'X':
+        case 'u':
+            append_printf(out, spec(), static_cast<unsigned long long>(arg.to_number()));
+            break;
+        case 'e':
+        case 'f':
+        case 'g': {
+            double value = arg.to_number();
+            if (!op.other_flags && std::isfinite(value)) {
+                // The bare "%.Nc" conversion, padded here
+                char core[16] = {'%', '.'};
+                char* end = numconv::format_integer(precision < 0 ? 6 : precision, core + 2);
+                end[0] = op.conv;
+                end[1] = '\0';
+                char buffer[64];
+                size_t length = numconv::format_double(value, core, buffer, sizeof(buffer));
+                if (length < sizeof(buffer)) {
+                    append_padded(out, std::string_view(buffer, length), width, left, op.zero);
+                    break;
+                }
+            }
+            append_printf(out, spec(), value);
+            break;
+        }
+        case 'E':
+        case 'F':
+        case 'G':
+            append_printf(out, spec(), arg.to_number());
+            break;
+        case 'c': {
+            std::string scratch;
+            std::string_view text = arg.to_string_view(scratch);
+            if (!text.empty()) {
+                out += text[0];
+            }
+            break;
+        }
+        case 's': {
+            std::string scratch;
+            std::string_view text = arg.to_string_view(scratch);
+            if (!op.zero) {
+                if (precision >= 0 && static_cast<size_t>(precision) < text.size()) {
+                    text = text.substr(0, static_cast<size_t>(precision));
+                }
+                append_padded(out, text, width, left, false);
+            } else {
+                append_printf(out, spec(), std::string(text).c_str());
+            }
+            break;
+        }
+        default:
+            out += op.conv;
+            break;
+    }
+}
+
+} // namespace awk
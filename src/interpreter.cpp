@@ -3,12 +3,13 @@
 // ============================================================================
 
 #include "awk/interpreter.hpp"
+#include "awk/resolver.hpp"
+#include "awk/simd_scan.hpp"
 #include "awk/i18n.hpp"
 #include "awk/platform.hpp"
-#include <sstream>
+#include <cctype>
 #include <cmath>
 #include <algorithm>
-#include <regex>
 #include <cstdio>
 #include <ctime>
 #include <random>
@@ -30,10 +31,26 @@ namespace awk {
 // Interpreter Implementation
 // ============================================================================
 
-Interpreter::Interpreter() {
+Interpreter::Interpreter()
+    : output_sink_(OutputSink::for_stream(std::cout)),
+      error_sink_(std::make_unique<OutputSink>(std::cerr)) {
+    error_sink_->set_line_buffered(true);
     register_builtins();
 }
 
+void Interpreter::set_output_stream(std::ostream& os) {
+    output_sink_->flush();
+    output_ = &os;
+    output_sink_ = OutputSink::for_stream(os);
+}
+
+void Interpreter::set_error_stream(std::ostream& os) {
+    error_sink_->flush();
+    error_ = &os;
+    error_sink_ = std::make_unique<OutputSink>(os);
+    error_sink_->set_line_buffered(true);
+}
+
 // ============================================================================
 // Cached Special Variable Accessors (Performance Optimization)
 // ============================================================================
@@ -99,6 +116,19 @@ void Interpreter::run(Program& program, const std::vector<std::string>& input_fi
         env_.register_function(func->name, func.get());
     }
 
+    // Assign storage slots to all variable references
+    Resolver resolver(env_);
+    resolver.resolve(program);
+
+    // Records are only split as far as the program looks
+    field_limit_ = resolver.field_demand().limit();
+
+    // Compile to bytecode when the VM engine is selected
+    if (engine_ == Engine::VM) {
+        Compiler compiler(env_);
+        compiled_ = compiler.compile(program);
+    }
+
     // Set ARGV
     std::vector<std::string> argv;
     argv.push_back("awk");  // ARGV[0]
@@ -109,167 +139,134 @@ void Interpreter::run(Program& program, const std::vector<std::string>& input_fi
 
     try {
         // Execute BEGIN rules
-        execute_begin_rules();
+        bool exited = execute_begin_rules() == Completion::EXIT;
 
         // Process files
-        if (input_files.empty()) {
+        if (exited) {
+            // Program end via exit in BEGIN
+        } else if (input_files.empty()) {
             // No files: read from stdin
             env_.FILENAME() = AWKValue("");
-            process_stream(std::cin, "");
+            exited = process_stream(stdin_reader(), "") == Completion::EXIT;
         } else {
             for (const auto& filename : input_files) {
                 try {
-                    process_file(filename);
+                    if (process_file(filename) == Completion::EXIT) {
+                        exited = true;
+                        break;
+                    }
                 } catch (const NextfileException&) {
-                    // Next file
+                    // nextfile inside a function: next file
                     continue;
                 }
             }
         }
 
         // Execute END rules
-        execute_end_rules();
+        if (!exited) {
+            execute_end_rules();
+        }
 
     } catch (const ExitException&) {
-        // Program end via exit()
-        // Status is ignored (could be used as return code)
+        // Program end via exit() inside a function
     }
+    // Status is ignored (could be used as return code)
+
+    // Our output comes before what the commands we piped to print on close
+    output_sink_->flush();
 
     // Close all open pipes and files
     cleanup_io();
 
+    compiled_.reset();
     current_program_ = nullptr;
 }
 
-void Interpreter::process_file(const std::string& filename) {
-    std::ifstream file(filename);
+Completion Interpreter::process_file(const std::string& filename) {
+    auto file = RecordReader::open(filename, mmap_input_);
     if (!file) {
         *error_ << "awk: can't open file " << filename << ": " << safe_strerror(errno) << "\n";
-        return;
+        return Completion::NORMAL;
     }
 
+    // $0 may point into the mapping: copy it out before the file is closed
+    struct RecordGuard {
+        Interpreter& interp;
+        ~RecordGuard() { interp.detach_record(); }
+    } guard{*this};
+
     env_.FILENAME() = AWKValue(filename);
     env_.FNR() = AWKValue(0);
 
-    execute_beginfile_rules();
-
-    process_stream(file, filename);
-
-    execute_endfile_rules();
+    // nextfile skips the rest of the file, including ENDFILE
+    Completion completion = execute_beginfile_rules();
+    if (completion == Completion::NORMAL) {
+        completion = process_stream(*file, filename);
+    }
+    if (completion == Completion::NORMAL) {
+        completion = execute_endfile_rules();
+    }
+    return completion == Completion::EXIT ? Completion::EXIT : Completion::NORMAL;
 }
 
-void Interpreter::process_stream(std::istream& input, [[maybe_unused]] const std::string& filename) {
+Completion Interpreter::process_stream(RecordReader& input, [[maybe_unused]] const std::string& filename) {
+    // Plain getline reads from the same input while the loop runs
+    struct MainInputGuard {
+        RecordReader*& slot;
+        RecordReader* saved;
+        ~MainInputGuard() { slot = saved; }
+    } guard{main_input_, main_input_};
+    main_input_ = &input;
+
     while (read_record(input)) {
+        Completion completion;
         try {
-            execute_main_rules();
+            completion = execute_main_rules();
         } catch (const NextException&) {
-            // Next record
+            // next inside a function: next record
             continue;
         }
-    }
-}
-
-// Helper: Read record in paragraph mode (RS = "")
-// Records are separated by one or more blank lines
-static bool read_record_paragraph_mode(std::istream& input, std::string& record, std::string& rt) {
-    record.clear();
-    std::string line;
-    bool found_content = false;
-
-    // Skip leading blank lines
-    while (std::getline(input, line)) {
-        if (!line.empty()) {
-            record = line;
-            found_content = true;
-            break;
+        if (completion == Completion::NEXTFILE || completion == Completion::EXIT) {
+            return completion;
         }
     }
-
-    if (!found_content) {
-        rt = "";  // EOF - no terminator
-        return false;
-    }
-
-    // Read more lines until blank line or EOF
-    while (std::getline(input, line)) {
-        if (line.empty()) {
-            rt = "\n";  // Blank line as terminator
-            return true;
-        }
-        record += "\n" + line;
-    }
-
-    rt = "";  // EOF as terminator
-    return true;
+    return Completion::NORMAL;
 }
 
-// Helper: Read record in line mode (RS = "\n")
-static bool read_record_line_mode(std::istream& input, std::string& record, std::string& rt) {
-    if (!std::getline(input, record)) {
-        rt = "";  // EOF
-        return false;
+void Interpreter::detach_record() {
+    if (current_record_.data() != record_storage_.data()) {
+        record_storage_.assign(current_record_.data(), current_record_.size());
+        current_record_ = record_storage_;
     }
-    rt = "\n";  // Newline as terminator
-    return true;
 }
 
-// Helper: Read record with single-character RS
-static bool read_record_single_char_mode(std::istream& input, std::string& record,
-                                          std::string& rt, char delimiter) {
-    record.clear();
-    char c;
-
-    while (input.get(c)) {
-        if (c == delimiter) {
-            rt = std::string(1, delimiter);
-            return true;
-        }
-        record += c;
-    }
-
-    if (record.empty() && input.eof()) {
-        rt = "";  // EOF
-        return false;
+RecordReader& Interpreter::stdin_reader() {
+    if (!stdin_reader_) {
+        stdin_reader_ = std::make_unique<RecordReader>(0);
     }
-
-    rt = "";  // EOF, no terminator found
-    return true;
+    return *stdin_reader_;
 }
 
-// Helper: Read record with multi-character RS (simplified)
-static bool read_record_multi_char_mode(std::istream& input, std::string& record, std::string& rt) {
-    // Simplified: just read lines (full regex RS would require more complex parsing)
-    if (!std::getline(input, record)) {
-        rt = "";  // EOF
-        return false;
-    }
-    rt = "\n";  // getline removes \n
-    return true;
-}
-
-bool Interpreter::read_record(std::istream& input) {
+bool Interpreter::read_record(RecordReader& input) {
     // Use cached RS for performance (frequently accessed, rarely changes)
     const std::string& rs = get_cached_rs();
-    std::string rt;
-    bool success;
-
-    if (rs.empty()) {
-        success = read_record_paragraph_mode(input, current_record_, rt);
-    } else if (rs == "\n") {
-        success = read_record_line_mode(input, current_record_, rt);
-    } else if (rs.length() == 1) {
-        success = read_record_single_char_mode(input, current_record_, rt, rs[0]);
-    } else {
-        success = read_record_multi_char_mode(input, current_record_, rt);
-    }
+    std::string_view record;
+    std::string_view rt;
 
-    if (!success) {
+    if (!input.read_record(rs, record, rt)) {
         env_.RT() = AWKValue("");
         return false;
     }
+    // Records of a mapped file stay valid until the file is done: no copy
+    if (input.mapped()) {
+        current_record_ = record;
+    } else {
+        record_storage_.assign(record.data(), record.size());
+        current_record_ = record_storage_;
+    }
 
     // Set RT variable (gawk extension)
-    env_.RT() = AWKValue(rt);
+    env_.RT() = AWKValue(std::string(rt));
 
     // Update counters
     double nr = env_.NR().to_number() + 1;
@@ -291,58 +288,80 @@ bool Interpreter::read_record(std::istream& input) {
 // Execute Rules
 // ============================================================================
 
-void Interpreter::execute_begin_rules() {
-    if (!current_program_) return;
+Completion Interpreter::execute_begin_rules() {
+    if (!current_program_) return Completion::NORMAL;
 
-    for (auto& rule : current_program_->rules) {
-        if (rule->pattern.type == PatternType::BEGIN) {
-            if (rule->action) {
-                execute(*rule->action);
+    auto& rules = current_program_->rules;
+    for (size_t i = 0; i < rules.size(); ++i) {
+        if (rules[i]->pattern.type == PatternType::BEGIN) {
+            if (rules[i]->action) {
+                Completion completion = execute_action(i);
+                if (completion == Completion::EXIT || completion == Completion::NEXTFILE) {
+                    return completion;
+                }
             }
         }
     }
+    return Completion::NORMAL;
 }
 
-void Interpreter::execute_end_rules() {
-    if (!current_program_) return;
+Completion Interpreter::execute_end_rules() {
+    if (!current_program_) return Completion::NORMAL;
 
-    for (auto& rule : current_program_->rules) {
-        if (rule->pattern.type == PatternType::END) {
-            if (rule->action) {
-                execute(*rule->action);
+    auto& rules = current_program_->rules;
+    for (size_t i = 0; i < rules.size(); ++i) {
+        if (rules[i]->pattern.type == PatternType::END) {
+            if (rules[i]->action) {
+                Completion completion = execute_action(i);
+                if (completion == Completion::EXIT || completion == Completion::NEXTFILE) {
+                    return completion;
+                }
             }
         }
     }
+    return Completion::NORMAL;
 }
 
-void Interpreter::execute_beginfile_rules() {
-    if (!current_program_) return;
+Completion Interpreter::execute_beginfile_rules() {
+    if (!current_program_) return Completion::NORMAL;
 
-    for (auto& rule : current_program_->rules) {
-        if (rule->pattern.type == PatternType::BEGINFILE) {
-            if (rule->action) {
-                execute(*rule->action);
+    auto& rules = current_program_->rules;
+    for (size_t i = 0; i < rules.size(); ++i) {
+        if (rules[i]->pattern.type == PatternType::BEGINFILE) {
+            if (rules[i]->action) {
+                Completion completion = execute_action(i);
+                if (completion == Completion::EXIT || completion == Completion::NEXTFILE) {
+                    return completion;
+                }
             }
         }
     }
+    return Completion::NORMAL;
 }
 
-void Interpreter::execute_endfile_rules() {
-    if (!current_program_) return;
+Completion Interpreter::execute_endfile_rules() {
+    if (!current_program_) return Completion::NORMAL;
 
-    for (auto& rule : current_program_->rules) {
-        if (rule->pattern.type == PatternType::ENDFILE) {
-            if (rule->action) {
-                execute(*rule->action);
+    auto& rules = current_program_->rules;
+    for (size_t i = 0; i < rules.size(); ++i) {
+        if (rules[i]->pattern.type == PatternType::ENDFILE) {
+            if (rules[i]->action) {
+                Completion completion = execute_action(i);
+                if (completion == Completion::EXIT || completion == Completion::NEXTFILE) {
+                    return completion;
+                }
             }
         }
     }
+    return Completion::NORMAL;
 }
 
-void Interpreter::execute_main_rules() {
-    if (!current_program_) return;
+Completion Interpreter::execute_main_rules() {
+    if (!current_program_) return Completion::NORMAL;
 
-    for (auto& rule : current_program_->rules) {
+    auto& rules = current_program_->rules;
+    for (size_t i = 0; i < rules.size(); ++i) {
+        Rule* rule = rules[i].get();
         if (rule->pattern.type == PatternType::BEGIN ||
             rule->pattern.type == PatternType::END ||
             rule->pattern.type == PatternType::BEGINFILE ||
@@ -350,61 +369,82 @@ void Interpreter::execute_main_rules() {
             continue;
         }
 
-        if (pattern_matches(rule->pattern)) {
+        const CompiledRule* compiled = compiled_ ? &compiled_->rules[i] : nullptr;
+        if (pattern_matches(rule->pattern, compiled)) {
             if (rule->action) {
-                execute(*rule->action);
+                Completion completion = execute_action(i);
+                if (completion == Completion::NEXT || completion == Completion::NEXTFILE ||
+                    completion == Completion::EXIT) {
+                    return completion;
+                }
             } else {
                 // Default action: print $0
-                *output_ << current_record_ << env_.ORS().to_string();
+                rebuild_record();
+                output_sink_->write(current_record_);
+                output_sink_->write(get_cached_ors());
+                output_sink_->end_statement();
             }
         }
     }
+    return Completion::NORMAL;
+}
+
+Completion Interpreter::execute_action(size_t rule_index) {
+    if (compiled_) {
+        return run_chunk(compiled_->rules[rule_index].action);
+    }
+    return execute(*current_program_->rules[rule_index]->action);
 }
 
 // ============================================================================
 // Pattern Matching
 // ============================================================================
 
-bool Interpreter::pattern_matches(Pattern& pattern) {
+bool Interpreter::pattern_matches(Pattern& pattern, const CompiledRule* compiled) {
     switch (pattern.type) {
         case PatternType::EMPTY:
             return true;
 
         case PatternType::EXPRESSION:
+            if (compiled) return chunk_matches(compiled->pattern);
             return is_truthy(evaluate(*pattern.expr));
 
         case PatternType::REGEX: {
-            AWKValue regex_val = evaluate(*pattern.expr);
-            return regex_match(AWKValue(current_record_), regex_val);
+            if (compiled) return chunk_matches(compiled->pattern);
+            return match_record(static_cast<RegexExpr&>(*pattern.expr));
         }
 
         case PatternType::RANGE: {
             // Helper function to evaluate expression as pattern
             // If it's a RegexExpr, match against $0, otherwise evaluate as truthy
-            auto eval_range_expr = [this](Expr* expr) -> bool {
-                if (auto* regex_expr = dynamic_cast<RegexExpr*>(expr)) {
+            auto eval_range_expr = [this](Expr* expr, const Chunk* chunk) -> bool {
+                if (chunk) {
+                    return chunk_matches(*chunk);
+                }
+                if (expr->kind == ExprKind::REGEX) {
                     // Regex pattern: match against current line ($0)
-                    AWKValue regex_val = evaluate(*regex_expr);
-                    return regex_match(AWKValue(current_record_), regex_val);
+                    return match_record(static_cast<RegexExpr&>(*expr));
                 } else {
                     // Expression pattern: evaluate as truthy
                     return is_truthy(evaluate(*expr));
                 }
             };
+            const Chunk* start_chunk = compiled ? &compiled->pattern : nullptr;
+            const Chunk* end_chunk = compiled ? &compiled->range_end : nullptr;
 
             if (pattern.range_active) {
                 // Check if end pattern matches
-                bool end_matches = eval_range_expr(pattern.range_end.get());
+                bool end_matches = eval_range_expr(pattern.range_end.get(), end_chunk);
                 if (end_matches) {
                     pattern.range_active = false;
                 }
                 return true;  // Still in range
             } else {
                 // Check if start pattern matches
-                bool start_matches = eval_range_expr(pattern.expr.get());
+                bool start_matches = eval_range_expr(pattern.expr.get(), start_chunk);
                 if (start_matches) {
                     // Check if end matches simultaneously
-                    bool end_matches = eval_range_expr(pattern.range_end.get());
+                    bool end_matches = eval_range_expr(pattern.range_end.get(), end_chunk);
                     if (!end_matches) {
                         pattern.range_active = true;
                     }
@@ -438,7 +478,8 @@ AWKValue Interpreter::evaluate(CallExpr& expr) {
             if (!modify_record) {
                 // Third argument is the target variable
                 if (auto* var_expr = dynamic_cast<VariableExpr*>(expr.arguments[2].get())) {
-                    target_var = &env_.get_variable(var_expr->name);
+                    note_store(var_expr->ref);
+                    target_var = &variable(var_expr->name, var_expr->ref);
                     target_str = target_var->to_string();
                 } else if (auto* field_expr = dynamic_cast<FieldExpr*>(expr.arguments[2].get())) {
                     int idx = static_cast<int>(evaluate(*field_expr->index).to_number());
@@ -448,37 +489,17 @@ AWKValue Interpreter::evaluate(CallExpr& expr) {
                     target_str = evaluate(*expr.arguments[2]).to_string();
                 }
             } else {
-                target_str = current_record_;
+                target_str = std::string(current_record_);
             }
 
             try {
-                const std::regex& re = get_cached_regex(pattern);
-                std::string awk_replacement = convert_awk_replacement(replacement);
-
+                const Regex& re = get_cached_regex(pattern);
                 std::string result;
-                int count = 0;
-
-                if (expr.function_name == "sub") {
-                    result = std::regex_replace(target_str, re, awk_replacement,
-                                                std::regex_constants::format_first_only);
-                    count = (result != target_str) ? 1 : 0;
-                } else {  // gsub
-                    // Count replacements
-                    std::string::const_iterator searchStart(target_str.cbegin());
-                    std::smatch match;
-                    while (std::regex_search(searchStart, target_str.cend(), match, re)) {
-                        ++count;
-                        searchStart = match.suffix().first;
-                        if (match.length() == 0) {
-                            if (searchStart != target_str.cend()) ++searchStart;
-                            else break;
-                        }
-                    }
-                    result = std::regex_replace(target_str, re, awk_replacement);
-                }
+                size_t count = substitute(re, target_str, replacement, false,
+                                          expr.function_name == "sub" ? 1 : 0, result);
 
                 // Write result back
-                if (result != target_str) {
+                if (count > 0) {
                     if (modify_record) {
                         set_record(result);
                     } else if (target_var) {
@@ -491,7 +512,7 @@ AWKValue Interpreter::evaluate(CallExpr& expr) {
 
                 return AWKValue(static_cast<double>(count));
 
-            } catch (const std::regex_error& e) {
+            } catch (const RegexError& e) {
                 *error_ << "awk: " << expr.function_name << ": invalid regex '" << pattern << "': " << e.what() << "\n";
                 return AWKValue(0.0);
             }
@@ -521,12 +542,11 @@ AWKValue Interpreter::evaluate(CallExpr& expr) {
 
             std::vector<std::string> parts;
             if (fs.empty() || fs == " ") {
-                // Default behavior: whitespace separation
-                std::istringstream iss(str);
-                std::string part;
-                while (iss >> part) {
-                    parts.push_back(part);
-                }
+                // Default behavior: whitespace separation (same tokenizer as $1..$NF)
+                simd::for_each_word(simd::kernels(), str.data(), str.size(), [&](size_t start, size_t length) {
+                    parts.emplace_back(str, start, length);
+                    return true;
+                });
             } else if (fs.length() == 1) {
                 // Single character separator
                 std::string::size_type start = 0;
@@ -537,23 +557,30 @@ AWKValue Interpreter::evaluate(CallExpr& expr) {
                 }
                 parts.push_back(str.substr(start));
             } else {
-                // Regex separator - with cache
+                // Regex separator - with cache. Empty matches separate
+                // nothing; a trailing empty part is dropped.
                 try {
-                    const std::regex& re = get_cached_regex(fs);
-                    std::sregex_token_iterator it(str.begin(), str.end(), re, -1);
-                    std::sregex_token_iterator end;
-                    for (; it != end; ++it) {
-                        parts.push_back(*it);
+                    const Regex& re = get_cached_regex(fs);
+                    size_t start = 0;
+                    re.for_each_match(str, [&](Regex::Span match) {
+                        if (match.length() == 0) return true;
+                        parts.push_back(str.substr(start, match.begin - start));
+                        start = match.end;
+                        return true;
+                    });
+                    if (start < str.size()) {
+                        parts.push_back(str.substr(start));
                     }
-                } catch (const std::regex_error& e) {
+                } catch (const RegexError& e) {
                     *error_ << "awk: split: invalid regex separator '" << fs << "': " << e.what() << "\n";
                     return AWKValue(0.0);
                 }
             }
 
-            // Write parts to array (1-based)
+            // Write parts to array (1-based, so the array stays dense)
+            arr.as_array().reserve(parts.size());
             for (size_t i = 0; i < parts.size(); ++i) {
-                arr.array_access(std::to_string(i + 1)) = AWKValue(parts[i]);
+                arr.array_access(static_cast<long long>(i + 1)) = AWKValue(std::move(parts[i]));
             }
 
             return AWKValue(static_cast<double>(parts.size()));
@@ -576,12 +603,15 @@ AWKValue Interpreter::evaluate(CallExpr& expr) {
             }
 
             try {
-                const std::regex& re = get_cached_regex(pattern);
-                std::smatch match;
+                const Regex& re = get_cached_regex(pattern);
+                std::vector<Regex::Span> groups(1);
 
-                if (std::regex_search(str, match, re)) {
-                    int start = static_cast<int>(match.position()) + 1;
-                    int length = static_cast<int>(match.length());
+                // Subexpressions are only tracked when they are stored
+                bool found = array_name.empty() ? re.find(str, 0, groups[0])
+                                                : re.find_groups(str, 0, groups);
+                if (found) {
+                    int start = static_cast<int>(groups[0].begin) + 1;
+                    int length = static_cast<int>(groups[0].length());
 
                     env_.RSTART() = AWKValue(static_cast<double>(start));
                     env_.RLENGTH() = AWKValue(static_cast<double>(length));
@@ -590,8 +620,10 @@ AWKValue Interpreter::evaluate(CallExpr& expr) {
                     if (!array_name.empty()) {
                         AWKValue& arr = env_.get_variable(array_name);
                         arr.array_clear();
-                        for (size_t i = 0; i < match.size(); ++i) {
-                            arr.array_access(std::to_string(i)) = AWKValue(match[i].str());
+                        for (size_t i = 0; i < groups.size(); ++i) {
+                            arr.array_access(std::to_string(i)) = groups[i].matched()
+                                ? AWKValue(str.substr(groups[i].begin, groups[i].length()))
+                                : AWKValue("");
                         }
                     }
 
@@ -604,7 +636,7 @@ AWKValue Interpreter::evaluate(CallExpr& expr) {
                     }
                     return AWKValue(0.0);
                 }
-            } catch (const std::regex_error& e) {
+            } catch (const RegexError& e) {
                 *error_ << "awk: match: invalid regex '" << pattern << "': " << e.what() << "\n";
                 env_.RSTART() = AWKValue(0.0);
                 env_.RLENGTH() = AWKValue(-1.0);
@@ -643,34 +675,32 @@ AWKValue Interpreter::evaluate(CallExpr& expr) {
             }
 
             try {
-                const std::regex& re = get_cached_regex(pattern);
-                std::sregex_iterator it(str.begin(), str.end(), re);
-                std::sregex_iterator end;
+                const Regex& re = get_cached_regex(pattern);
 
                 int count = 0;
                 size_t last_end = 0;
-                while (it != end) {
+                re.for_each_match(str, [&](Regex::Span match) {
                     // Store separator (before this match)
                     if (!seps_name.empty()) {
-                        std::string sep = str.substr(last_end, it->position() - last_end);
-                        env_.get_variable(seps_name).array_access(std::to_string(count)) = AWKValue(sep);
+                        std::string sep = str.substr(last_end, match.begin - last_end);
+                        env_.get_variable(seps_name).array_access(static_cast<long long>(count)) = AWKValue(sep);
                     }
 
                     // Store match (1-based)
                     count++;
-                    arr.array_access(std::to_string(count)) = AWKValue(it->str());
+                    arr.array_access(static_cast<long long>(count)) = AWKValue(str.substr(match.begin, match.length()));
 
-                    last_end = it->position() + it->length();
-                    ++it;
-                }
+                    last_end = match.end;
+                    return true;
+                });
 
                 // Last separator
                 if (!seps_name.empty() && last_end < str.length()) {
-                    env_.get_variable(seps_name).array_access(std::to_string(count)) = AWKValue(str.substr(last_end));
+                    env_.get_variable(seps_name).array_access(static_cast<long long>(count)) = AWKValue(str.substr(last_end));
                 }
 
                 return AWKValue(static_cast<double>(count));
-            } catch (const std::regex_error& e) {
+            } catch (const RegexError& e) {
                 *error_ << "awk: patsplit: invalid regex '" << pattern << "': " << e.what() << "\n";
                 return AWKValue(0.0);
             }
@@ -718,7 +748,7 @@ AWKValue Interpreter::evaluate(CallExpr& expr) {
             AWKValue& dest = env_.get_variable(dest_name);
             dest.array_clear();
             for (size_t i = 0; i < values.size(); ++i) {
-                dest.array_access(std::to_string(i + 1)) = values[i];
+                dest.array_access(static_cast<long long>(i + 1)) = std::move(values[i]);
             }
 
             return AWKValue(static_cast<double>(values.size()));
@@ -756,7 +786,7 @@ AWKValue Interpreter::evaluate(CallExpr& expr) {
             AWKValue& dest = env_.get_variable(dest_name);
             dest.array_clear();
             for (size_t i = 0; i < keys.size(); ++i) {
-                dest.array_access(std::to_string(i + 1)) = AWKValue(keys[i]);
+                dest.array_access(static_cast<long long>(i + 1)) = AWKValue(keys[i]);
             }
 
             return AWKValue(static_cast<double>(keys.size()));
@@ -765,12 +795,33 @@ AWKValue Interpreter::evaluate(CallExpr& expr) {
     }
 
     // Standard processing for other functions
+    std::vector<AWKValue*> untyped;
+    bool has_untyped = collect_untyped_args(expr.arguments, untyped);
+
     std::vector<AWKValue> args;
+    args.reserve(expr.arguments.size());
     for (auto& arg : expr.arguments) {
         args.push_back(evaluate(*arg));
     }
 
-    return call_function(expr.function_name, args);
+    return call_function(expr.function_name, args, has_untyped ? untyped.data() : nullptr);
+}
+
+bool Interpreter::collect_untyped_args(std::vector<ExprPtr>& arguments, std::vector<AWKValue*>& untyped) {
+    bool found = false;
+    untyped.assign(arguments.size(), nullptr);
+    for (size_t i = 0; i < arguments.size(); ++i) {
+        if (arguments[i]->kind != ExprKind::VARIABLE) {
+            continue;
+        }
+        auto& var = static_cast<VariableExpr&>(*arguments[i]);
+        AWKValue& value = variable(var.name, var.ref);
+        if (value.is_uninitialized()) {
+            untyped[i] = &value;
+            found = true;
+        }
+    }
+    return found;
 }
 
 // ============================================================================
@@ -783,7 +834,8 @@ bool Interpreter::is_truthy(const AWKValue& value) {
 
 AWKValue& Interpreter::get_lvalue(Expr& expr) {
     if (auto* var = dynamic_cast<VariableExpr*>(&expr)) {
-        return env_.get_variable(var->name);
+        note_store(var->ref);
+        return variable(var->name, var->ref);
     }
 
     if (auto* field = dynamic_cast<FieldExpr*>(&expr)) {
@@ -792,19 +844,16 @@ AWKValue& Interpreter::get_lvalue(Expr& expr) {
     }
 
     if (auto* arr = dynamic_cast<ArrayAccessExpr*>(&expr)) {
-        std::vector<AWKValue> idx_vals;
-        for (auto& idx : arr->indices) {
-            idx_vals.push_back(evaluate(*idx));
-        }
-        std::string key = AWKValue::make_array_key(idx_vals, get_cached_subsep());
+        AWKValue inline_keys[TupleKey::MAX_PARTS];
+        std::vector<AWKValue> more_keys;
+        AWKValue* keys = evaluate_subscripts(arr->indices, inline_keys, more_keys);
 
         // Special handling for SYMTAB - direct variable access
         if (arr->name == "SYMTAB") {
-            return env_.get_variable(key);
+            return env_.get_variable(join_subscripts(keys, arr->indices.size()));
         }
 
-        AWKValue& array = env_.get_variable(arr->name);
-        return array.array_access(key);
+        return array_element(variable(arr->name, arr->ref), keys, arr->indices.size());
     }
 
     // Should not happen
@@ -815,32 +864,41 @@ AWKValue& Interpreter::get_lvalue(Expr& expr) {
 void Interpreter::parse_fields() {
     if (!record_dirty_) return;
 
+    // Spans point into current_record_; nothing is copied here
     fields_.clear();
-    fields_.reserve(16);  // Pre-allocate for typical field count
 
     // Invalidate cached field AWKValues
     std::fill(field_values_valid_.begin(), field_values_valid_.end(), false);
 
+    // Splitting stops after field_limit_ fields. A bounded split leaves NF
+    // alone: the limit is only lowered for programs that never observe NF.
+    const size_t limit = field_limit_;
+    const bool bounded = limit != std::numeric_limits<size_t>::max();
+    if (limit == 0) {
+        record_dirty_ = false;
+        fields_dirty_ = false;
+        return;
+    }
+
     // FPAT takes precedence over FS (gawk extension)
     // Use cached value for performance
     const std::string& fpat = get_cached_fpat();
     if (!fpat.empty()) {
         // FPAT mode: match fields via regex (not split)
         try {
-            const std::regex& re = get_cached_regex(fpat);
-            std::sregex_iterator it(current_record_.begin(),
-                                    current_record_.end(), re);
-            std::sregex_iterator end;
-            while (it != end) {
-                fields_.push_back(it->str());
-                ++it;
-            }
-        } catch (const std::regex_error& e) {
+            get_cached_regex(fpat).for_each_match(current_record_, [&](Regex::Span match) {
+                add_field(match.begin, match.length());
+                return fields_.size() < limit;
+            });
+        } catch (const RegexError& e) {
             // On regex error: report and treat whole record as one field
             *error_ << "awk: FPAT: invalid regex '" << fpat << "': " << e.what() << "\n";
-            fields_.push_back(current_record_);
+            fields_.clear();
+            add_field(0, current_record_.size());
+        }
+        if (!bounded) {
+            env_.NF() = AWKValue(static_cast<double>(fields_.size()));
         }
-        env_.NF() = AWKValue(static_cast<double>(fields_.size()));
         record_dirty_ = false;
         fields_dirty_ = false;
         return;
@@ -848,44 +906,51 @@ void Interpreter::parse_fields() {
 
     // Use cached FS for performance
     const std::string& fs = get_cached_fs();
+    const char* data = current_record_.data();
+    size_t size = current_record_.size();
 
     if (fs == " ") {
         // Standard splitting: whitespace, multiple spaces ignored
-        std::istringstream iss(current_record_);
-        std::string field;
-        while (iss >> field) {
-            fields_.push_back(std::move(field));
-        }
+        simd::for_each_word(simd::kernels(), data, size, [&](size_t start, size_t length) {
+            add_field(start, length);
+            return fields_.size() < limit;
+        });
     } else if (fs.length() == 1) {
-        // Single character separator - optimized path
-        char sep = fs[0];
-        std::string::size_type start = 0;
-        std::string::size_type pos;
-
-        while ((pos = current_record_.find(sep, start)) != std::string::npos) {
-            fields_.push_back(current_record_.substr(start, pos - start));
+        // Single character separator: SIMD scan, 64 bytes per step
+        size_t start = 0;
+        simd::for_each_char(simd::kernels(), data, size, fs[0], [&](size_t pos) {
+            add_field(start, pos - start);
             start = pos + 1;
+            return fields_.size() < limit;
+        });
+        if (fields_.size() < limit) {
+            add_field(start, size - start);
         }
-        fields_.push_back(current_record_.substr(start));
     } else {
-        // Regex separator - with cache
+        // Regex separator - with cache. Fields are the gaps between matches;
+        // empty matches separate nothing and a trailing empty field is dropped.
         try {
-            const std::regex& re = get_cached_regex(fs);
-            std::sregex_token_iterator it(current_record_.begin(),
-                                          current_record_.end(),
-                                          re, -1);
-            std::sregex_token_iterator end;
-            while (it != end) {
-                fields_.push_back(*it++);
+            size_t start = 0;
+            get_cached_regex(fs).for_each_match(current_record_, [&](Regex::Span match) {
+                if (match.length() == 0) return true;
+                add_field(start, match.begin - start);
+                start = match.end;
+                return fields_.size() < limit;
+            });
+            if (start < size && fields_.size() < limit) {
+                add_field(start, size - start);
             }
-        } catch (const std::regex_error& e) {
+        } catch (const RegexError& e) {
             // On regex error: report and treat whole record as one field
             *error_ << "awk: FS: invalid regex '" << fs << "': " << e.what() << "\n";
-            fields_.push_back(current_record_);
+            fields_.clear();
+            add_field(0, size);
         }
     }
 
-    env_.NF() = AWKValue(static_cast<double>(fields_.size()));
+    if (!bounded) {
+        env_.NF() = AWKValue(static_cast<double>(fields_.size()));
+    }
     record_dirty_ = false;
     fields_dirty_ = false;
 }
@@ -898,23 +963,30 @@ void Interpreter::rebuild_record() {
 
     // Pre-calculate total size needed to avoid reallocations
     size_t total_size = 0;
-    for (const auto& field : fields_) {
-        total_size += field.length();
+    for (size_t i = 0; i < fields_.size(); ++i) {
+        total_size += field_text(i).length();
     }
     if (!fields_.empty()) {
         total_size += ofs.length() * (fields_.size() - 1);
     }
 
-    current_record_.clear();
-    current_record_.reserve(total_size);
+    // Join into a separate buffer (spans still point into the old record)
+    // and re-base every span onto the new record
+    rebuild_buffer_.clear();
+    rebuild_buffer_.reserve(total_size);
 
     for (size_t i = 0; i < fields_.size(); ++i) {
         if (i > 0) {
-            current_record_ += ofs;
+            rebuild_buffer_ += ofs;
         }
-        current_record_ += fields_[i];
+        std::string_view text = field_text(i);
+        size_t offset = rebuild_buffer_.size();
+        rebuild_buffer_.append(text.data(), text.size());
+        fields_[i] = {offset, text.size(), false};
     }
 
+    record_storage_.swap(rebuild_buffer_);
+    current_record_ = record_storage_;
     fields_dirty_ = false;
 }
 
@@ -935,7 +1007,7 @@ AWKValue& Interpreter::get_field(int index) {
 
     // Extend fields if necessary
     while (static_cast<size_t>(index) > fields_.size()) {
-        fields_.push_back("");
+        add_field(0, 0);
     }
 
     // Ensure field_values_ and validity vectors are large enough
@@ -944,10 +1016,11 @@ AWKValue& Interpreter::get_field(int index) {
         field_values_valid_.resize(fields_.size(), false);
     }
 
-    // Only create AWKValue if not already cached
+    // Only create AWKValue if not already cached: this is the only copy of
+    // the field text
     size_t idx = static_cast<size_t>(index - 1);
     if (!field_values_valid_[idx]) {
-        field_values_[idx] = AWKValue::strnum(fields_[idx]);
+        field_values_[idx] = AWKValue::strnum(field_text(idx));
         field_values_valid_[idx] = true;
     }
     return field_values_[idx];
@@ -957,7 +1030,8 @@ void Interpreter::set_field(int index, AWKValue value) {
     parse_fields();
 
     if (index == 0) {
-        current_record_ = value.to_string();
+        record_storage_ = value.to_string();
+        current_record_ = record_storage_;
         record_dirty_ = true;
         parse_fields();
         return;
@@ -967,22 +1041,29 @@ void Interpreter::set_field(int index, AWKValue value) {
 
     // Extend fields if necessary
     while (static_cast<size_t>(index) > fields_.size()) {
-        fields_.push_back("");
+        add_field(0, 0);
+    }
+    if (field_texts_.size() < fields_.size()) {
+        field_texts_.resize(fields_.size());
     }
 
-    fields_[index - 1] = value.to_string();
+    // The assigned text is the field's own copy until the record is rebuilt
+    size_t idx = static_cast<size_t>(index - 1);
+    field_texts_[idx] = value.to_string();
+    fields_[idx].assigned = true;
     fields_dirty_ = true;
 
     // Invalidate cached AWKValue for this field
-    if (field_values_valid_.size() >= static_cast<size_t>(index)) {
-        field_values_valid_[index - 1] = false;
+    if (field_values_valid_.size() > idx) {
+        field_values_valid_[idx] = false;
     }
 
     env_.NF() = AWKValue(static_cast<double>(fields_.size()));
 }
 
 void Interpreter::set_record(const std::string& record) {
-    current_record_ = record;
+    record_storage_ = record;
+    current_record_ = record_storage_;
     record_dirty_ = true;
     parse_fields();
 }
@@ -992,48 +1073,41 @@ int Interpreter::field_count() const {
 }
 
 bool Interpreter::regex_match(const AWKValue& text, const AWKValue& pattern) {
-    std::string text_str = text.to_string();
+    std::string scratch;
+    std::string_view text_view = text.to_string_view(scratch);
     std::string pattern_str = pattern.is_regex() ? pattern.regex_pattern() : pattern.to_string();
 
     try {
         // Use cached regex - automatically respects IGNORECASE
-        const std::regex& re = get_cached_regex(pattern_str);
-        return std::regex_search(text_str, re);
-    } catch (const std::regex_error& e) {
+        return get_cached_regex(pattern_str).search(text_view);
+    } catch (const RegexError& e) {
         *error_ << "awk: invalid regex '" << pattern_str << "': " << e.what() << "\n";
         return false;
     }
 }
 
-std::ostream* Interpreter::get_output_stream(const std::string& target,
-                                              RedirectType type) {
+OutputSink* Interpreter::get_output_sink(const std::string& target, RedirectType type) {
     // Special files (gawk compatibility)
     if (target == "/dev/stdout" || target == "-") {
-        return &std::cout;
+        return output_sink_.get();
     }
     if (target == "/dev/stderr") {
-        return &std::cerr;
+        return error_sink_.get();
     }
     if (target == "/dev/null") {
-        // Null stream: discard all output
-        static std::ofstream null_stream;
-        if (!null_stream.is_open()) {
-#ifdef _WIN32
-            null_stream.open("NUL");
-#else
-            null_stream.open("/dev/null");
-#endif
-        }
-        return &null_stream;
+        return &null_sink_;
     }
 
     if (type == RedirectType::PIPE) {
         // Output pipe: print | "command"
         auto it = output_pipes_.find(target);
         if (it != output_pipes_.end()) {
-            return it->second.get();
+            return it->second->sink.get();
         }
 
+        // The command's output must not overtake ours
+        flush_all_files();
+
         // Open new pipe
 #ifdef _WIN32
         FILE* pipe = _popen(target.c_str(), "w");
@@ -1043,60 +1117,73 @@ std::ostream* Interpreter::get_output_stream(const std::string& target,
 
         if (!pipe) {
             *error_ << "awk: can't open pipe to command: " << target << ": " << safe_strerror(errno) << "\n";
-            return output_;
+            return output_sink_.get();
         }
 
-        auto pipe_stream = std::make_unique<PipeOStream>(pipe);
-        std::ostream* result = pipe_stream.get();
-        output_pipes_[target] = std::move(pipe_stream);
+        auto output = std::make_unique<OutputPipe>();
+        output->pipe = pipe;
+#ifdef _WIN32
+        output->sink = std::make_unique<OutputSink>(_fileno(pipe), false);
+#else
+        output->sink = std::make_unique<OutputSink>(fileno(pipe), false);
+#endif
+        OutputSink* result = output->sink.get();
+        output_pipes_[target] = std::move(output);
         return result;
     }
 
     if (type == RedirectType::PIPE_BOTH) {
         // Bidirectional pipe: print |& "command" (gawk extension)
+        auto it = output_pipes_.find("__coproc__" + target);
+        if (it != output_pipes_.end()) {
+            return it->second->sink.get();
+        }
         Coprocess* coproc = get_or_create_coprocess(target);
         if (coproc && coproc->to_child) {
-            // We need to create a temporary ostream for the FILE*
-            // Since we don't have a persistent ostream, we write directly
-            // and return a special stream
-            // For now: use a PipeOStream-like solution
-            auto it = output_pipes_.find("__coproc__" + target);
-            if (it != output_pipes_.end()) {
-                return it->second.get();
-            }
-            auto pipe_stream = std::make_unique<PipeOStream>(coproc->to_child);
-            std::ostream* result = pipe_stream.get();
-            output_pipes_["__coproc__" + target] = std::move(pipe_stream);
+            // Written straight to the descriptor; the coprocess's own
+            // FILE* is only used to close it
+            auto output = std::make_unique<OutputPipe>();
+#ifdef _WIN32
+            output->sink = std::make_unique<OutputSink>(_fileno(coproc->to_child), false);
+#else
+            output->sink = std::make_unique<OutputSink>(fileno(coproc->to_child), false);
+#endif
+            OutputSink* result = output->sink.get();
+            output_pipes_["__coproc__" + target] = std::move(output);
             return result;
         }
         *error_ << "awk: can't open coprocess to command: " << target << ": " << safe_strerror(errno) << "\n";
-        return output_;
+        return output_sink_.get();
     }
 
     // File
-    auto it = output_files_.find(target);
-    if (it != output_files_.end()) {
-        return it->second.get();
+    OutputSink* file = output_files_.get(target, type == RedirectType::APPEND);
+    if (!file) {
+        *error_ << "awk: can't open file " << target << " for output: " << safe_strerror(errno) << "\n";
+        return output_sink_.get();
     }
+    return file;
+}
 
-    std::ios_base::openmode mode = std::ios::out;
-    if (type == RedirectType::APPEND) {
-        mode |= std::ios::app;
+int OutputPipe::close() {
+    if (sink) {
+        sink->close();
     }
-
-    auto file = std::make_unique<std::ofstream>(target, mode);
-    if (!file->is_open()) {
-        *error_ << "awk: can't open file " << target << " for output: " << safe_strerror(errno) << "\n";
-        return output_;
+    if (!pipe) {
+        return -1;
     }
-
-    std::ostream* result = file.get();
-    output_files_[target] = std::move(file);
+#ifdef _WIN32
+    int result = _pclose(pipe);
+#else
+    int result = pclose(pipe);
+#endif
+    pipe = nullptr;
     return result;
 }
 
 AWKValue Interpreter::call_function(const std::string& name,
-                                    std::vector<AWKValue>& args) {
+                                    std::vector<AWKValue>& args,
+                                    AWKValue* const* untyped) {
     // Check if name is namespace-qualified (contains ::)
     std::string unqualified_name;
     size_t sep_pos = name.find("::");
@@ -1121,7 +1208,7 @@ AWKValue Interpreter::call_function(const std::string& name,
     // User-defined function?
     FunctionDef* func = env_.get_function(name);
     if (func) {
-        return call_user_function(func, args);
+        return call_user_function(func, args, untyped);
     }
 
     *error_ << "awk: function " << name << " not defined\n";
@@ -1129,174 +1216,78 @@ AWKValue Interpreter::call_function(const std::string& name,
 }
 
 AWKValue Interpreter::call_user_function(FunctionDef* func,
-                                         std::vector<AWKValue>& args) {
-    env_.push_scope();
-
-    // Set parameters
-    for (size_t i = 0; i < func->parameters.size(); ++i) {
-        if (i < args.size()) {
-            env_.set_local(func->parameters[i], args[i]);
-        } else {
-            env_.set_local(func->parameters[i], AWKValue());
+                                         std::vector<AWKValue>& args,
+                                         AWKValue* const* untyped) {
+    size_t bound = std::min(args.size(), func->parameters.size());
+    env_.push_frame(*func, args);
+
+    // Pop the frame on every exit path (next, exit and errors unwind
+    // through here). An uninitialized variable cannot be shared when it is
+    // passed, so a parameter the callee turned into an array is handed back
+    // to it here.
+    struct FrameGuard {
+        Environment& env;
+        AWKValue* const* untyped;
+        size_t bound;
+        ~FrameGuard() {
+            for (size_t i = 0; untyped && i < bound; ++i) {
+                if (untyped[i] && untyped[i]->is_uninitialized() && env.local(i).is_array()) {
+                    *untyped[i] = env.local(i);
+                }
+            }
+            env.pop_frame();
         }
+    } guard{env_, untyped, bound};
+
+    Completion completion = compiled_
+        ? run_chunk(compiled_->functions[compiled_->function_index.at(func)])
+        : execute(*func->body);
+
+    switch (completion) {
+        case Completion::RETURN:
+            return std::move(return_value_);
+        case Completion::NEXT:
+            throw NextException();
+        case Completion::NEXTFILE:
+            throw NextfileException();
+        case Completion::EXIT:
+            throw ExitException(exit_status_);
+        default:
+            // Fell off the end (stray break/continue are ignored)
+            return AWKValue();
     }
-
-    // Extra arguments as local variables (AWK convention for local vars)
-    for (size_t i = func->parameters.size(); i < args.size(); ++i) {
-        // Ignore - AWK allows more arguments than parameters
-    }
-
-    AWKValue result;
-    try {
-        execute(*func->body);
-    } catch (const ReturnException& e) {
-        result = e.value;
-    }
-
-    env_.pop_scope();
-    return result;
 }
 
-// Helper: Parse format flags (-+#0 space)
-static void parse_format_flags(const std::string& format, size_t& i, std::string& spec) {
-    while (i < format.length() &&
-           (format[i] == '-' || format[i] == '+' || format[i] == ' ' ||
-            format[i] == '#' || format[i] == '0')) {
-        spec += format[i++];
-    }
-}
+// ============================================================================
+// printf/sprintf Formats
+// ============================================================================
 
-// Helper: Parse width (number or * for dynamic)
-static void parse_format_width(const std::string& format, size_t& i, std::string& spec,
-                               const std::vector<AWKValue>& args, size_t& arg_idx) {
-    if (i < format.length() && format[i] == '*') {
-        // Dynamic width from next argument
-        int width = (arg_idx < args.size())
-            ? static_cast<int>(args[arg_idx++].to_number()) : 0;
-        spec += std::to_string(width);
-        i++;
-    } else {
-        while (i < format.length() && std::isdigit(format[i])) {
-            spec += format[i++];
-        }
+std::shared_ptr<const FormatProgram> Interpreter::format_program(const std::string& format) {
+    auto it = format_cache_.find(format);
+    if (it != format_cache_.end()) {
+        return it->second;
     }
-}
-
-// Helper: Parse precision (.number or .* for dynamic)
-static void parse_format_precision(const std::string& format, size_t& i, std::string& spec,
-                                   const std::vector<AWKValue>& args, size_t& arg_idx) {
-    if (i < format.length() && format[i] == '.') {
-        spec += format[i++];
-        if (i < format.length() && format[i] == '*') {
-            // Dynamic precision from next argument
-            int prec = (arg_idx < args.size())
-                ? static_cast<int>(args[arg_idx++].to_number()) : 0;
-            spec += std::to_string(prec);
-            i++;
-        } else {
-            while (i < format.length() && std::isdigit(format[i])) {
-                spec += format[i++];
-            }
-        }
+    // Formats built at run time could fill the cache without bound
+    if (format_cache_.size() >= MAX_FORMAT_CACHE_SIZE) {
+        format_cache_.clear();
     }
+    auto program = std::make_shared<const FormatProgram>(format);
+    format_cache_.emplace(format, program);
+    return program;
 }
 
-// Helper: Format a single value according to conversion specifier
-// Optimized version with larger buffer and direct string handling for %s
-static std::string format_value(char conv, const std::string& spec, const AWKValue& arg) {
-    // Use larger buffer for numeric formats (1024 handles extreme precision)
-    char buffer[1024];
-
-    switch (conv) {
-        case 'd':
-        case 'i':
-            std::snprintf(buffer, sizeof(buffer), spec.c_str(),
-                         static_cast<long long>(arg.to_number()));
-            return buffer;
-        case 'o':
-        case 'x':
-        case 'X':
-        case 'u':
-            std::snprintf(buffer, sizeof(buffer), spec.c_str(),
-                         static_cast<unsigned long long>(arg.to_number()));
-            return buffer;
-        case 'e':
-        case 'E':
-        case 'f':
-        case 'F':
-        case 'g':
-        case 'G':
-            std::snprintf(buffer, sizeof(buffer), spec.c_str(), arg.to_number());
-            return buffer;
-        case 'c': {
-            std::string s = arg.to_string();
-            if (!s.empty()) {
-                return std::string(1, s[0]);
-            }
-            return "";
-        }
-        case 's': {
-            // For strings, use dynamic allocation to handle any length
-            std::string str = arg.to_string();
-            // Check if we need special formatting (width/precision)
-            if (spec == "%s") {
-                return str;  // Fast path: no formatting needed
-            }
-            // Calculate required buffer size (string length + potential padding)
-            size_t required = str.length() + 256;
-            std::vector<char> dyn_buffer(required);
-            std::snprintf(dyn_buffer.data(), required, spec.c_str(), str.c_str());
-            return dyn_buffer.data();
-        }
-        default:
-            return std::string(1, conv);
+std::shared_ptr<const FormatProgram> Interpreter::format_program(PrintfStmt& stmt) {
+    if (stmt.compiled_format) {
+        return stmt.compiled_format;
     }
-}
-
-std::string Interpreter::do_sprintf(const std::string& format,
-                                    const std::vector<AWKValue>& args) {
-    std::string result;
-    // Pre-allocate: estimate 2x format length + average arg contribution
-    result.reserve(format.length() * 2 + args.size() * 16);
-    size_t arg_idx = 0;
-    size_t i = 0;
-
-    while (i < format.length()) {
-        if (format[i] != '%') {
-            result += format[i++];
-            continue;
-        }
-
-        i++;  // Skip %
-
-        if (i >= format.length()) {
-            result += '%';
-            break;
+    if (stmt.format->kind == ExprKind::LITERAL) {
+        auto& literal = static_cast<LiteralExpr&>(*stmt.format);
+        if (literal.is_string()) {
+            stmt.compiled_format = std::make_shared<const FormatProgram>(literal.as_string());
+            return stmt.compiled_format;
         }
-
-        if (format[i] == '%') {
-            result += '%';
-            i++;
-            continue;
-        }
-
-        // Build format specification
-        std::string spec = "%";
-        parse_format_flags(format, i, spec);
-        parse_format_width(format, i, spec, args, arg_idx);
-        parse_format_precision(format, i, spec, args, arg_idx);
-
-        // Get conversion specifier
-        if (i >= format.length()) break;
-        char conv = format[i++];
-        spec += conv;
-
-        // Get argument and format it
-        AWKValue arg = (arg_idx < args.size()) ? args[arg_idx++] : AWKValue();
-        result += format_value(conv, spec, arg);
     }
-
-    return result;
+    return format_program(evaluate(*stmt.format).to_string());
 }
 
 // ============================================================================
@@ -1318,17 +1309,13 @@ void Interpreter::register_builtins() {
 
 bool Interpreter::close_file(const std::string& filename) {
     // Try to close output file
-    auto out_it = output_files_.find(filename);
-    if (out_it != output_files_.end()) {
-        out_it->second->close();
-        output_files_.erase(out_it);
+    if (output_files_.close(filename)) {
         return true;
     }
 
     // Try to close input file
     auto in_it = input_files_.find(filename);
     if (in_it != input_files_.end()) {
-        in_it->second->close();
         input_files_.erase(in_it);
         return true;
     }
@@ -1337,9 +1324,9 @@ bool Interpreter::close_file(const std::string& filename) {
     auto in_pipe_it = input_pipes_.find(filename);
     if (in_pipe_it != input_pipes_.end()) {
 #ifdef _WIN32
-        _pclose(in_pipe_it->second);
+        _pclose(in_pipe_it->second.pipe);
 #else
-        pclose(in_pipe_it->second);
+        pclose(in_pipe_it->second.pipe);
 #endif
         input_pipes_.erase(in_pipe_it);
         return true;
@@ -1348,7 +1335,7 @@ bool Interpreter::close_file(const std::string& filename) {
     // Try to close output pipe
     auto out_pipe_it = output_pipes_.find(filename);
     if (out_pipe_it != output_pipes_.end()) {
-        out_pipe_it->second->close_pipe();
+        out_pipe_it->second->close();
         output_pipes_.erase(out_pipe_it);
         return true;
     }
@@ -1363,28 +1350,36 @@ bool Interpreter::close_file(const std::string& filename) {
 
 bool Interpreter::flush_file(const std::string& filename) {
     if (filename.empty()) {
-        std::cout.flush();
+        output_sink_->flush();
         return true;
     }
+    if (filename == "/dev/stdout" || filename == "-") {
+        return output_sink_->flush();
+    }
+    if (filename == "/dev/stderr") {
+        return error_sink_->flush();
+    }
 
     // Flush output file
-    auto file_it = output_files_.find(filename);
-    if (file_it != output_files_.end()) {
-        file_it->second->flush();
+    if (OutputSink* file = output_files_.find(filename)) {
+        file->flush();
         return true;
     }
 
     // Flush output pipe
     auto pipe_it = output_pipes_.find(filename);
     if (pipe_it != output_pipes_.end()) {
-        pipe_it->second->flush();
+        pipe_it->second->sink->flush();
         return true;
     }
 
     // Flush coprocess (gawk |& extension)
     auto coproc_it = coprocesses_.find(filename);
-    if (coproc_it != coprocesses_.end() && coproc_it->second->to_child) {
-        fflush(coproc_it->second->to_child);
+    if (coproc_it != coprocesses_.end()) {
+        auto coproc_pipe = output_pipes_.find("__coproc__" + filename);
+        if (coproc_pipe != output_pipes_.end()) {
+            coproc_pipe->second->sink->flush();
+        }
         return true;
     }
 
@@ -1392,19 +1387,12 @@ bool Interpreter::flush_file(const std::string& filename) {
 }
 
 void Interpreter::flush_all_files() {
-    std::cout.flush();
-    std::cerr.flush();
-    for (auto& [name, file] : output_files_) {
-        file->flush();
-    }
+    output_sink_->flush();
+    error_sink_->flush();
+    output_files_.flush_all();
+    // Output pipes and coprocesses (gawk |& extension)
     for (auto& [name, pipe] : output_pipes_) {
-        pipe->flush();
-    }
-    // Flush coprocesses (gawk |& extension)
-    for (auto& [name, coproc] : coprocesses_) {
-        if (coproc->to_child) {
-            fflush(coproc->to_child);
-        }
+        pipe->sink->flush();
     }
 }
 
@@ -1432,16 +1420,16 @@ void Interpreter::cleanup_io() {
     input_files_.clear();
 
     // Close input pipes
-    for (auto& [cmd, pipe] : input_pipes_) {
+    for (auto& [cmd, input] : input_pipes_) {
 #ifdef _WIN32
-        _pclose(pipe);
+        _pclose(input.pipe);
 #else
-        pclose(pipe);
+        pclose(input.pipe);
 #endif
     }
     input_pipes_.clear();
 
-    // Close output pipes (automatic via PipeOStream destructor)
+    // Close output pipes (waits for the commands via OutputPipe::close)
     output_pipes_.clear();
 
     // Close coprocesses (gawk |& extension)
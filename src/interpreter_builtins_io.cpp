@@ -8,8 +8,9 @@
 namespace awk {
 
 void Interpreter::register_io_builtins() {
-    env_.register_builtin("system", [](std::vector<AWKValue>& args, Interpreter&) {
+    env_.register_builtin("system", [](std::vector<AWKValue>& args, Interpreter& interp) {
         if (args.empty()) return AWKValue(0.0);
+        interp.flush_all_files();  // Our output comes before the command's
         int result = std::system(args[0].to_string().c_str());
         return AWKValue(static_cast<double>(result));
     });
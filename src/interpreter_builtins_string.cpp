@@ -4,9 +4,8 @@
 
 #include "awk/interpreter.hpp"
 #include "awk/i18n.hpp"
-#include <sstream>
+#include "awk/simd_scan.hpp"
 #include <algorithm>
-#include <regex>
 
 namespace awk {
 
@@ -18,7 +17,7 @@ static std::string prepare_sub_target(std::vector<AWKValue>& args, Interpreter&
         return args[2].to_string();
     } else {
         modify_record = true;
-        return interp.current_record();
+        return std::string(interp.current_record());
     }
 }
 
@@ -27,34 +26,13 @@ static std::string prepare_sub_target(std::vector<AWKValue>& args, Interpreter&
 static int do_substitution(const std::string& pattern, const std::string& replacement,
                            std::string& target, bool global, Interpreter& interp) {
     try {
-        const std::regex& re = interp.get_cached_regex(pattern);
-        std::string awk_replacement = convert_awk_replacement(replacement);
-
-        if (global) {
-            // Count matches first (gsub returns count)
-            int count = 0;
-            std::string::const_iterator searchStart(target.cbegin());
-            std::smatch match;
-            while (std::regex_search(searchStart, target.cend(), match, re)) {
-                ++count;
-                searchStart = match.suffix().first;
-                if (match.length() == 0) {
-                    if (searchStart != target.cend()) ++searchStart;
-                    else break;
-                }
-            }
-            target = std::regex_replace(target, re, awk_replacement);
-            return count;
-        } else {
-            // sub: replace first only
-            std::string result = std::regex_replace(target, re, awk_replacement,
-                                                    std::regex_constants::format_first_only);
-            if (result != target) {
-                target = result;
-                return 1;
-            }
-            return 0;
+        const Regex& re = interp.get_cached_regex(pattern);
+        std::string result;
+        size_t count = substitute(re, target, replacement, false, global ? 0 : 1, result);
+        if (count > 0) {
+            target = std::move(result);
         }
+        return static_cast<int>(count);
     } catch (...) {
         return 0;
     }
@@ -68,11 +46,10 @@ static std::vector<std::string> split_string(const std::string& str, const std::
 
     if (fs == " ") {
         // Standard AWK: whitespace splitting, multiple spaces ignored
-        std::istringstream iss(str);
-        std::string part;
-        while (iss >> part) {
-            parts.push_back(part);
-        }
+        simd::for_each_word(simd::kernels(), str.data(), str.size(), [&](size_t start, size_t length) {
+            parts.emplace_back(str, start, length);
+            return true;
+        });
     } else if (fs.length() == 1) {
         // Single character separator
         std::string::size_type start = 0;
@@ -83,13 +60,19 @@ static std::vector<std::string> split_string(const std::string& str, const std::
         }
         parts.push_back(str.substr(start));
     } else {
-        // Regex separator
+        // Regex separator: empty matches separate nothing, a trailing
+        // empty part is dropped
         try {
-            const std::regex& re = interp.get_cached_regex(fs);
-            std::sregex_token_iterator it(str.begin(), str.end(), re, -1);
-            std::sregex_token_iterator end;
-            while (it != end) {
-                parts.push_back(*it++);
+            const Regex& re = interp.get_cached_regex(fs);
+            size_t start = 0;
+            re.for_each_match(str, [&](Regex::Span match) {
+                if (match.length() == 0) return true;
+                parts.push_back(str.substr(start, match.begin - start));
+                start = match.end;
+                return true;
+            });
+            if (start < str.size()) {
+                parts.push_back(str.substr(start));
             }
         } catch (...) {
             parts.push_back(str);
@@ -107,12 +90,14 @@ void Interpreter::register_string_builtins() {
         if (args[0].is_array()) {
             return AWKValue(static_cast<double>(args[0].array_size()));
         }
-        return AWKValue(static_cast<double>(args[0].to_string().length()));
+        std::string scratch;
+        return AWKValue(static_cast<double>(args[0].to_string_view(scratch).length()));
     });
 
     env_.register_builtin("substr", [](std::vector<AWKValue>& args, Interpreter&) {
         if (args.empty()) return AWKValue("");
-        std::string str = args[0].to_string();
+        std::string scratch;
+        std::string_view str = args[0].to_string_view(scratch);
         int start = args.size() > 1 ? static_cast<int>(args[1].to_number()) : 1;
         size_t len = args.size() > 2
             ? static_cast<size_t>(args[2].to_number())
@@ -122,15 +107,16 @@ void Interpreter::register_string_builtins() {
         size_t idx = static_cast<size_t>(start - 1);
 
         if (idx >= str.length()) return AWKValue("");
-        return AWKValue(str.substr(idx, len));
+        return AWKValue(std::string(str.substr(idx, len)));
     });
 
     env_.register_builtin("index", [](std::vector<AWKValue>& args, Interpreter&) {
         if (args.size() < 2) return AWKValue(0.0);
-        std::string str = args[0].to_string();
-        std::string needle = args[1].to_string();
+        std::string str_scratch, needle_scratch;
+        std::string_view str = args[0].to_string_view(str_scratch);
+        std::string_view needle = args[1].to_string_view(needle_scratch);
         size_t pos = str.find(needle);
-        return AWKValue(pos == std::string::npos ? 0.0 : static_cast<double>(pos + 1));
+        return AWKValue(pos == std::string_view::npos ? 0.0 : static_cast<double>(pos + 1));
     });
 
     env_.register_builtin("tolower", [](std::vector<AWKValue>& args, Interpreter&) {
@@ -151,9 +137,9 @@ void Interpreter::register_string_builtins() {
 
     env_.register_builtin("sprintf", [](std::vector<AWKValue>& args, Interpreter& interp) {
         if (args.empty()) return AWKValue("");
-        std::string format = args[0].to_string();
-        std::vector<AWKValue> fmt_args(args.begin() + 1, args.end());
-        return AWKValue(interp.do_sprintf(format, fmt_args));
+        std::string result;
+        interp.format_program(args[0].to_string())->run(args.data() + 1, args.size() - 1, result);
+        return AWKValue(std::move(result));
     });
 
     env_.register_builtin("strtonum", [](std::vector<AWKValue>& args, Interpreter&) {
@@ -235,38 +221,15 @@ void Interpreter::register_string_builtins() {
         }
 
         try {
-            const std::regex& re = interp.get_cached_regex(pattern);
-            std::string awk_replacement = convert_awk_replacement(replacement, true);
-
-            if (how == "g" || how == "G") {
-                return AWKValue(std::regex_replace(target, re, awk_replacement));
-            } else {
-                int which = static_cast<int>(std::strtod(how.c_str(), nullptr));
-                if (which < 1) which = 1;
-
-                std::string::const_iterator searchStart(target.cbegin());
-                std::smatch match;
-                int count = 0;
-
-                while (std::regex_search(searchStart, target.cend(), match, re)) {
-                    ++count;
-                    size_t matchStart = (searchStart - target.cbegin()) + match.position();
-
-                    if (count == which) {
-                        std::string result = target.substr(0, matchStart);
-                        result += match.format(awk_replacement);
-                        result += target.substr(matchStart + match.length());
-                        return AWKValue(result);
-                    }
-
-                    searchStart = match.suffix().first;
-                    if (match.length() == 0 && searchStart != target.cend()) {
-                        ++searchStart;
-                    }
-                }
-
-                return AWKValue(target);
+            const Regex& re = interp.get_cached_regex(pattern);
+            size_t which = 0;
+            if (how != "g" && how != "G") {
+                double n = std::strtod(how.c_str(), nullptr);
+                which = n < 1 ? 1 : static_cast<size_t>(n);
             }
+            std::string result;
+            substitute(re, target, replacement, true, which, result);
+            return AWKValue(std::move(result));
 
         } catch (...) {
             return AWKValue(target);
@@ -299,27 +262,25 @@ void Interpreter::register_string_builtins() {
         }
 
         try {
-            const std::regex& re = interp.get_cached_regex(pattern);
-            std::sregex_iterator it(str.begin(), str.end(), re);
-            std::sregex_iterator end;
+            const Regex& re = interp.get_cached_regex(pattern);
 
             int count = 0;
             size_t last_end = 0;
-            while (it != end) {
+            re.for_each_match(str, [&](Regex::Span match) {
                 if (has_seps) {
-                    std::string sep = str.substr(last_end, it->position() - last_end);
-                    args[3].array_access(std::to_string(count)) = AWKValue(sep);
+                    std::string sep = str.substr(last_end, match.begin - last_end);
+                    args[3].array_access(static_cast<long long>(count)) = AWKValue(sep);
                 }
 
                 count++;
-                args[1].array_access(std::to_string(count)) = AWKValue(it->str());
+                args[1].array_access(static_cast<long long>(count)) = AWKValue(str.substr(match.begin, match.length()));
 
-                last_end = it->position() + it->length();
-                ++it;
-            }
+                last_end = match.end;
+                return true;
+            });
 
             if (has_seps && last_end < str.length()) {
-                args[3].array_access(std::to_string(count)) = AWKValue(str.substr(last_end));
+                args[3].array_access(static_cast<long long>(count)) = AWKValue(str.substr(last_end));
             }
 
             return AWKValue(static_cast<double>(count));
@@ -337,20 +298,24 @@ void Interpreter::register_string_builtins() {
         std::string pattern = args[1].to_string();
 
         try {
-            const std::regex& re = interp.get_cached_regex(pattern);
-            std::smatch match;
+            const Regex& re = interp.get_cached_regex(pattern);
+            std::vector<Regex::Span> groups(1);
 
-            if (std::regex_search(str, match, re)) {
-                int start = static_cast<int>(match.position()) + 1;
-                int length = static_cast<int>(match.length());
+            bool found = args.size() >= 3 ? re.find_groups(str, 0, groups)
+                                          : re.find(str, 0, groups[0]);
+            if (found) {
+                int start = static_cast<int>(groups[0].begin) + 1;
+                int length = static_cast<int>(groups[0].length());
 
                 interp.environment().RSTART() = AWKValue(static_cast<double>(start));
                 interp.environment().RLENGTH() = AWKValue(static_cast<double>(length));
 
                 if (args.size() >= 3) {
                     args[2].array_clear();
-                    for (size_t i = 0; i < match.size(); ++i) {
-                        args[2].array_access(std::to_string(i)) = AWKValue(match[i].str());
+                    for (size_t i = 0; i < groups.size(); ++i) {
+                        args[2].array_access(std::to_string(i)) = groups[i].matched()
+                            ? AWKValue(str.substr(groups[i].begin, groups[i].length()))
+                            : AWKValue("");
                     }
                 }
 
@@ -402,7 +367,7 @@ void Interpreter::register_string_builtins() {
 
         // Write sorted values with numeric indices 1, 2, 3, ...
         for (size_t i = 0; i < values.size(); ++i) {
-            dest.array_access(std::to_string(i + 1)) = values[i];
+            dest.array_access(static_cast<long long>(i + 1)) = std::move(values[i]);
         }
 
         return AWKValue(static_cast<double>(values.size()));
@@ -425,7 +390,7 @@ void Interpreter::register_string_builtins() {
 
         // Write sorted indices as values with numeric indices 1, 2, 3, ...
         for (size_t i = 0; i < keys.size(); ++i) {
-            dest.array_access(std::to_string(i + 1)) = AWKValue(keys[i]);
+            dest.array_access(static_cast<long long>(i + 1)) = AWKValue(keys[i]);
         }
 
         return AWKValue(static_cast<double>(keys.size()));
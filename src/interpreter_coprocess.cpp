@@ -222,8 +222,9 @@ int Interpreter::getline_from_coprocess(const std::string& command, Expr* variab
     }
 
     // Flush output before reading (bidirectional!)
-    if (coproc->to_child) {
-        fflush(coproc->to_child);
+    auto output = output_pipes_.find("__coproc__" + command);
+    if (output != output_pipes_.end()) {
+        output->second->sink->flush();
     }
 
     return getline_from_pipe(coproc->from_child, variable, false);
@@ -3,8 +3,8 @@
 // ============================================================================
 
 #include "awk/interpreter.hpp"
+#include <cmath>
 #include <sstream>
-#include <regex>
 
 namespace awk {
 
@@ -13,36 +13,40 @@ namespace awk {
 // ============================================================================
 
 AWKValue Interpreter::evaluate(Expr& expr) {
-    if (auto* literal = dynamic_cast<LiteralExpr*>(&expr))
-        return evaluate(*literal);
-    if (auto* regex = dynamic_cast<RegexExpr*>(&expr))
-        return evaluate(*regex);
-    if (auto* var = dynamic_cast<VariableExpr*>(&expr))
-        return evaluate(*var);
-    if (auto* field = dynamic_cast<FieldExpr*>(&expr))
-        return evaluate(*field);
-    if (auto* arr = dynamic_cast<ArrayAccessExpr*>(&expr))
-        return evaluate(*arr);
-    if (auto* binary = dynamic_cast<BinaryExpr*>(&expr))
-        return evaluate(*binary);
-    if (auto* unary = dynamic_cast<UnaryExpr*>(&expr))
-        return evaluate(*unary);
-    if (auto* ternary = dynamic_cast<TernaryExpr*>(&expr))
-        return evaluate(*ternary);
-    if (auto* assign = dynamic_cast<AssignExpr*>(&expr))
-        return evaluate(*assign);
-    if (auto* call = dynamic_cast<CallExpr*>(&expr))
-        return evaluate(*call);
-    if (auto* indirect = dynamic_cast<IndirectCallExpr*>(&expr))
-        return evaluate(*indirect);
-    if (auto* match = dynamic_cast<MatchExpr*>(&expr))
-        return evaluate(*match);
-    if (auto* concat = dynamic_cast<ConcatExpr*>(&expr))
-        return evaluate(*concat);
-    if (auto* getline = dynamic_cast<GetlineExpr*>(&expr))
-        return evaluate(*getline);
-    if (auto* in = dynamic_cast<InExpr*>(&expr))
-        return evaluate(*in);
+    switch (expr.kind) {
+        case ExprKind::LITERAL:
+            return evaluate(static_cast<LiteralExpr&>(expr));
+        case ExprKind::REGEX:
+            return evaluate(static_cast<RegexExpr&>(expr));
+        case ExprKind::VARIABLE:
+            return evaluate(static_cast<VariableExpr&>(expr));
+        case ExprKind::FIELD:
+            return evaluate(static_cast<FieldExpr&>(expr));
+        case ExprKind::ARRAY_ACCESS:
+            return evaluate(static_cast<ArrayAccessExpr&>(expr));
+        case ExprKind::BINARY:
+            return evaluate(static_cast<BinaryExpr&>(expr));
+        case ExprKind::UNARY:
+            return evaluate(static_cast<UnaryExpr&>(expr));
+        case ExprKind::TERNARY:
+            return evaluate(static_cast<TernaryExpr&>(expr));
+        case ExprKind::ASSIGN:
+            return evaluate(static_cast<AssignExpr&>(expr));
+        case ExprKind::CALL:
+            return evaluate(static_cast<CallExpr&>(expr));
+        case ExprKind::INDIRECT_CALL:
+            return evaluate(static_cast<IndirectCallExpr&>(expr));
+        case ExprKind::MATCH:
+            return evaluate(static_cast<MatchExpr&>(expr));
+        case ExprKind::CONCAT:
+            return evaluate(static_cast<ConcatExpr&>(expr));
+        case ExprKind::GETLINE:
+            return evaluate(static_cast<GetlineExpr&>(expr));
+        case ExprKind::IN:
+            return evaluate(static_cast<InExpr&>(expr));
+        case ExprKind::UPDATE:
+            return evaluate(static_cast<UpdateExpr&>(expr));
+    }
 
     return AWKValue();
 }
@@ -61,7 +65,8 @@ AWKValue Interpreter::evaluate(LiteralExpr& expr) {
 
 AWKValue Interpreter::evaluate(RegexExpr& expr) {
     AWKValue val;
-    val.set_regex(expr.pattern);
+    literal_regex(expr);
+    val.set_regex(expr.pattern, expr.compiled);
     return val;
 }
 
@@ -70,7 +75,7 @@ AWKValue Interpreter::evaluate(RegexExpr& expr) {
 // ============================================================================
 
 AWKValue Interpreter::evaluate(VariableExpr& expr) {
-    return env_.get_variable(expr.name);
+    return variable(expr.name, expr.ref);
 }
 
 AWKValue Interpreter::evaluate(FieldExpr& expr) {
@@ -79,29 +84,87 @@ AWKValue Interpreter::evaluate(FieldExpr& expr) {
 }
 
 AWKValue Interpreter::evaluate(ArrayAccessExpr& expr) {
-    std::vector<AWKValue> idx_vals;
-    for (auto& idx : expr.indices) {
-        idx_vals.push_back(evaluate(*idx));
-    }
-    std::string key = AWKValue::make_array_key(idx_vals, get_cached_subsep());
+    AWKValue inline_keys[TupleKey::MAX_PARTS];
+    std::vector<AWKValue> more_keys;
+    AWKValue* keys = evaluate_subscripts(expr.indices, inline_keys, more_keys);
+    size_t count = expr.indices.size();
 
     // Special handling for SYMTAB (gawk extension)
     if (expr.name == "SYMTAB") {
         // SYMTAB["varname"] gives direct access to variable
-        return env_.get_variable(key);
+        return env_.get_variable(join_subscripts(keys, count));
     }
 
     // Special handling for FUNCTAB (gawk extension)
     if (expr.name == "FUNCTAB") {
         // FUNCTAB["funcname"] returns "func" if function exists
+        std::string key = join_subscripts(keys, count);
         if (env_.has_function(key) || env_.has_builtin(key)) {
             return AWKValue(key);
         }
         return AWKValue("");
     }
 
-    AWKValue& arr = env_.get_variable(expr.name);
-    return arr.array_access(key);
+    return array_element(variable(expr.name, expr.ref), keys, count);
+}
+
+// ============================================================================
+// Array Subscripts
+// ============================================================================
+
+AWKValue* Interpreter::evaluate_subscripts(std::vector<ExprPtr>& indices, AWKValue* inline_keys,
+                                           std::vector<AWKValue>& more_keys) {
+    AWKValue* keys = inline_keys;
+    if (indices.size() > TupleKey::MAX_PARTS) {
+        more_keys.resize(indices.size());
+        keys = more_keys.data();
+    }
+    for (size_t i = 0; i < indices.size(); ++i) {
+        keys[i] = evaluate(*indices[i]);
+    }
+    return keys;
+}
+
+AWKValue& Interpreter::array_element(AWKValue& array, const AWKValue* keys, size_t count) {
+    if (count == 1) {
+        if (long long index = AWKValue::integer_subscript(keys[0])) {
+            return array.array_access(index);
+        }
+        std::string scratch;
+        return array.as_array()[keys[0].to_string_view(scratch)];
+    }
+    if (count <= TupleKey::MAX_PARTS) {
+        return array.array_access(TupleKey(keys, count, get_cached_subsep()));
+    }
+    return array.array_access(join_subscripts(keys, count));
+}
+
+bool Interpreter::array_has_element(const AWKValue& array, const AWKValue* keys, size_t count) {
+    if (count >= 2 && count <= TupleKey::MAX_PARTS) {
+        return array.array_contains(TupleKey(keys, count, get_cached_subsep()));
+    }
+    return array.array_contains(join_subscripts(keys, count));
+}
+
+void Interpreter::delete_array_element(AWKValue& array, const AWKValue* keys, size_t count) {
+    if (count >= 2 && count <= TupleKey::MAX_PARTS) {
+        array.array_delete(TupleKey(keys, count, get_cached_subsep()));
+        return;
+    }
+    array.array_delete(join_subscripts(keys, count));
+}
+
+std::string Interpreter::join_subscripts(const AWKValue* keys, size_t count) {
+    if (count == 1) {
+        return keys[0].to_string();
+    }
+    const std::string& subsep = get_cached_subsep();
+    std::string key;
+    for (size_t i = 0; i < count; ++i) {
+        if (i > 0) key += subsep;
+        key += keys[i].to_string();
+    }
+    return key;
 }
 
 // ============================================================================
@@ -164,9 +227,8 @@ AWKValue Interpreter::evaluate(BinaryExpr& expr) {
 AWKValue Interpreter::evaluate(UnaryExpr& expr) {
     if (expr.op == TokenType::NOT) {
         // For NOT with regex: check if $0 does NOT match the regex
-        if (auto* regex_expr = dynamic_cast<RegexExpr*>(expr.operand.get())) {
-            AWKValue regex_val = evaluate(*regex_expr);
-            bool matches = regex_match(AWKValue(current_record_), regex_val);
+        if (expr.operand->kind == ExprKind::REGEX) {
+            bool matches = match_record(static_cast<RegexExpr&>(*expr.operand));
             return AWKValue(matches ? 0.0 : 1.0);  // Negated!
         }
         return AWKValue(is_truthy(evaluate(*expr.operand)) ? 0.0 : 1.0);
@@ -228,18 +290,20 @@ AWKValue Interpreter::evaluate(AssignExpr& expr) {
                         if (first_var->name == target_var->name) {
                             // Pattern matched: var = var ...
                             // Get reference to target variable
-                            AWKValue& target = env_.get_variable(target_var->name);
+                            note_store(target_var->ref);
+                            AWKValue& target = variable(target_var->name, target_var->ref);
 
                             // Evaluate and append each remaining part directly
+                            std::string scratch;
                             for (size_t i = 1; i < concat->parts.size(); ++i) {
-                                target.append_string(evaluate(*concat->parts[i]).to_string());
+                                AWKValue part = evaluate(*concat->parts[i]);
+                                target.append_string(part.to_string_view(scratch));
                             }
 
-                            // Return empty value - returning the full accumulated string
-                            // would cause O(n^2) copying. The value is already in the
-                            // variable, which handles 99.9% of use cases where the
-                            // assignment result is discarded.
-                            return AWKValue();
+                            // The result shares the variable's string; it is
+                            // normally dropped before the next append, which
+                            // then finds the buffer unshared again
+                            return target;
                         }
                     }
                 }
@@ -313,15 +377,60 @@ AWKValue Interpreter::evaluate(AssignExpr& expr) {
     return target;
 }
 
+// ============================================================================
+// Update Expression
+// ============================================================================
+
+AWKValue Interpreter::evaluate(UpdateExpr& expr) {
+    // The operand is evaluated before the target is looked up, as in
+    // evaluate(AssignExpr&)
+    double operand = expr.value ? evaluate(*expr.value).to_number() : 1.0;
+
+    AWKValue* target;
+    if (expr.target->kind == ExprKind::VARIABLE) {
+        auto& var = static_cast<VariableExpr&>(*expr.target);
+        note_store(var.ref);
+        target = &variable(var.name, var.ref);
+    } else {
+        auto& access = static_cast<ArrayAccessExpr&>(*expr.target);
+        AWKValue inline_keys[TupleKey::MAX_PARTS];
+        std::vector<AWKValue> more_keys;
+        AWKValue* keys = evaluate_subscripts(access.indices, inline_keys, more_keys);
+        target = &array_element(variable(access.name, access.ref), keys, access.indices.size());
+    }
+
+    // Once updated the target holds a plain number, so later updates skip
+    // string conversion
+    double old = target->to_number();
+    double result;
+    switch (expr.op) {
+        case TokenType::PLUS:    result = old + operand; break;
+        case TokenType::MINUS:   result = old - operand; break;
+        case TokenType::STAR:    result = old * operand; break;
+        case TokenType::SLASH:   result = (AWKValue(old) / AWKValue(operand)).to_number(); break;
+        case TokenType::PERCENT: result = (AWKValue(old) % AWKValue(operand)).to_number(); break;
+        case TokenType::CARET:   result = std::pow(old, operand); break;
+        default:                 result = old; break;
+    }
+    target->set_number(result);
+    return AWKValue(expr.postfix ? old : result);
+}
+
 // ============================================================================
 // Match Expression
 // ============================================================================
 
 AWKValue Interpreter::evaluate(MatchExpr& expr) {
     AWKValue text = evaluate(*expr.string);
-    AWKValue pattern = evaluate(*expr.regex);
 
-    bool matches = regex_match(text, pattern);
+    bool matches;
+    if (expr.regex->kind == ExprKind::REGEX) {
+        std::string scratch;
+        matches = regex_match(text.to_string_view(scratch), static_cast<RegexExpr&>(*expr.regex));
+    } else {
+        AWKValue pattern = evaluate(*expr.regex);
+        matches = regex_match(text, pattern);
+    }
 
     if (expr.negated) {
         return AWKValue(matches ? 0.0 : 1.0);
@@ -335,22 +444,28 @@ AWKValue Interpreter::evaluate(MatchExpr& expr) {
 // ============================================================================
 
 AWKValue Interpreter::evaluate(ConcatExpr& expr) {
-    // First pass: evaluate all parts and calculate total size
-    std::vector<std::string> parts;
-    parts.reserve(expr.parts.size());
+    // First pass: evaluate all parts and calculate total size. String
+    // parts are viewed in place; only numbers are formatted into scratch.
+    size_t count = expr.parts.size();
+    std::vector<AWKValue> values;
+    std::vector<std::string> scratch(count);
+    std::vector<std::string_view> parts;
+    values.reserve(count);
+    parts.reserve(count);
     size_t total_size = 0;
-    for (auto& part : expr.parts) {
-        parts.push_back(evaluate(*part).to_string());
+    for (size_t i = 0; i < count; ++i) {
+        values.push_back(evaluate(*expr.parts[i]));
+        parts.push_back(values.back().to_string_view(scratch[i]));
         total_size += parts.back().length();
     }
 
     // Second pass: concatenate with pre-allocated buffer
     std::string result;
     result.reserve(total_size);
-    for (auto& part : parts) {
+    for (auto part : parts) {
         result += part;
     }
-    return AWKValue(result);
+    return AWKValue(std::move(result));
 }
 
 // ============================================================================
@@ -358,24 +473,24 @@ AWKValue Interpreter::evaluate(ConcatExpr& expr) {
 // ============================================================================
 
 AWKValue Interpreter::evaluate(InExpr& expr) {
-    std::vector<AWKValue> idx_vals;
-    for (auto& k : expr.keys) {
-        idx_vals.push_back(evaluate(*k));
-    }
-    std::string key = AWKValue::make_array_key(idx_vals, get_cached_subsep());
+    AWKValue inline_keys[TupleKey::MAX_PARTS];
+    std::vector<AWKValue> more_keys;
+    AWKValue* keys = evaluate_subscripts(expr.keys, inline_keys, more_keys);
+    size_t count = expr.keys.size();
 
     // Special handling for SYMTAB
     if (expr.array_name == "SYMTAB") {
-        return AWKValue(env_.has_variable(key) ? 1.0 : 0.0);
+        return AWKValue(env_.has_variable(join_subscripts(keys, count)) ? 1.0 : 0.0);
     }
 
     // Special handling for FUNCTAB
     if (expr.array_name == "FUNCTAB") {
+        std::string key = join_subscripts(keys, count);
         return AWKValue((env_.has_function(key) || env_.has_builtin(key)) ? 1.0 : 0.0);
     }
 
-    AWKValue& arr = env_.get_variable(expr.array_name);
-    return AWKValue(arr.array_contains(key) ? 1.0 : 0.0);
+    AWKValue& arr = variable(expr.array_name, expr.array_ref);
+    return AWKValue(array_has_element(arr, keys, count) ? 1.0 : 0.0);
 }
 
 // ============================================================================
@@ -389,13 +504,15 @@ AWKValue Interpreter::evaluate(IndirectCallExpr& expr) {
     std::string func_name = func_name_val.to_string();
 
     // Evaluate arguments
+    std::vector<AWKValue*> untyped;
+    bool has_untyped = collect_untyped_args(expr.arguments, untyped);
     std::vector<AWKValue> args;
     for (auto& arg : expr.arguments) {
         args.push_back(evaluate(*arg));
     }
 
     // Call function
-    return call_function(func_name, args);
+    return call_function(func_name, args, has_untyped ? untyped.data() : nullptr);
 }
 
 } // namespace awk
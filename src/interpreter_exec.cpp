@@ -11,155 +11,173 @@ namespace awk {
 // Statement Execution - Main Dispatch
 // ============================================================================
 
-void Interpreter::execute(Stmt& stmt) {
-    // Dispatch based on type
-    if (auto* block = dynamic_cast<BlockStmt*>(&stmt)) {
-        execute(*block);
-    } else if (auto* ifstmt = dynamic_cast<IfStmt*>(&stmt)) {
-        execute(*ifstmt);
-    } else if (auto* whilestmt = dynamic_cast<WhileStmt*>(&stmt)) {
-        execute(*whilestmt);
-    } else if (auto* dowhile = dynamic_cast<DoWhileStmt*>(&stmt)) {
-        execute(*dowhile);
-    } else if (auto* forstmt = dynamic_cast<ForStmt*>(&stmt)) {
-        execute(*forstmt);
-    } else if (auto* forin = dynamic_cast<ForInStmt*>(&stmt)) {
-        execute(*forin);
-    } else if (auto* switchstmt = dynamic_cast<SwitchStmt*>(&stmt)) {
-        execute(*switchstmt);
-    } else if (auto* print = dynamic_cast<PrintStmt*>(&stmt)) {
-        execute(*print);
-    } else if (auto* printf = dynamic_cast<PrintfStmt*>(&stmt)) {
-        execute(*printf);
-    } else if (auto* exprstmt = dynamic_cast<ExprStmt*>(&stmt)) {
-        execute(*exprstmt);
-    } else if (auto* del = dynamic_cast<DeleteStmt*>(&stmt)) {
-        execute(*del);
-    } else if (dynamic_cast<BreakStmt*>(&stmt)) {
-        throw BreakException();
-    } else if (dynamic_cast<ContinueStmt*>(&stmt)) {
-        throw ContinueException();
-    } else if (dynamic_cast<NextStmt*>(&stmt)) {
-        throw NextException();
-    } else if (dynamic_cast<NextfileStmt*>(&stmt)) {
-        throw NextfileException();
-    } else if (auto* exitstmt = dynamic_cast<ExitStmt*>(&stmt)) {
-        int status = 0;
-        if (exitstmt->status) {
-            status = static_cast<int>(evaluate(*exitstmt->status).to_number());
+Completion Interpreter::execute(Stmt& stmt) {
+    // Dispatch based on node kind
+    switch (stmt.kind) {
+        case StmtKind::BLOCK:
+            return execute(static_cast<BlockStmt&>(stmt));
+        case StmtKind::IF:
+            return execute(static_cast<IfStmt&>(stmt));
+        case StmtKind::WHILE:
+            return execute(static_cast<WhileStmt&>(stmt));
+        case StmtKind::DO_WHILE:
+            return execute(static_cast<DoWhileStmt&>(stmt));
+        case StmtKind::FOR:
+            return execute(static_cast<ForStmt&>(stmt));
+        case StmtKind::FOR_IN:
+            return execute(static_cast<ForInStmt&>(stmt));
+        case StmtKind::SWITCH:
+            return execute(static_cast<SwitchStmt&>(stmt));
+        case StmtKind::PRINT:
+            return execute(static_cast<PrintStmt&>(stmt));
+        case StmtKind::PRINTF:
+            return execute(static_cast<PrintfStmt&>(stmt));
+        case StmtKind::EXPR:
+            return execute(static_cast<ExprStmt&>(stmt));
+        case StmtKind::DELETE:
+            return execute(static_cast<DeleteStmt&>(stmt));
+        case StmtKind::BREAK:
+            return Completion::BREAK;
+        case StmtKind::CONTINUE:
+            return Completion::CONTINUE;
+        case StmtKind::NEXT:
+            return Completion::NEXT;
+        case StmtKind::NEXTFILE:
+            return Completion::NEXTFILE;
+        case StmtKind::EXIT: {
+            auto& exitstmt = static_cast<ExitStmt&>(stmt);
+            exit_status_ = 0;
+            if (exitstmt.status) {
+                exit_status_ = static_cast<int>(evaluate(*exitstmt.status).to_number());
+            }
+            return Completion::EXIT;
         }
-        throw ExitException(status);
-    } else if (auto* ret = dynamic_cast<ReturnStmt*>(&stmt)) {
-        AWKValue val;
-        if (ret->value) {
-            val = evaluate(*ret->value);
+        case StmtKind::RETURN: {
+            auto& ret = static_cast<ReturnStmt&>(stmt);
+            if (ret.value) {
+                return_value_ = evaluate(*ret.value);
+            } else {
+                return_value_ = AWKValue();
+            }
+            return Completion::RETURN;
         }
-        throw ReturnException(std::move(val));
     }
+    return Completion::NORMAL;
 }
 
 // ============================================================================
 // Block Statement
 // ============================================================================
 
-void Interpreter::execute(BlockStmt& stmt) {
+Completion Interpreter::execute(BlockStmt& stmt) {
     for (auto& s : stmt.statements) {
-        execute(*s);
+        Completion completion = execute(*s);
+        if (completion != Completion::NORMAL) {
+            return completion;
+        }
     }
+    return Completion::NORMAL;
 }
 
 // ============================================================================
 // Control Flow Statements
 // ============================================================================
 
-void Interpreter::execute(IfStmt& stmt) {
+// Loop bodies: break and continue are consumed by the loop, everything
+// else (next, return, exit, ...) leaves it
+static bool leaves_loop(Completion completion) {
+    return completion != Completion::NORMAL && completion != Completion::CONTINUE;
+}
+
+Completion Interpreter::execute(IfStmt& stmt) {
     if (is_truthy(evaluate(*stmt.condition))) {
-        execute(*stmt.then_branch);
+        return execute(*stmt.then_branch);
     } else if (stmt.else_branch) {
-        execute(*stmt.else_branch);
+        return execute(*stmt.else_branch);
     }
+    return Completion::NORMAL;
 }
 
-void Interpreter::execute(WhileStmt& stmt) {
+Completion Interpreter::execute(WhileStmt& stmt) {
     while (is_truthy(evaluate(*stmt.condition))) {
-        try {
-            execute(*stmt.body);
-        } catch (const BreakException&) {
-            break;
-        } catch (const ContinueException&) {
-            continue;
+        Completion completion = execute(*stmt.body);
+        if (leaves_loop(completion)) {
+            return completion == Completion::BREAK ? Completion::NORMAL : completion;
         }
     }
+    return Completion::NORMAL;
 }
 
-void Interpreter::execute(DoWhileStmt& stmt) {
+Completion Interpreter::execute(DoWhileStmt& stmt) {
     do {
-        try {
-            execute(*stmt.body);
-        } catch (const BreakException&) {
-            break;
-        } catch (const ContinueException&) {
-            continue;
+        Completion completion = execute(*stmt.body);
+        if (leaves_loop(completion)) {
+            return completion == Completion::BREAK ? Completion::NORMAL : completion;
         }
     } while (is_truthy(evaluate(*stmt.condition)));
+    return Completion::NORMAL;
 }
 
-void Interpreter::execute(ForStmt& stmt) {
+Completion Interpreter::execute(ForStmt& stmt) {
     if (stmt.init) {
-        execute(*stmt.init);
+        Completion completion = execute(*stmt.init);
+        if (completion != Completion::NORMAL) {
+            return completion;
+        }
     }
 
     while (!stmt.condition || is_truthy(evaluate(*stmt.condition))) {
-        try {
-            execute(*stmt.body);
-        } catch (const BreakException&) {
-            break;
-        } catch (const ContinueException&) {
-            // Continue: execute update and continue
+        Completion completion = execute(*stmt.body);
+        if (leaves_loop(completion)) {
+            return completion == Completion::BREAK ? Completion::NORMAL : completion;
         }
 
+        // Continue: execute update and continue
         if (stmt.update) {
             evaluate(*stmt.update);
         }
     }
+    return Completion::NORMAL;
 }
 
-void Interpreter::execute(ForInStmt& stmt) {
-    std::vector<std::string> keys;
-
-    // Special handling for SYMTAB
-    if (stmt.array_name == "SYMTAB") {
-        keys = env_.get_all_variable_names();
-    }
-    // Special handling for FUNCTAB
-    else if (stmt.array_name == "FUNCTAB") {
-        keys = env_.get_all_function_names();
-    }
-    else {
-        AWKValue& arr = env_.get_variable(stmt.array_name);
-        if (!arr.is_array()) {
-            return;  // Not an array, nothing to iterate
+Completion Interpreter::execute(ForInStmt& stmt) {
+    // SYMTAB and FUNCTAB (gawk extensions) iterate over names
+    if (stmt.array_name == "SYMTAB" || stmt.array_name == "FUNCTAB") {
+        std::vector<std::string> keys = stmt.array_name == "SYMTAB"
+            ? env_.get_all_variable_names()
+            : env_.get_all_function_names();
+        for (const auto& key : keys) {
+            note_store(stmt.variable_ref);
+            variable(stmt.variable, stmt.variable_ref).assign_string(key);
+
+            Completion completion = execute(*stmt.body);
+            if (leaves_loop(completion)) {
+                return completion == Completion::BREAK ? Completion::NORMAL : completion;
+            }
         }
-        keys = arr.array_keys();
+        return Completion::NORMAL;
     }
 
-    for (const auto& key : keys) {
-        env_.set_variable(stmt.variable, AWKValue(key));
+    // Walk the array in place (not an array: nothing to iterate)
+    ArrayCursor cursor(variable(stmt.array_name, stmt.array_ref));
+    std::string_view key;
+    while (cursor.next(key)) {
+        note_store(stmt.variable_ref);
+        variable(stmt.variable, stmt.variable_ref).assign_string(key);
 
-        try {
-            execute(*stmt.body);
-        } catch (const BreakException&) {
-            break;
-        } catch (const ContinueException&) {
-            continue;
+        Completion completion = execute(*stmt.body);
+        if (leaves_loop(completion)) {
+            return completion == Completion::BREAK ? Completion::NORMAL : completion;
         }
     }
+    return Completion::NORMAL;
 }
 
-void Interpreter::execute(SwitchStmt& stmt) {
+Completion Interpreter::execute(SwitchStmt& stmt) {
     AWKValue switch_val = evaluate(*stmt.expression);
     bool matched = false;
 
+    // break exits the switch; continue belongs to an enclosing loop
     for (auto& [case_expr, case_body] : stmt.cases) {
         if (!matched) {
             AWKValue case_val = evaluate(*case_expr);
@@ -169,104 +187,110 @@ void Interpreter::execute(SwitchStmt& stmt) {
         }
 
         if (matched) {
-            try {
-                execute(*case_body);
-            } catch (const BreakException&) {
-                return;  // break exits switch
+            Completion completion = execute(*case_body);
+            if (completion != Completion::NORMAL) {
+                return completion == Completion::BREAK ? Completion::NORMAL : completion;
             }
         }
     }
 
     if (!matched && stmt.default_case) {
-        try {
-            execute(*stmt.default_case);
-        } catch (const BreakException&) {
-            return;
-        }
+        Completion completion = execute(*stmt.default_case);
+        return completion == Completion::BREAK ? Completion::NORMAL : completion;
     }
+    return Completion::NORMAL;
 }
 
 // ============================================================================
 // Print Statements
 // ============================================================================
 
-void Interpreter::execute(PrintStmt& stmt) {
-    std::ostream* out = output_;
+Completion Interpreter::execute(PrintStmt& stmt) {
+    OutputSink* out = output_sink_.get();
 
     if (stmt.output_redirect) {
         std::string target = evaluate(*stmt.output_redirect).to_string();
-        out = get_output_stream(target, stmt.redirect_type);
+        out = get_output_sink(target, stmt.redirect_type);
     }
 
     if (stmt.arguments.empty()) {
         // print without arguments: print $0
         rebuild_record();  // Important: rebuild record from modified fields
-        *out << current_record_;
+        out->write(current_record_);
     } else {
         // Cache OFS and OFMT for the loop to avoid repeated lookups
         const std::string& ofs = get_cached_ofs();
         const std::string& ofmt = get_cached_ofmt();
 
         bool first = true;
+        std::string scratch;
         for (auto& arg : stmt.arguments) {
             if (!first) {
-                *out << ofs;
+                out->write(ofs);
             }
             first = false;
 
             AWKValue val = evaluate(*arg);
-            *out << val.to_string(ofmt);
+            out->write(val.to_string_view(scratch, ofmt));
         }
     }
 
-    *out << get_cached_ors();
+    out->write(get_cached_ors());
+    out->end_statement();
+    return Completion::NORMAL;
 }
 
-void Interpreter::execute(PrintfStmt& stmt) {
-    std::ostream* out = output_;
+Completion Interpreter::execute(PrintfStmt& stmt) {
+    OutputSink* out = output_sink_.get();
 
     if (stmt.output_redirect) {
         std::string target = evaluate(*stmt.output_redirect).to_string();
-        out = get_output_stream(target, stmt.redirect_type);
+        out = get_output_sink(target, stmt.redirect_type);
     }
 
-    std::string format = evaluate(*stmt.format).to_string();
+    // Held: evaluating the arguments may call sprintf and evict it
+    std::shared_ptr<const FormatProgram> format = format_program(stmt);
     std::vector<AWKValue> args;
+    args.reserve(stmt.arguments.size());
 
     for (auto& arg : stmt.arguments) {
         args.push_back(evaluate(*arg));
     }
 
-    *out << do_sprintf(format, args);
+    format_buffer_.clear();
+    format->run(args.data(), args.size(), format_buffer_);
+    out->write(format_buffer_);
+    out->end_statement();
+    return Completion::NORMAL;
 }
 
 // ============================================================================
 // Expression Statement
 // ============================================================================
 
-void Interpreter::execute(ExprStmt& stmt) {
+Completion Interpreter::execute(ExprStmt& stmt) {
     evaluate(*stmt.expression);
+    return Completion::NORMAL;
 }
 
 // ============================================================================
 // Delete Statement
 // ============================================================================
 
-void Interpreter::execute(DeleteStmt& stmt) {
-    AWKValue& arr = env_.get_variable(stmt.array_name);
+Completion Interpreter::execute(DeleteStmt& stmt) {
+    AWKValue& arr = variable(stmt.array_name, stmt.array_ref);
 
     if (stmt.indices.empty()) {
         // Delete entire array
         arr.array_clear();
     } else {
         // Delete specific element
-        std::vector<AWKValue> idx_vals;
-        for (auto& idx : stmt.indices) {
-            idx_vals.push_back(evaluate(*idx));
-        }
-        std::string key = AWKValue::make_array_key(idx_vals, get_cached_subsep());
-        arr.array_delete(key);
+        AWKValue inline_keys[TupleKey::MAX_PARTS];
+        std::vector<AWKValue> more_keys;
+        AWKValue* keys = evaluate_subscripts(stmt.indices, inline_keys, more_keys);
+        delete_array_element(arr, keys, stmt.indices.size());
     }
+    return Completion::NORMAL;
 }
 
 } // namespace awk
@@ -16,8 +16,8 @@ namespace awk {
 
 AWKValue Interpreter::evaluate(GetlineExpr& expr) {
     // Complete getline implementation for all variants:
-    // 1. getline              - from stdin into $0, NR++
-    // 2. getline var          - from stdin into var, NR++
+    // 1. getline              - from main input into $0, NR++ FNR++
+    // 2. getline var          - from main input into var, NR++ FNR++
     // 3. getline < file       - from file into $0
     // 4. getline var < file   - from file into var
     // 5. command | getline    - from pipe into $0
@@ -35,25 +35,26 @@ AWKValue Interpreter::evaluate(GetlineExpr& expr) {
             result = getline_from_coprocess(cmd, expr.variable.get());
         } else {
             // Variant 5/6: command | getline [var]
-            FILE* pipe = get_input_pipe(cmd);
+            RecordReader* pipe = get_input_pipe(cmd);
             if (!pipe) {
                 return AWKValue(-1.0);
             }
-            result = getline_from_pipe(pipe, expr.variable.get(), false);
+            result = getline_from_reader(*pipe, expr.variable.get(), false);
         }
     }
     else if (expr.file) {
         // Variant 3/4: getline [var] < file
         std::string filename = evaluate(*expr.file).to_string();
-        std::istream* stream = get_input_file(filename);
-        if (!stream) {
+        RecordReader* input = get_input_file(filename);
+        if (!input) {
             return AWKValue(-1.0);
         }
-        result = getline_from_stream(*stream, expr.variable.get(), false);
+        result = getline_from_reader(*input, expr.variable.get(), false);
     }
     else {
-        // Variant 1/2: getline [var] (from stdin)
-        result = getline_from_stream(std::cin, expr.variable.get(), true);
+        // Variant 1/2: getline [var] (from the current input, else stdin)
+        result = getline_from_reader(main_input_ ? *main_input_ : stdin_reader(),
+                                     expr.variable.get(), true);
     }
 
     return AWKValue(static_cast<double>(result));
@@ -63,10 +64,10 @@ AWKValue Interpreter::evaluate(GetlineExpr& expr) {
 // Input File Management
 // ============================================================================
 
-std::istream* Interpreter::get_input_file(const std::string& filename) {
+RecordReader* Interpreter::get_input_file(const std::string& filename) {
     // Special files (gawk compatibility)
     if (filename == "/dev/stdin" || filename == "-") {
-        return &std::cin;
+        return &stdin_reader();
     }
 
     // Already open?
@@ -76,13 +77,13 @@ std::istream* Interpreter::get_input_file(const std::string& filename) {
     }
 
     // Open new file
-    auto file = std::make_unique<std::ifstream>(filename);
-    if (!file->is_open()) {
+    auto file = RecordReader::open(filename);
+    if (!file) {
         *error_ << "awk: can't open file " << filename << " for reading: " << safe_strerror(errno) << "\n";
         return nullptr;
     }
 
-    std::istream* ptr = file.get();
+    RecordReader* ptr = file.get();
     input_files_[filename] = std::move(file);
     return ptr;
 }
@@ -91,13 +92,16 @@ std::istream* Interpreter::get_input_file(const std::string& filename) {
 // Input Pipe Management
 // ============================================================================
 
-FILE* Interpreter::get_input_pipe(const std::string& command) {
+RecordReader* Interpreter::get_input_pipe(const std::string& command) {
     // Already open?
     auto it = input_pipes_.find(command);
     if (it != input_pipes_.end()) {
-        return it->second;
+        return it->second.reader.get();
     }
 
+    // The command may write to our stdout or read what we wrote
+    flush_all_files();
+
     // Open new pipe
 #ifdef _WIN32
     FILE* pipe = _popen(command.c_str(), "r");
@@ -110,42 +114,26 @@ FILE* Interpreter::get_input_pipe(const std::string& command) {
         return nullptr;
     }
 
-    input_pipes_[command] = pipe;
-    return pipe;
+    // Records are read from the descriptor; the FILE* is kept for pclose()
+    InputPipe& input = input_pipes_[command];
+    input.pipe = pipe;
+#ifdef _WIN32
+    input.reader = std::make_unique<RecordReader>(_fileno(pipe));
+#else
+    input.reader = std::make_unique<RecordReader>(fileno(pipe));
+#endif
+    return input.reader.get();
 }
 
 // ============================================================================
-// Getline from Stream
+// Getline from Reader
 // ============================================================================
 
-int Interpreter::getline_from_stream(std::istream& stream, Expr* variable, bool update_nr) {
-    std::string rs = env_.RS().to_string();
-    std::string line;
-
-    if (rs.empty() || rs == "\n") {
-        // Standard: read line by line
-        if (!std::getline(stream, line)) {
-            return stream.eof() ? -1 : 0;  // -1 = EOF, 0 = error
-        }
-    } else if (rs.length() == 1) {
-        // Single character as RS
-        char delimiter = rs[0];
-        line.clear();
-        char c;
-        bool read_any = false;
-        while (stream.get(c)) {
-            read_any = true;
-            if (c == delimiter) break;
-            line += c;
-        }
-        if (!read_any && stream.eof()) {
-            return -1;  // EOF
-        }
-    } else {
-        // Multi-character RS (simplified: line by line)
-        if (!std::getline(stream, line)) {
-            return stream.eof() ? -1 : 0;
-        }
+int Interpreter::getline_from_reader(RecordReader& input, Expr* variable, bool update_nr) {
+    std::string_view line;
+    std::string_view rt;
+    if (!input.read_record(env_.RS().to_string(), line, rt)) {
+        return input.failed() ? 0 : -1;  // -1 = EOF, 0 = error
     }
 
     // Store value
@@ -154,13 +142,17 @@ int Interpreter::getline_from_stream(std::istream& stream, Expr* variable, bool
         var = AWKValue::strnum(line);
     } else {
         // Store in $0 and update fields
-        set_record(line);
+        set_record(std::string(line));
     }
 
-    // Update NR if desired (only for stdin)
+    // Update NR/FNR when reading the main input
     if (update_nr) {
         double nr = env_.NR().to_number() + 1;
         env_.NR() = AWKValue(nr);
+        if (main_input_) {
+            double fnr = env_.FNR().to_number() + 1;
+            env_.FNR() = AWKValue(fnr);
+        }
     }
 
     return 1;  // Success
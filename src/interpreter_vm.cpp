@@ -0,0 +1,485 @@
+// ============================================================================
+// interpreter_vm.cpp - Bytecode Virtual Machine
+// ============================================================================
+
+#include "awk/interpreter.hpp"
+
+namespace awk {
+
+namespace {
+
+AWKValue arithmetic(OpCode op, const AWKValue& left, const AWKValue& right) {
+    switch (op) {
+        case OpCode::ADD: return left + right;
+        case OpCode::SUB: return left - right;
+        case OpCode::MUL: return left * right;
+        case OpCode::DIV: return left / right;
+        case OpCode::MOD: return left % right;
+        case OpCode::POW: return left.power(right);
+        default:          return AWKValue();
+    }
+}
+
+// Compound assignment in place (target op= value)
+void assign_arithmetic(OpCode op, AWKValue& target, const AWKValue& value) {
+    switch (op) {
+        case OpCode::ADD: target.set_number(target.to_number() + value.to_number()); break;
+        case OpCode::SUB: target.set_number(target.to_number() - value.to_number()); break;
+        case OpCode::MUL: target.set_number(target.to_number() * value.to_number()); break;
+        case OpCode::DIV: target /= value; break;
+        case OpCode::MOD: target %= value; break;
+        case OpCode::POW: target = target.power(value); break;
+        default: break;
+    }
+}
+
+AWKValue increment(AWKValue& target, int32_t flags) {
+    bool decrement = (flags & INCR_DECREMENT) != 0;
+    if (flags & INCR_POSTFIX) {
+        return decrement ? target.post_decrement() : target.post_increment();
+    }
+    return decrement ? target.pre_decrement() : target.pre_increment();
+}
+
+} // anonymous namespace
+
+// ============================================================================
+// Execution Loop
+// ============================================================================
+
+Completion Interpreter::run_chunk(const Chunk& chunk) {
+    // Restores the value stack and the for-in iterators on every exit path,
+    // including early completions and errors unwinding through the VM
+    struct StackGuard {
+        Interpreter& interp;
+        size_t stack_base;
+        size_t iter_base;
+        ~StackGuard() {
+            interp.vm_stack_.resize(stack_base);
+            interp.vm_iterators_.resize(iter_base);
+        }
+    } guard{*this, vm_stack_.size(), vm_iterators_.size()};
+
+    // Note: nested calls may reallocate the stack, so values are addressed by
+    // index and never held by reference across an instruction that calls out.
+    std::vector<AWKValue>& stack = vm_stack_;
+    const Instruction* code = chunk.code.data();
+    size_t pc = 0;
+
+    for (;;) {
+        const Instruction& ins = code[pc++];
+
+        switch (ins.op) {
+            // ----------------------------------------------------------------
+            // Constants and stack manipulation
+            // ----------------------------------------------------------------
+            case OpCode::PUSH_CONST:
+                stack.push_back(chunk.constants[ins.a]);
+                break;
+
+            case OpCode::PUSH_UNINIT:
+                stack.emplace_back();
+                break;
+
+            case OpCode::POP:
+                stack.pop_back();
+                break;
+
+            case OpCode::DUP: {
+                AWKValue copy = stack.back();
+                stack.push_back(std::move(copy));
+                break;
+            }
+
+            // ----------------------------------------------------------------
+            // Variables
+            // ----------------------------------------------------------------
+            case OpCode::LOAD_VAR: {
+                const ChunkVar& var = chunk.vars[ins.a];
+                stack.push_back(variable(var));
+                break;
+            }
+
+            case OpCode::STORE_VAR: {
+                const ChunkVar& var = chunk.vars[ins.a];
+                note_store(var.ref);
+                variable(var) = stack.back();
+                break;
+            }
+
+            case OpCode::APPEND_VAR: {
+                const ChunkVar& var = chunk.vars[ins.a];
+                note_store(var.ref);
+                std::string scratch;
+                variable(var).append_string(stack.back().to_string_view(scratch));
+                stack.pop_back();
+                break;
+            }
+
+            case OpCode::INCR_VAR: {
+                const ChunkVar& var = chunk.vars[ins.a];
+                note_store(var.ref);
+                stack.push_back(increment(variable(var), ins.b));
+                break;
+            }
+
+            case OpCode::AUG_VAR: {
+                const ChunkVar& var = chunk.vars[ins.a];
+                note_store(var.ref);
+                AWKValue& target = variable(var);
+                assign_arithmetic(static_cast<OpCode>(ins.b), target, stack.back());
+                stack.back() = target;
+                break;
+            }
+
+            // ----------------------------------------------------------------
+            // Fields
+            // ----------------------------------------------------------------
+            case OpCode::LOAD_FIELD: {
+                int index = static_cast<int>(stack.back().to_number());
+                stack.back() = get_field(index);
+                break;
+            }
+
+            case OpCode::STORE_FIELD: {
+                int index = static_cast<int>(stack.back().to_number());
+                stack.pop_back();
+                set_field(index, stack.back());
+                stack.back() = get_field(index);
+                break;
+            }
+
+            case OpCode::INCR_FIELD: {
+                int index = static_cast<int>(stack.back().to_number());
+                stack.back() = increment(get_field(index), ins.b);
+                break;
+            }
+
+            case OpCode::AUG_FIELD: {
+                int index = static_cast<int>(stack.back().to_number());
+                stack.pop_back();
+                set_field(index, arithmetic(static_cast<OpCode>(ins.b), get_field(index), stack.back()));
+                stack.back() = get_field(index);
+                break;
+            }
+
+            // ----------------------------------------------------------------
+            // Arrays
+            // ----------------------------------------------------------------
+            case OpCode::LOAD_ELEM: {
+                size_t count = static_cast<size_t>(ins.b);
+                size_t base = stack.size() - count;
+                AWKValue value = array_element(variable(chunk.vars[ins.a]), &stack[base], count);
+                stack.resize(base);
+                stack.push_back(std::move(value));
+                break;
+            }
+
+            case OpCode::STORE_ELEM: {
+                size_t count = static_cast<size_t>(ins.b);
+                size_t base = stack.size() - count;
+                AWKValue& elem = array_element(variable(chunk.vars[ins.a]), &stack[base], count);
+                stack.resize(base);
+                elem = stack.back();
+                break;
+            }
+
+            case OpCode::INCR_ELEM: {
+                size_t count = static_cast<size_t>(ins.b & 0xFFFF);
+                size_t base = stack.size() - count;
+                AWKValue& elem = array_element(variable(chunk.vars[ins.a]), &stack[base], count);
+                AWKValue result = increment(elem, ins.b >> 16);
+                stack.resize(base);
+                stack.push_back(std::move(result));
+                break;
+            }
+
+            case OpCode::AUG_ELEM: {
+                size_t count = static_cast<size_t>(ins.b & 0xFFFF);
+                size_t base = stack.size() - count;
+                AWKValue& elem = array_element(variable(chunk.vars[ins.a]), &stack[base], count);
+                stack.resize(base);
+                assign_arithmetic(static_cast<OpCode>(ins.b >> 16), elem, stack.back());
+                stack.back() = elem;
+                break;
+            }
+
+            case OpCode::IN_ARRAY: {
+                size_t count = static_cast<size_t>(ins.b);
+                size_t base = stack.size() - count;
+                bool found = array_has_element(variable(chunk.vars[ins.a]), &stack[base], count);
+                stack.resize(base);
+                stack.emplace_back(found ? 1.0 : 0.0);
+                break;
+            }
+
+            case OpCode::DELETE_ELEM: {
+                size_t count = static_cast<size_t>(ins.b);
+                size_t base = stack.size() - count;
+                delete_array_element(variable(chunk.vars[ins.a]), &stack[base], count);
+                stack.resize(base);
+                break;
+            }
+
+            case OpCode::DELETE_ARRAY:
+                variable(chunk.vars[ins.a]).array_clear();
+                break;
+
+            // ----------------------------------------------------------------
+            // Arithmetic and comparison
+            // ----------------------------------------------------------------
+            case OpCode::ADD:
+            case OpCode::SUB:
+            case OpCode::MUL:
+            case OpCode::DIV:
+            case OpCode::MOD:
+            case OpCode::POW: {
+                size_t n = stack.size();
+                AWKValue result = arithmetic(ins.op, stack[n - 2], stack[n - 1]);
+                stack.pop_back();
+                stack.back() = std::move(result);
+                break;
+            }
+
+            case OpCode::NEG:
+                stack.back() = -stack.back();
+                break;
+
+            case OpCode::PLUS:
+                stack.back() = +stack.back();
+                break;
+
+            case OpCode::NOT:
+                stack.back() = AWKValue(is_truthy(stack.back()) ? 0.0 : 1.0);
+                break;
+
+            case OpCode::EQ:
+            case OpCode::NE:
+            case OpCode::LT:
+            case OpCode::GT:
+            case OpCode::LE:
+            case OpCode::GE: {
+                size_t n = stack.size();
+                const AWKValue& left = stack[n - 2];
+                const AWKValue& right = stack[n - 1];
+                bool result = false;
+                switch (ins.op) {
+                    case OpCode::EQ: result = left == right; break;
+                    case OpCode::NE: result = left != right; break;
+                    case OpCode::LT: result = left < right; break;
+                    case OpCode::GT: result = left > right; break;
+                    case OpCode::LE: result = left <= right; break;
+                    default:         result = left >= right; break;
+                }
+                stack.pop_back();
+                stack.back() = AWKValue(result ? 1.0 : 0.0);
+                break;
+            }
+
+            // ----------------------------------------------------------------
+            // Strings and regular expressions
+            // ----------------------------------------------------------------
+            case OpCode::CONCAT: {
+                size_t count = static_cast<size_t>(ins.a);
+                size_t base = stack.size() - count;
+                std::string result;
+                std::string scratch;
+                for (size_t i = base; i < stack.size(); ++i) {
+                    result += stack[i].to_string_view(scratch);
+                }
+                stack.resize(base);
+                stack.emplace_back(std::move(result));
+                break;
+            }
+
+            case OpCode::MATCH:
+            case OpCode::NOT_MATCH: {
+                size_t n = stack.size();
+                bool matches = regex_match(stack[n - 2], stack[n - 1]);
+                if (ins.op == OpCode::NOT_MATCH) matches = !matches;
+                stack.pop_back();
+                stack.back() = AWKValue(matches ? 1.0 : 0.0);
+                break;
+            }
+
+            case OpCode::MATCH_REGEX: {
+                std::string scratch;
+                bool matches = regex_match(stack.back().to_string_view(scratch), *chunk.regexes[ins.a]);
+                if (ins.b) matches = !matches;
+                stack.back() = AWKValue(matches ? 1.0 : 0.0);
+                break;
+            }
+
+            case OpCode::MATCH_RECORD: {
+                bool matches = match_record(*chunk.regexes[ins.a]);
+                stack.emplace_back(matches ? 1.0 : 0.0);
+                break;
+            }
+
+            // ----------------------------------------------------------------
+            // Control flow
+            // ----------------------------------------------------------------
+            case OpCode::JUMP:
+                pc = static_cast<size_t>(ins.a);
+                break;
+
+            case OpCode::JUMP_IF_FALSE: {
+                bool cond = is_truthy(stack.back());
+                stack.pop_back();
+                if (!cond) pc = static_cast<size_t>(ins.a);
+                break;
+            }
+
+            case OpCode::JUMP_IF_TRUE: {
+                bool cond = is_truthy(stack.back());
+                stack.pop_back();
+                if (cond) pc = static_cast<size_t>(ins.a);
+                break;
+            }
+
+            // ----------------------------------------------------------------
+            // Calls
+            // ----------------------------------------------------------------
+            case OpCode::CALL_BUILTIN:
+            case OpCode::CALL_USER:
+            case OpCode::CALL_NAMED: {
+                size_t base = stack.size() - static_cast<size_t>(ins.b & 0xFFFF);
+                std::vector<AWKValue> args(std::make_move_iterator(stack.begin() + base),
+                                           std::make_move_iterator(stack.end()));
+                stack.resize(base);
+
+                // Uninitialized variable arguments (see call_function)
+                std::vector<AWKValue*> untyped;
+                if (size_t site = static_cast<size_t>(ins.b >> 16)) {
+                    for (int32_t var : chunk.call_args[site - 1]) {
+                        AWKValue* value = var >= 0 ? &variable(chunk.vars[var]) : nullptr;
+                        untyped.push_back(value && value->is_uninitialized() ? value : nullptr);
+                    }
+                }
+                AWKValue* const* untyped_args = untyped.empty() ? nullptr : untyped.data();
+
+                AWKValue result;
+                if (ins.op == OpCode::CALL_BUILTIN) {
+                    result = (*chunk.builtins[ins.a])(args, *this);
+                } else if (ins.op == OpCode::CALL_USER) {
+                    result = call_user_function(compiled_->function_defs[ins.a], args, untyped_args);
+                } else {
+                    result = call_function(chunk.names[ins.a], args, untyped_args);
+                }
+                stack.push_back(std::move(result));
+                break;
+            }
+
+            case OpCode::EVAL_EXPR: {
+                AWKValue result = evaluate(*chunk.exprs[ins.a]);
+                stack.push_back(std::move(result));
+                break;
+            }
+
+            case OpCode::EXEC_STMT: {
+                Completion completion = execute(*chunk.stmts[ins.a]);
+                if (completion != Completion::NORMAL) {
+                    return completion;
+                }
+                break;
+            }
+
+            // ----------------------------------------------------------------
+            // Statements
+            // ----------------------------------------------------------------
+            case OpCode::PRINT: {
+                size_t argc = static_cast<size_t>(ins.a);
+                auto redirect = static_cast<RedirectType>(ins.b);
+                size_t base = stack.size() - argc;
+
+                OutputSink* out = output_sink_.get();
+                if (redirect != RedirectType::NONE) {
+                    out = get_output_sink(stack[base - 1].to_string(), redirect);
+                }
+
+                if (argc == 0) {
+                    rebuild_record();
+                    out->write(current_record_);
+                } else {
+                    const std::string& ofs = get_cached_ofs();
+                    const std::string& ofmt = get_cached_ofmt();
+                    std::string scratch;
+                    for (size_t i = base; i < stack.size(); ++i) {
+                        if (i > base) out->write(ofs);
+                        out->write(stack[i].to_string_view(scratch, ofmt));
+                    }
+                }
+                out->write(get_cached_ors());
+                out->end_statement();
+
+                stack.resize(redirect != RedirectType::NONE ? base - 1 : base);
+                break;
+            }
+
+            case OpCode::PRINTF: {
+                size_t argc = static_cast<size_t>(ins.a);
+                auto redirect = static_cast<RedirectType>(ins.b);
+                size_t base = stack.size() - argc;
+
+                OutputSink* out = output_sink_.get();
+                if (redirect != RedirectType::NONE) {
+                    out = get_output_sink(stack[base - 1].to_string(), redirect);
+                }
+
+                format_buffer_.clear();
+                format_program(stack[base].to_string())
+                    ->run(stack.data() + base + 1, argc - 1, format_buffer_);
+                out->write(format_buffer_);
+                out->end_statement();
+
+                stack.resize(redirect != RedirectType::NONE ? base - 1 : base);
+                break;
+            }
+
+            case OpCode::FORIN_BEGIN: {
+                vm_iterators_.push_back(VMIterator{ArrayCursor(variable(chunk.vars[ins.a]))});
+                break;
+            }
+
+            case OpCode::FORIN_NEXT: {
+                std::string_view key;
+                if (vm_iterators_.back().cursor.next(key)) {
+                    const ChunkVar& var = chunk.vars[ins.a];
+                    note_store(var.ref);
+                    variable(var).assign_string(key);
+                } else {
+                    vm_iterators_.pop_back();
+                    pc = static_cast<size_t>(ins.b);
+                }
+                break;
+            }
+
+            case OpCode::FORIN_END:
+                vm_iterators_.pop_back();
+                break;
+
+            case OpCode::NEXT:
+                return Completion::NEXT;
+
+            case OpCode::NEXTFILE:
+                return Completion::NEXTFILE;
+
+            case OpCode::EXIT:
+                exit_status_ = ins.a ? static_cast<int>(stack.back().to_number()) : 0;
+                return Completion::EXIT;
+
+            case OpCode::RETURN:
+                if (ins.a) {
+                    return_value_ = std::move(stack.back());
+                } else {
+                    return_value_ = AWKValue();
+                }
+                return Completion::RETURN;
+
+            case OpCode::HALT:
+                return Completion::NORMAL;
+        }
+    }
+}
+
+} // namespace awk
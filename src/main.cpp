@@ -8,6 +8,7 @@
 #include <sstream>
 #include <string>
 #include <vector>
+#include <cstdlib>
 #include <cstring>
 #include <cerrno>
 
@@ -18,6 +19,11 @@ void print_usage(const char* program_name) {
               << "  -F fs         Set field separator to fs\n"
               << "  -v var=value  Assign value to variable before execution\n"
               << "  -f progfile   Read program from file\n"
+              << "  --engine=E    Execution engine: tree (default) or vm (bytecode)\n"
+              << "  --mmap        Memory-map regular input files (default)\n"
+              << "  --no-mmap     Read input files with buffered read() calls\n"
+              << "  --max-open-files=N\n"
+              << "                Output files kept open at once (default: from the fd limit)\n"
               << "  -h, --help    Show this help message\n"
               << "  --version     Show version information\n";
 }
@@ -35,6 +41,9 @@ int main(int argc, char* argv[]) {
     std::string field_separator;
     bool program_from_file = false;
     std::string program_file;
+    awk::Engine engine = awk::Engine::TREE;
+    bool mmap_input = true;
+    size_t max_open_files = 0;  // 0: default
 
     // Parse arguments
     int i = 1;
@@ -51,6 +60,39 @@ int main(int argc, char* argv[]) {
             return 0;
         }
 
+        if (arg.substr(0, 9) == "--engine=") {
+            std::string name = arg.substr(9);
+            if (name == "tree") {
+                engine = awk::Engine::TREE;
+            } else if (name == "vm") {
+                engine = awk::Engine::VM;
+            } else {
+                std::cerr << "awk: unknown engine: " << name << " (expected tree or vm)\n";
+                return 1;
+            }
+            ++i;
+            continue;
+        }
+
+        if (arg == "--mmap" || arg == "--no-mmap") {
+            mmap_input = arg == "--mmap";
+            ++i;
+            continue;
+        }
+
+        if (arg.substr(0, 17) == "--max-open-files=") {
+            std::string value = arg.substr(17);
+            char* end = nullptr;
+            unsigned long count = std::strtoul(value.c_str(), &end, 10);
+            if (value.empty() || *end != '\0' || count == 0) {
+                std::cerr << "awk: invalid --max-open-files value: " << value << "\n";
+                return 1;
+            }
+            max_open_files = static_cast<size_t>(count);
+            ++i;
+            continue;
+        }
+
         if (arg == "-F") {
             if (i + 1 >= argc) {
                 std::cerr << "awk: option -F requires an argument\n";
@@ -155,6 +197,11 @@ int main(int argc, char* argv[]) {
 
     // Interpreter
     awk::Interpreter interpreter;
+    interpreter.set_engine(engine);
+    interpreter.set_mmap_input(mmap_input);
+    if (max_open_files > 0) {
+        interpreter.set_max_open_files(max_open_files);
+    }
 
     // Set field separator
     if (!field_separator.empty()) {
@@ -0,0 +1,140 @@
+#include "awk/number_conv.hpp"
+#include <charconv>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace awk {
+namespace numconv {
+
+namespace {
+
+const char DIGIT_PAIRS[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+#if defined(__cpp_lib_to_chars)
+// Conversion and precision of a format that is exactly "%[.N]g|f|e"
+bool simple_format(const char* format, std::chars_format& style, int& precision) {
+    if (format[0] != '%') {
+        return false;
+    }
+    const char* p = format + 1;
+    precision = 6;
+    if (*p == '.') {
+        ++p;
+        precision = 0;
+        while (*p >= '0' && *p <= '9' && precision < 100) {
+            precision = precision * 10 + (*p++ - '0');
+        }
+    }
+    switch (*p) {
+        case 'g': style = std::chars_format::general; break;
+        case 'f': style = std::chars_format::fixed; break;
+        case 'e': style = std::chars_format::scientific; break;
+        default: return false;
+    }
+    return p[1] == '\0';
+}
+#endif
+
+} // namespace
+
+char* format_integer(long long value, char* buf) {
+    unsigned long long n = static_cast<unsigned long long>(value);
+    if (value < 0) {
+        *buf++ = '-';
+        n = 0 - n;  // Also right for LLONG_MIN
+    }
+
+    // Digits are produced from the right, two at a time
+    char digits[INTEGER_DIGITS];
+    char* p = digits + sizeof(digits);
+    while (n >= 100) {
+        unsigned pair = static_cast<unsigned>(n % 100) * 2;
+        n /= 100;
+        *--p = DIGIT_PAIRS[pair + 1];
+        *--p = DIGIT_PAIRS[pair];
+    }
+    if (n >= 10) {
+        unsigned pair = static_cast<unsigned>(n) * 2;
+        *--p = DIGIT_PAIRS[pair + 1];
+        *--p = DIGIT_PAIRS[pair];
+    } else {
+        *--p = static_cast<char>('0' + n);
+    }
+
+    size_t count = static_cast<size_t>(digits + sizeof(digits) - p);
+    std::memcpy(buf, p, count);
+    return buf + count;
+}
+
+size_t format_double(double num, const char* format, char* buf, size_t size) {
+#if defined(__cpp_lib_to_chars)
+    std::chars_format style;
+    int precision;
+    // printf spells infinities and NaNs its own way; leave those to it
+    if (std::isfinite(num) && size > 0 && simple_format(format, style, precision)) {
+        auto result = std::to_chars(buf, buf + size - 1, num, style, precision);
+        if (result.ec == std::errc()) {
+            *result.ptr = '\0';
+            return static_cast<size_t>(result.ptr - buf);
+        }
+    }
+#endif
+    int written = std::snprintf(buf, size, format, num);
+    return written < 0 ? 0 : static_cast<size_t>(written);
+}
+
+double parse_number(const char* str, size_t size) {
+    const char* s = str;
+    const char* end = str + size;
+
+    while (s < end && std::isspace(static_cast<unsigned char>(*s))) ++s;
+    if (s == end) return 0.0;
+
+    // Hexadecimal integers
+    if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+        return static_cast<double>(std::strtoll(s, nullptr, 16));
+    }
+
+#if defined(__cpp_lib_to_chars)
+    // from_chars takes neither a '+' nor hexadecimal floats ("-0x1p3"),
+    // which strtod still handles
+    const char* p = s;
+    bool negative = false;
+    if (*p == '+' || *p == '-') {
+        negative = *p == '-';
+        ++p;
+    }
+    if (p == end || *p == '+' || *p == '-') return 0.0;
+    if (!(p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))) {
+        double value;
+        auto result = std::from_chars(p, end, value);
+        if (result.ec == std::errc()) {
+            return negative ? -value : value;
+        }
+        if (result.ec == std::errc::invalid_argument) {
+            return 0.0;
+        }
+        // Out of range: strtod gives the infinity or zero it rounds to
+    }
+#endif
+
+    char* parsed;
+    double value = std::strtod(s, &parsed);
+    return parsed == s ? 0.0 : value;
+}
+
+} // namespace numconv
+} // namespace awk
@@ -0,0 +1,135 @@
+// ============================================================================
+// output_file_pool.cpp - Files of print > and print >>
+// ============================================================================
+
+#include "awk/output_file_pool.hpp"
+#include <algorithm>
+#include <cerrno>
+
+#ifdef _WIN32
+#include <cstdio>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace awk {
+
+namespace {
+
+// Descriptors left for stdin/stdout/stderr, getline files and pipes
+constexpr size_t RESERVED_DESCRIPTORS = 64;
+
+// Used when the descriptor limit is unknown or unlimited
+constexpr size_t FALLBACK_LIMIT = 65536;
+
+constexpr size_t MIN_OPEN = 1;
+
+} // namespace
+
+size_t OutputFilePool::default_max_open() {
+    size_t limit = FALLBACK_LIMIT;
+#ifdef _WIN32
+    limit = static_cast<size_t>(_getmaxstdio());
+#else
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY) {
+        limit = std::min(static_cast<size_t>(rl.rlim_cur), FALLBACK_LIMIT);
+    }
+#endif
+    size_t available = limit > RESERVED_DESCRIPTORS * 2 ? limit - RESERVED_DESCRIPTORS : limit / 2;
+    return std::max(available, MIN_OPEN);
+}
+
+OutputFilePool::OutputFilePool(size_t max_open)
+    : max_open_(std::max(max_open, MIN_OPEN)) {}
+
+OutputSink* OutputFilePool::get(const std::string& path, bool append) {
+    auto it = files_.find(path);
+    if (it != files_.end()) {
+        Entry& entry = it->second;
+        if (entry.sink->is_open()) {
+            if (entry.lru != lru_.begin()) {
+                lru_.splice(lru_.begin(), lru_, entry.lru);
+            }
+            return entry.sink.get();
+        }
+        // Released earlier: continue the file
+        if (!open_with_room([&]() { return entry.sink->reopen(); })) {
+            return nullptr;
+        }
+        entry.lru = lru_.insert(lru_.begin(), &entry);
+        return entry.sink.get();
+    }
+
+    std::unique_ptr<OutputSink> sink;
+    if (!open_with_room([&]() {
+            sink = OutputSink::open_file(path, append);
+            return sink != nullptr;
+        })) {
+        return nullptr;
+    }
+    Entry& entry = files_[path];
+    entry.sink = std::move(sink);
+    entry.lru = lru_.insert(lru_.begin(), &entry);
+    return entry.sink.get();
+}
+
+OutputSink* OutputFilePool::find(const std::string& path) {
+    auto it = files_.find(path);
+    return it != files_.end() ? it->second.sink.get() : nullptr;
+}
+
+bool OutputFilePool::close(const std::string& path) {
+    auto it = files_.find(path);
+    if (it == files_.end()) {
+        return false;
+    }
+    if (it->second.sink->is_open()) {
+        lru_.erase(it->second.lru);
+    }
+    it->second.sink->close();
+    files_.erase(it);
+    return true;
+}
+
+void OutputFilePool::flush_all() {
+    // Released files have nothing buffered
+    for (Entry* entry : lru_) {
+        entry->sink->flush();
+    }
+}
+
+void OutputFilePool::clear() {
+    lru_.clear();
+    files_.clear();  // The sinks flush and close themselves
+}
+
+void OutputFilePool::set_max_open(size_t max_open) {
+    max_open_ = std::max(max_open, MIN_OPEN);
+    release_until(max_open_);
+}
+
+void OutputFilePool::release_until(size_t keep) {
+    while (lru_.size() > keep) {
+        lru_.back()->sink->release();
+        lru_.pop_back();
+    }
+}
+
+template <typename Open>
+bool OutputFilePool::open_with_room(Open open) {
+    release_until(max_open_ - 1);
+    for (;;) {
+        if (open()) {
+            return true;
+        }
+        // Other descriptors (getline files, pipes) may fill the process
+        // limit before the pool reaches max_open_
+        if ((errno != EMFILE && errno != ENFILE) || lru_.empty()) {
+            return false;
+        }
+        release_until(lru_.size() - 1);
+    }
+}
+
+} // namespace awk
@@ -0,0 +1,205 @@
+// ============================================================================
+// output_sink.cpp - Buffered output of print and printf
+// ============================================================================
+
+#include "awk/output_sink.hpp"
+#include <cerrno>
+#include <iostream>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace awk {
+
+namespace {
+
+// write(2) of all size bytes with EINTR and short-write retry
+bool write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+#ifdef _WIN32
+        int n = _write(fd, data, static_cast<unsigned int>(size));
+#else
+        ssize_t n = ::write(fd, data, size);
+#endif
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// The buffered text and data with as few system calls as possible
+bool write_both(int fd, const char* buffered, size_t buffered_size,
+                const char* data, size_t size) {
+#ifdef _WIN32
+    return write_all(fd, buffered, buffered_size) && write_all(fd, data, size);
+#else
+    if (buffered_size == 0) return write_all(fd, data, size);
+    if (size == 0) return write_all(fd, buffered, buffered_size);
+
+    struct iovec parts[2];
+    parts[0].iov_base = const_cast<char*>(buffered);
+    parts[0].iov_len = buffered_size;
+    parts[1].iov_base = const_cast<char*>(data);
+    parts[1].iov_len = size;
+    ssize_t n;
+    do {
+        n = ::writev(fd, parts, 2);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) return false;
+
+    // Finish a short write with plain writes
+    size_t done = static_cast<size_t>(n);
+    if (done < buffered_size) {
+        return write_all(fd, buffered + done, buffered_size - done) &&
+               write_all(fd, data, size);
+    }
+    done -= buffered_size;
+    return write_all(fd, data + done, size - done);
+#endif
+}
+
+// Descriptor for print > (truncating) or print >> (appending)
+int open_output(const std::string& path, bool append) {
+#ifdef _WIN32
+    int flags = _O_WRONLY | _O_CREAT | _O_BINARY | (append ? _O_APPEND : _O_TRUNC);
+    return _open(path.c_str(), flags, _S_IREAD | _S_IWRITE);
+#else
+    int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (append ? O_APPEND : O_TRUNC);
+    return ::open(path.c_str(), flags, 0666);
+#endif
+}
+
+} // namespace
+
+OutputSink::OutputSink() = default;
+
+OutputSink::OutputSink(int fd, bool owns_fd, size_t buffer_size)
+    : buffer_size_(buffer_size), fd_(fd), owns_fd_(owns_fd) {}
+
+OutputSink::OutputSink(std::ostream& stream, size_t buffer_size)
+    : buffer_size_(buffer_size), stream_(&stream) {}
+
+OutputSink::~OutputSink() {
+    close();
+}
+
+std::unique_ptr<OutputSink> OutputSink::open_file(const std::string& path, bool append) {
+    int fd = open_output(path, append);
+    if (fd < 0) {
+        return nullptr;
+    }
+    auto sink = std::make_unique<OutputSink>(fd, true);
+    sink->path_ = path;
+    return sink;
+}
+
+bool OutputSink::release() {
+    bool ok = close();
+    buffer_.reset();
+    capacity_ = 0;
+    return ok;
+}
+
+bool OutputSink::reopen() {
+    if (fd_ >= 0) {
+        return true;
+    }
+    fd_ = open_output(path_, true);
+    owns_fd_ = fd_ >= 0;
+    return owns_fd_;
+}
+
+std::unique_ptr<OutputSink> OutputSink::for_stream(std::ostream& stream) {
+    if (&stream != &std::cout) {
+        return std::make_unique<OutputSink>(stream);
+    }
+    // Anything already in std::cout goes first
+    std::cout.flush();
+#ifdef _WIN32
+    int fd = _fileno(stdout);
+    bool terminal = _isatty(fd) != 0;
+#else
+    int fd = STDOUT_FILENO;
+    bool terminal = isatty(fd) != 0;
+#endif
+    auto sink = std::make_unique<OutputSink>(fd, false);
+    sink->set_line_buffered(terminal);
+    return sink;
+}
+
+void OutputSink::write_through(const char* data, size_t size) {
+    if (buffer_size_ == 0) {
+        return;  // Discarding sink
+    }
+    if (capacity_ == 0) {
+        buffer_.reset(new char[buffer_size_]);
+        capacity_ = buffer_size_;
+        if (size <= capacity_) {
+            std::memcpy(buffer_.get(), data, size);
+            used_ = size;
+            return;
+        }
+    }
+    if (used_ + size < 2 * capacity_) {
+        // Top up the buffer, write it out, keep the rest
+        size_t head = capacity_ - used_;
+        std::memcpy(buffer_.get() + used_, data, head);
+        used_ = capacity_;
+        emit(nullptr, 0);
+        std::memcpy(buffer_.get(), data + head, size - head);
+        used_ = size - head;
+    } else {
+        emit(data, size);
+    }
+}
+
+void OutputSink::emit(const char* data, size_t size) {
+    if (stream_) {
+        stream_->write(buffer_.get(), static_cast<std::streamsize>(used_));
+        stream_->write(data, static_cast<std::streamsize>(size));
+        if (!*stream_) failed_ = true;
+    } else if (fd_ >= 0 && !failed_) {
+        if (!write_both(fd_, buffer_.get(), used_, data, size)) {
+            failed_ = true;  // e.g. EPIPE: the rest of the output is dropped
+        }
+    }
+    used_ = 0;
+}
+
+bool OutputSink::flush() {
+    if (used_ > 0) {
+        emit(nullptr, 0);
+    }
+    if (stream_) {
+        stream_->flush();
+        if (!*stream_) failed_ = true;
+    }
+    return !failed_;
+}
+
+bool OutputSink::close() {
+    bool ok = flush();
+    if (owns_fd_ && fd_ >= 0) {
+#ifdef _WIN32
+        ok = _close(fd_) == 0 && ok;
+#else
+        ok = ::close(fd_) == 0 && ok;
+#endif
+    }
+    fd_ = -1;
+    owns_fd_ = false;
+    return ok;
+}
+
+} // namespace awk
@@ -923,6 +923,9 @@ ExprPtr Parser::assignment() {
             error("Invalid assignment target");
         }
 
+        if (ExprPtr update = make_update(expr, op, value, false)) {
+            return update;
+        }
         return std::make_unique<AssignExpr>(std::move(expr), op, std::move(value));
     }
 
@@ -1140,6 +1143,10 @@ ExprPtr Parser::unary() {
     if (match({TokenType::INCREMENT, TokenType::DECREMENT})) {
         TokenType op = previous_.type;
         ExprPtr operand = unary();
+        ExprPtr none;
+        if (ExprPtr update = make_update(operand, op, none, false)) {
+            return update;
+        }
         return std::make_unique<UnaryExpr>(op, std::move(operand), true);
     }
 
@@ -1151,7 +1158,12 @@ ExprPtr Parser::postfix() {
 
     while (match({TokenType::INCREMENT, TokenType::DECREMENT})) {
         TokenType op = previous_.type;
-        expr = std::make_unique<UnaryExpr>(op, std::move(expr), false);
+        ExprPtr none;
+        if (ExprPtr update = make_update(expr, op, none, true)) {
+            expr = std::move(update);
+        } else {
+            expr = std::make_unique<UnaryExpr>(op, std::move(expr), false);
+        }
     }
 
     return expr;
@@ -1383,4 +1395,61 @@ bool Parser::is_lvalue(const Expr* expr) const {
            dynamic_cast<const ArrayAccessExpr*>(expr) != nullptr;
 }
 
+ExprPtr Parser::make_update(ExprPtr& target, TokenType op, ExprPtr& value, bool postfix) {
+    if (!target) {
+        return nullptr;
+    }
+    // Fields keep their own update path (assigning one rebuilds $0);
+    // SYMTAB and FUNCTAB are not arrays
+    if (target->kind == ExprKind::ARRAY_ACCESS) {
+        const std::string& name = static_cast<ArrayAccessExpr&>(*target).name;
+        if (name == "SYMTAB" || name == "FUNCTAB") {
+            return nullptr;
+        }
+    } else if (target->kind != ExprKind::VARIABLE) {
+        return nullptr;
+    }
+
+    TokenType arith;
+    switch (op) {
+        case TokenType::INCREMENT:      arith = TokenType::PLUS; break;
+        case TokenType::DECREMENT:      arith = TokenType::MINUS; break;
+        case TokenType::PLUS_ASSIGN:    arith = TokenType::PLUS; break;
+        case TokenType::MINUS_ASSIGN:   arith = TokenType::MINUS; break;
+        case TokenType::STAR_ASSIGN:    arith = TokenType::STAR; break;
+        case TokenType::SLASH_ASSIGN:   arith = TokenType::SLASH; break;
+        case TokenType::PERCENT_ASSIGN: arith = TokenType::PERCENT; break;
+        case TokenType::CARET_ASSIGN:   arith = TokenType::CARET; break;
+        case TokenType::ASSIGN: {
+            // x = x op y, where evaluating y cannot change x: the update
+            // reads x after y
+            if (target->kind != ExprKind::VARIABLE || !value || value->kind != ExprKind::BINARY) {
+                return nullptr;
+            }
+            auto& binary = static_cast<BinaryExpr&>(*value);
+            switch (binary.op) {
+                case TokenType::PLUS: case TokenType::MINUS: case TokenType::STAR:
+                case TokenType::SLASH: case TokenType::PERCENT: case TokenType::CARET:
+                    break;
+                default:
+                    return nullptr;
+            }
+            const Expr& left = *binary.left;
+            const Expr& right = *binary.right;
+            bool pure = right.kind == ExprKind::LITERAL || right.kind == ExprKind::VARIABLE ||
+                        (right.kind == ExprKind::FIELD &&
+                         static_cast<const FieldExpr&>(right).index->kind == ExprKind::LITERAL);
+            if (left.kind != ExprKind::VARIABLE || !pure ||
+                static_cast<const VariableExpr&>(left).name != static_cast<VariableExpr&>(*target).name) {
+                return nullptr;
+            }
+            return std::make_unique<UpdateExpr>(std::move(target), binary.op, std::move(binary.right));
+        }
+        default:
+            return nullptr;
+    }
+
+    return std::make_unique<UpdateExpr>(std::move(target), arith, std::move(value), postfix);
+}
+
 } // namespace awk
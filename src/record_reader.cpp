@@ -0,0 +1,250 @@
+// ============================================================================
+// record_reader.cpp - Block-buffered record input
+// ============================================================================
+
+#include "awk/record_reader.hpp"
+#include <cerrno>
+#include <cstring>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace awk {
+
+namespace {
+
+// read(2) with EINTR retry; returns bytes read, 0 at EOF, -1 on error
+long long read_some(int fd, char* buffer, size_t size) {
+    for (;;) {
+#ifdef _WIN32
+        int n = _read(fd, buffer, static_cast<unsigned int>(size));
+#else
+        ssize_t n = ::read(fd, buffer, size);
+#endif
+        if (n >= 0 || errno != EINTR) {
+            return n;
+        }
+    }
+}
+
+constexpr std::string_view NEWLINE = "\n";
+
+} // namespace
+
+RecordReader::RecordReader(int fd, bool owns_fd)
+    : fd_(fd), owns_fd_(owns_fd) {}
+
+RecordReader::~RecordReader() {
+#ifndef _WIN32
+    if (mapping_) {
+        munmap(mapping_, mapping_size_);
+    }
+#endif
+    if (owns_fd_ && fd_ >= 0) {
+#ifdef _WIN32
+        _close(fd_);
+#else
+        ::close(fd_);
+#endif
+    }
+}
+
+std::unique_ptr<RecordReader> RecordReader::open(const std::string& path, bool allow_mmap) {
+#ifdef _WIN32
+    (void)allow_mmap;  // No mapping on Windows: always stream
+    int fd = _open(path.c_str(), _O_RDONLY);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+    if (fd < 0) {
+        return nullptr;
+    }
+    auto reader = std::make_unique<RecordReader>(fd, true);
+
+#ifndef _WIN32
+    // Pipes, terminals and device files are streamed
+    struct stat st;
+    if (allow_mmap && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        reader->map_file(static_cast<size_t>(st.st_size));
+    }
+#endif
+    return reader;
+}
+
+bool RecordReader::map_file(size_t size) {
+#ifdef _WIN32
+    (void)size;
+    return false;
+#else
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    madvise(mapping, size, MADV_SEQUENTIAL);
+
+    mapping_ = mapping;
+    mapping_size_ = size;
+    data_ = static_cast<const char*>(mapping);
+    begin_ = 0;
+    end_ = size;
+    eof_ = true;  // Everything is already in the buffer
+    return true;
+#endif
+}
+
+// ============================================================================
+// Buffer Management
+// ============================================================================
+
+bool RecordReader::fill() {
+    if (eof_ || failed_) {
+        return false;
+    }
+
+    if (!buffer_) {
+        buffer_ = std::make_unique<char[]>(BLOCK_SIZE);
+        capacity_ = BLOCK_SIZE;
+        data_ = buffer_.get();
+    }
+
+    // Keep the partial record, dropping everything already consumed
+    if (begin_ > 0) {
+        std::memmove(buffer_.get(), buffer_.get() + begin_, end_ - begin_);
+        end_ -= begin_;
+        begin_ = 0;
+    }
+
+    // A single record fills the whole buffer: grow it
+    if (end_ == capacity_) {
+        auto larger = std::make_unique<char[]>(capacity_ * 2);
+        std::memcpy(larger.get(), buffer_.get(), end_);
+        buffer_ = std::move(larger);
+        capacity_ *= 2;
+        data_ = buffer_.get();
+    }
+
+    long long n = read_some(fd_, buffer_.get() + end_, capacity_ - end_);
+    if (n > 0) {
+        end_ += static_cast<size_t>(n);
+        return true;
+    }
+    if (n == 0) {
+        eof_ = true;
+    } else {
+        failed_ = true;
+    }
+    return false;
+}
+
+// ============================================================================
+// Record Splitting
+// ============================================================================
+
+bool RecordReader::read_record(const std::string& rs, std::string_view& record, std::string_view& rt) {
+    if (rs.empty()) {
+        return read_paragraph(record, rt);
+    }
+    // Multi-character RS is simplified to line mode
+    return read_delimited(rs.size() == 1 ? rs[0] : '\n', record, rt);
+}
+
+bool RecordReader::read_delimited(char delimiter, std::string_view& record, std::string_view& rt) {
+    size_t scanned = 0;  // Bytes after begin_ already searched
+
+    for (;;) {
+        const char* start = data_ + begin_;
+        size_t available = end_ - begin_;
+
+        if (scanned < available) {
+            const void* hit = std::memchr(start + scanned, delimiter, available - scanned);
+            if (hit) {
+                size_t length = static_cast<size_t>(static_cast<const char*>(hit) - start);
+                record = std::string_view(start, length);
+                rt = std::string_view(start + length, 1);
+                begin_ += length + 1;
+                return true;
+            }
+            scanned = available;
+        }
+
+        if (!fill()) {
+            // Unterminated last record
+            rt = std::string_view();
+            if (failed_ || begin_ == end_) {
+                record = std::string_view();
+                return false;
+            }
+            record = std::string_view(data_ + begin_, end_ - begin_);
+            begin_ = end_;
+            return true;
+        }
+    }
+}
+
+bool RecordReader::read_paragraph(std::string_view& record, std::string_view& rt) {
+    rt = std::string_view();
+    record = std::string_view();
+
+    // Skip leading blank lines
+    for (;;) {
+        while (begin_ < end_ && data_[begin_] == '\n') {
+            ++begin_;
+        }
+        if (begin_ < end_) {
+            break;
+        }
+        if (!fill()) {
+            return false;
+        }
+    }
+
+    // The record ends at the first empty line ("\n\n")
+    size_t scanned = 0;
+    for (;;) {
+        const char* start = data_ + begin_;
+        size_t available = end_ - begin_;
+
+        while (scanned < available) {
+            const void* hit = std::memchr(start + scanned, '\n', available - scanned);
+            if (!hit) {
+                scanned = available;
+                break;
+            }
+            size_t pos = static_cast<size_t>(static_cast<const char*>(hit) - start);
+            if (pos + 1 == available) {
+                scanned = pos;  // Need the next byte to decide
+                break;
+            }
+            if (start[pos + 1] == '\n') {
+                record = std::string_view(start, pos);
+                rt = NEWLINE;
+                begin_ += pos + 2;
+                return true;
+            }
+            scanned = pos + 1;
+        }
+
+        if (!fill()) {
+            if (failed_) {
+                return false;
+            }
+            // Last paragraph, without its trailing newline
+            size_t length = end_ - begin_;
+            if (length > 0 && data_[begin_ + length - 1] == '\n') {
+                --length;
+            }
+            record = std::string_view(data_ + begin_, length);
+            begin_ = end_;
+            return true;
+        }
+    }
+}
+
+} // namespace awk
@@ -0,0 +1,1228 @@
+// ============================================================================
+// regex.cpp - POSIX ERE engine: parser, Thompson NFA, lazy DFA, Pike VM
+// ============================================================================
+
+#include "awk/regex.hpp"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+namespace awk {
+
+namespace regex_detail {
+
+// ============================================================================
+// Byte sets
+// ============================================================================
+
+struct ByteSet {
+    std::array<uint64_t, 4> bits{};
+
+    void add(unsigned char c) { bits[c >> 6] |= uint64_t(1) << (c & 63); }
+    bool has(unsigned char c) const { return (bits[c >> 6] >> (c & 63)) & 1; }
+
+    void add_range(unsigned lo, unsigned hi) {
+        for (unsigned c = lo; c <= hi; ++c) add(static_cast<unsigned char>(c));
+    }
+
+    void add_if(int (*pred)(int)) {
+        for (unsigned c = 0; c < 128; ++c) {
+            if (pred(static_cast<int>(c))) add(static_cast<unsigned char>(c));
+        }
+    }
+
+    void invert() {
+        for (uint64_t& word : bits) word = ~word;
+    }
+
+    // Adds the other case of every ASCII letter in the set
+    void fold_case() {
+        for (unsigned c = 'a'; c <= 'z'; ++c) {
+            unsigned char lower = static_cast<unsigned char>(c);
+            unsigned char upper = static_cast<unsigned char>(c - 'a' + 'A');
+            if (has(lower) || has(upper)) {
+                add(lower);
+                add(upper);
+            }
+        }
+    }
+
+    // The byte if the set holds exactly one, else -1
+    int single() const {
+        int found = -1;
+        for (unsigned c = 0; c < 256; ++c) {
+            if (has(static_cast<unsigned char>(c))) {
+                if (found >= 0) return -1;
+                found = static_cast<int>(c);
+            }
+        }
+        return found;
+    }
+};
+
+bool is_word_byte(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+ByteSet word_set() {
+    ByteSet set;
+    for (unsigned c = 0; c < 256; ++c) {
+        if (is_word_byte(static_cast<unsigned char>(c))) set.add(static_cast<unsigned char>(c));
+    }
+    return set;
+}
+
+ByteSet space_set() {
+    ByteSet set;
+    for (unsigned char c : {' ', '\t', '\n', '\r', '\f', '\v'}) set.add(c);
+    return set;
+}
+
+// ============================================================================
+// Parser - pattern text to syntax tree
+// ============================================================================
+
+enum Assertion : unsigned char {
+    BEGIN_TEXT,
+    END_TEXT,
+    WORD_BOUNDARY,
+    NOT_WORD_BOUNDARY,
+    WORD_START,
+    WORD_END
+};
+
+struct Node {
+    enum Kind : unsigned char { EMPTY, SET, CONCAT, ALT, REPEAT, GROUP, ASSERT };
+
+    Kind kind = EMPTY;
+    Assertion assertion = BEGIN_TEXT;
+    ByteSet set;
+    int min = 0;
+    int max = 0;                  // -1: unbounded
+    size_t group = 0;             // GROUP: 1-based subexpression number
+    std::vector<Node> children;   // CONCAT, ALT; REPEAT and GROUP have one
+};
+
+constexpr int MAX_REPEAT = 32767;  // RE_DUP_MAX of GNU regex
+constexpr int MAX_NESTING = 1000;
+
+class Parser {
+public:
+    Parser(std::string_view pattern, bool icase) : p_(pattern), icase_(icase) {}
+
+    Node parse() {
+        Node root = parse_alternation(0);
+        if (pos_ < p_.size()) throw RegexError("unmatched )");
+        return root;
+    }
+
+    size_t groups() const { return groups_; }
+    bool has_word_assertions() const { return word_assertions_; }
+
+private:
+    std::string_view p_;
+    size_t pos_ = 0;
+    bool icase_;
+    size_t groups_ = 0;
+    bool word_assertions_ = false;
+
+    bool at_end() const { return pos_ >= p_.size(); }
+    unsigned char peek() const { return static_cast<unsigned char>(p_[pos_]); }
+
+    Node parse_alternation(int depth) {
+        if (depth > MAX_NESTING) throw RegexError("regular expression nested too deeply");
+        Node first = parse_concatenation(depth);
+        if (at_end() || peek() != '|') return first;
+
+        Node alt;
+        alt.kind = Node::ALT;
+        alt.children.push_back(std::move(first));
+        while (!at_end() && peek() == '|') {
+            ++pos_;
+            alt.children.push_back(parse_concatenation(depth));
+        }
+        return alt;
+    }
+
+    Node parse_concatenation(int depth) {
+        Node concat;
+        concat.kind = Node::CONCAT;
+        while (!at_end() && peek() != '|' && peek() != ')') {
+            Node atom = parse_atom(depth);
+            // Anchors and word assertions take no repetition: a following
+            // '*' is then read as a literal by the next parse_atom()
+            if (atom.kind != Node::ASSERT) {
+                while (!at_end() && parse_repetition(atom)) {}
+            }
+            concat.children.push_back(std::move(atom));
+        }
+        if (concat.children.size() == 1) return std::move(concat.children[0]);
+        if (concat.children.empty()) return Node{};
+        return concat;
+    }
+
+    // Wraps atom in the repetition at pos_, if there is one
+    bool parse_repetition(Node& atom) {
+        int min = 0;
+        int max = -1;
+        switch (peek()) {
+            case '*': ++pos_; break;
+            case '+': ++pos_; min = 1; break;
+            case '?': ++pos_; max = 1; break;
+            case '{': if (!parse_interval(min, max)) return false; break;
+            default: return false;
+        }
+        Node repeat;
+        repeat.kind = Node::REPEAT;
+        repeat.min = min;
+        repeat.max = max;
+        repeat.children.push_back(std::move(atom));
+        atom = std::move(repeat);
+        return true;
+    }
+
+    // {m}, {m,}, {m,n} or {,n}; anything else leaves the '{' a literal
+    bool parse_interval(int& min, int& max) {
+        size_t i = pos_ + 1;
+        auto number = [&](int& out) {
+            size_t start = i;
+            long value = 0;
+            while (i < p_.size() && p_[i] >= '0' && p_[i] <= '9') {
+                value = std::min<long>(value * 10 + (p_[i] - '0'), MAX_REPEAT + 1L);
+                ++i;
+            }
+            out = static_cast<int>(value);
+            return i > start;
+        };
+
+        bool has_min = number(min);
+        if (!has_min) min = 0;
+        if (i < p_.size() && p_[i] == ',') {
+            ++i;
+            if (!number(max)) max = -1;
+            if (!has_min && max < 0) return false;
+        } else {
+            if (!has_min) return false;
+            max = min;
+        }
+        if (i >= p_.size() || p_[i] != '}') return false;
+
+        if (min > MAX_REPEAT || max > MAX_REPEAT) throw RegexError("invalid repetition count");
+        if (max >= 0 && max < min) throw RegexError("invalid interval {" + std::string(p_.substr(pos_ + 1, i - pos_ - 1)) + "}");
+        pos_ = i + 1;
+        return true;
+    }
+
+    Node literal(unsigned char c) const {
+        Node node;
+        node.kind = Node::SET;
+        node.set.add(c);
+        if (icase_) node.set.fold_case();
+        return node;
+    }
+
+    static Node assertion(Assertion kind) {
+        Node node;
+        node.kind = Node::ASSERT;
+        node.assertion = kind;
+        return node;
+    }
+
+    Node parse_atom(int depth) {
+        unsigned char c = peek();
+        switch (c) {
+            case '(': {
+                ++pos_;
+                Node group;
+                group.kind = Node::GROUP;
+                group.group = ++groups_;
+                group.children.push_back(parse_alternation(depth + 1));
+                if (at_end() || peek() != ')') throw RegexError("unmatched ( or \\(");
+                ++pos_;
+                return group;
+            }
+            case '[': {
+                Node node;
+                node.kind = Node::SET;
+                parse_bracket(node.set);
+                return node;
+            }
+            case '.': {
+                ++pos_;
+                Node node;
+                node.kind = Node::SET;
+                node.set.invert();
+                return node;
+            }
+            case '^':
+                ++pos_;
+                return assertion(BEGIN_TEXT);
+            case '$':
+                ++pos_;
+                return assertion(END_TEXT);
+            case '\\':
+                return parse_escape();
+            default:
+                // Includes a '*', '+', '?' or '{' with nothing to repeat
+                ++pos_;
+                return literal(c);
+        }
+    }
+
+    Node parse_escape() {
+        ++pos_;
+        if (at_end()) return literal('\\');
+        unsigned char c = peek();
+        Node node;
+        switch (c) {
+            case 'y': ++pos_; word_assertions_ = true; return assertion(WORD_BOUNDARY);
+            case 'B': ++pos_; word_assertions_ = true; return assertion(NOT_WORD_BOUNDARY);
+            case '<': ++pos_; word_assertions_ = true; return assertion(WORD_START);
+            case '>': ++pos_; word_assertions_ = true; return assertion(WORD_END);
+            case '`': ++pos_; return assertion(BEGIN_TEXT);
+            case '\'': ++pos_; return assertion(END_TEXT);
+            case 'w':
+            case 'W':
+            case 's':
+            case 'S':
+                ++pos_;
+                node.kind = Node::SET;
+                node.set = (c == 'w' || c == 'W') ? word_set() : space_set();
+                if (c == 'W' || c == 'S') node.set.invert();
+                return node;
+            default:
+                return literal(escaped_byte());
+        }
+    }
+
+    // The byte named by the escape after a backslash (pos_ is past the
+    // backslash); advances past it
+    unsigned char escaped_byte() {
+        unsigned char c = peek();
+        ++pos_;
+        switch (c) {
+            case 'n': return '\n';
+            case 't': return '\t';
+            case 'r': return '\r';
+            case 'f': return '\f';
+            case 'v': return '\v';
+            case 'a': return '\a';
+            case 'b': return '\b';
+            case 'x': {
+                unsigned value = 0;
+                int digits = 0;
+                while (digits < 2 && !at_end() && std::isxdigit(peek())) {
+                    unsigned char d = peek();
+                    value = value * 16 + (d <= '9' ? d - '0' : (d | 0x20) - 'a' + 10);
+                    ++pos_;
+                    ++digits;
+                }
+                return digits ? static_cast<unsigned char>(value) : 'x';
+            }
+            default:
+                if (c >= '0' && c <= '7') {
+                    unsigned value = c - '0';
+                    for (int digits = 1; digits < 3 && !at_end() && peek() >= '0' && peek() <= '7'; ++digits) {
+                        value = value * 8 + (peek() - '0');
+                        ++pos_;
+                    }
+                    return static_cast<unsigned char>(value);
+                }
+                return c;  // \/ \" \. \\ and any other quoted byte
+        }
+    }
+
+    void parse_bracket(ByteSet& set) {
+        ++pos_;  // '['
+        bool negate = false;
+        if (!at_end() && peek() == '^') {
+            negate = true;
+            ++pos_;
+        }
+
+        bool first = true;
+        for (;;) {
+            if (at_end()) throw RegexError("unmatched [, [^, [:, [., or [=");
+            if (peek() == ']' && !first) {
+                ++pos_;
+                break;
+            }
+            first = false;
+
+            int lo = bracket_byte(set);
+            if (lo < 0) continue;  // A character class
+
+            if (pos_ + 1 < p_.size() && p_[pos_] == '-' && p_[pos_ + 1] != ']') {
+                ++pos_;
+                int hi = bracket_byte(set);
+                if (hi < 0) throw RegexError("invalid range end");
+                if (hi < lo) throw RegexError("invalid range end");
+                set.add_range(static_cast<unsigned>(lo), static_cast<unsigned>(hi));
+            } else {
+                set.add(static_cast<unsigned char>(lo));
+            }
+        }
+
+        if (icase_) set.fold_case();
+        if (negate) set.invert();
+    }
+
+    // One element of a bracket expression: returns its byte, or -1 after
+    // adding a [:class:] to set
+    int bracket_byte(ByteSet& set) {
+        unsigned char c = peek();
+        if (c == '[' && pos_ + 1 < p_.size() &&
+            (p_[pos_ + 1] == ':' || p_[pos_ + 1] == '=' || p_[pos_ + 1] == '.')) {
+            char kind = p_[pos_ + 1];
+            char terminator[3] = {kind, ']', '\0'};
+            size_t close = p_.find(terminator, pos_ + 2);
+            if (close != std::string_view::npos) {
+                std::string_view name = p_.substr(pos_ + 2, close - pos_ - 2);
+                pos_ = close + 2;
+                if (kind == ':') {
+                    add_class(set, name);
+                    return -1;
+                }
+                if (name.size() != 1) throw RegexError("invalid collation character");
+                return static_cast<unsigned char>(name[0]);
+            }
+        }
+        if (c == '\\' && pos_ + 1 < p_.size()) {
+            ++pos_;
+            return escaped_byte();
+        }
+        ++pos_;
+        return c;
+    }
+
+    static void add_class(ByteSet& set, std::string_view name) {
+        if (name == "alpha") set.add_if(std::isalpha);
+        else if (name == "digit") set.add_if(std::isdigit);
+        else if (name == "alnum") set.add_if(std::isalnum);
+        else if (name == "upper") set.add_if(std::isupper);
+        else if (name == "lower") set.add_if(std::islower);
+        else if (name == "space") set.add_if(std::isspace);
+        else if (name == "blank") set.add_if(std::isblank);
+        else if (name == "punct") set.add_if(std::ispunct);
+        else if (name == "print") set.add_if(std::isprint);
+        else if (name == "graph") set.add_if(std::isgraph);
+        else if (name == "cntrl") set.add_if(std::iscntrl);
+        else if (name == "xdigit") set.add_if(std::isxdigit);
+        else throw RegexError("invalid character class");
+    }
+};
+
+// ============================================================================
+// Program - Thompson NFA
+// ============================================================================
+
+enum class Op : unsigned char {
+    BYTE,    // Consume a byte of sets[arg]
+    SPLIT,   // Continue at x, or (lower priority) at y
+    JMP,     // Continue at x
+    SAVE,    // Record the position in slot arg
+    ASSERT,  // Continue only if assertion holds here
+    MATCH
+};
+
+// BYTE, SAVE and ASSERT continue at the next instruction
+struct Inst {
+    Op op;
+    Assertion assertion = BEGIN_TEXT;
+    int32_t x = 0;
+    int32_t y = 0;
+    int32_t arg = 0;
+};
+
+struct Program {
+    std::vector<Inst> insts;
+    std::vector<ByteSet> sets;
+    int32_t match = 0;  // The MATCH instruction
+    size_t slots = 2;   // 2 * (subexpressions + 1)
+
+    // Bytes that no instruction tells apart share a class; a DFA state has
+    // one transition per class
+    std::array<uint8_t, 256> byte_class{};
+    size_t classes = 1;
+};
+
+constexpr size_t MAX_PROGRAM_SIZE = 250000;
+
+class Compiler {
+public:
+    // reverse compiles the pattern read backwards, without subexpressions
+    Compiler(Program& prog, bool reverse) : prog_(prog), reverse_(reverse) {}
+
+    void compile(const Node& root, size_t groups) {
+        prog_.slots = reverse_ ? 2 : 2 * (groups + 1);
+        emit_save(0);
+        emit(root);
+        emit_save(1);
+        prog_.match = emit_inst(Op::MATCH);
+        compute_classes();
+    }
+
+private:
+    Program& prog_;
+    bool reverse_;
+    std::map<std::array<uint64_t, 4>, int32_t> set_index_;
+
+    int32_t here() const { return static_cast<int32_t>(prog_.insts.size()); }
+
+    int32_t emit_inst(Op op) {
+        if (prog_.insts.size() >= MAX_PROGRAM_SIZE) throw RegexError("regular expression too big");
+        Inst inst;
+        inst.op = op;
+        prog_.insts.push_back(inst);
+        return here() - 1;
+    }
+
+    void emit_save(int32_t slot) {
+        prog_.insts[emit_inst(Op::SAVE)].arg = slot;
+    }
+
+    int32_t emit_split(int32_t x, int32_t y) {
+        int32_t pc = emit_inst(Op::SPLIT);
+        prog_.insts[pc].x = x;
+        prog_.insts[pc].y = y;
+        return pc;
+    }
+
+    int32_t add_set(const ByteSet& set) {
+        auto inserted = set_index_.emplace(set.bits, static_cast<int32_t>(prog_.sets.size()));
+        if (inserted.second) prog_.sets.push_back(set);
+        return inserted.first->second;
+    }
+
+    void emit(const Node& node) {
+        switch (node.kind) {
+            case Node::EMPTY:
+                break;
+            case Node::SET:
+                prog_.insts[emit_inst(Op::BYTE)].arg = add_set(node.set);
+                break;
+            case Node::CONCAT:
+                if (reverse_) {
+                    for (auto it = node.children.rbegin(); it != node.children.rend(); ++it) emit(*it);
+                } else {
+                    for (const Node& child : node.children) emit(child);
+                }
+                break;
+            case Node::ALT: {
+                std::vector<int32_t> exits;
+                for (size_t i = 0; i + 1 < node.children.size(); ++i) {
+                    int32_t split = emit_split(here() + 1, 0);
+                    emit(node.children[i]);
+                    exits.push_back(emit_inst(Op::JMP));
+                    prog_.insts[split].y = here();
+                }
+                emit(node.children.back());
+                for (int32_t pc : exits) prog_.insts[pc].x = here();
+                break;
+            }
+            case Node::REPEAT:
+                emit_repeat(node.children[0], node.min, node.max);
+                break;
+            case Node::GROUP:
+                if (!reverse_) emit_save(static_cast<int32_t>(2 * node.group));
+                emit(node.children[0]);
+                if (!reverse_) emit_save(static_cast<int32_t>(2 * node.group + 1));
+                break;
+            case Node::ASSERT: {
+                Assertion kind = node.assertion;
+                if (reverse_) {
+                    switch (kind) {
+                        case BEGIN_TEXT: kind = END_TEXT; break;
+                        case END_TEXT: kind = BEGIN_TEXT; break;
+                        case WORD_START: kind = WORD_END; break;
+                        case WORD_END: kind = WORD_START; break;
+                        default: break;
+                    }
+                }
+                prog_.insts[emit_inst(Op::ASSERT)].assertion = kind;
+                break;
+            }
+        }
+    }
+
+    // Greedy: each SPLIT prefers another iteration
+    void emit_repeat(const Node& body, int min, int max) {
+        for (int i = 0; i < min; ++i) emit(body);
+        if (max < 0) {
+            int32_t loop = emit_split(here() + 1, 0);
+            emit(body);
+            prog_.insts[emit_inst(Op::JMP)].x = loop;
+            prog_.insts[loop].y = here();
+            return;
+        }
+        std::vector<int32_t> skips;
+        for (int i = min; i < max; ++i) {
+            skips.push_back(emit_split(here() + 1, 0));
+            emit(body);
+        }
+        for (int32_t pc : skips) prog_.insts[pc].y = here();
+    }
+
+    void compute_classes() {
+        std::array<uint8_t, 256>& classes = prog_.byte_class;
+        classes.fill(0);
+        size_t count = 1;
+        for (const ByteSet& set : prog_.sets) {
+            std::array<int, 512> renumber;
+            renumber.fill(-1);
+            size_t next = 0;
+            for (unsigned c = 0; c < 256; ++c) {
+                int key = classes[c] * 2 + (set.has(static_cast<unsigned char>(c)) ? 1 : 0);
+                if (renumber[key] < 0) renumber[key] = static_cast<int>(next++);
+                classes[c] = static_cast<uint8_t>(renumber[key]);
+            }
+            count = next;
+            if (count == 256) break;
+        }
+        prog_.classes = count;
+    }
+};
+
+std::unique_ptr<Program> compile(const Node& root, size_t groups, bool reverse) {
+    auto prog = std::make_unique<Program>();
+    Compiler(*prog, reverse).compile(root, groups);
+    return prog;
+}
+
+// ============================================================================
+// Dfa - subset construction, one state at a time
+// ============================================================================
+//
+// A state is the list of NFA instructions the threads are waiting at (BYTE,
+// MATCH, and END_TEXT assertions that can only be passed at the end), with a
+// flags word in front. LEFTMOST states keep the threads in groups ordered
+// by where they started, separated by MARK: once a group matches, the
+// groups after it started later and are dropped, and no new threads are
+// started. Its last accepting position is then the end of the
+// leftmost-longest match.
+
+class Dfa {
+public:
+    enum Kind {
+        SEARCH,    // Unanchored; any match
+        LEFTMOST,  // Unanchored; leftmost-longest
+        LONGEST    // Anchored at the start; longest
+    };
+
+    static constexpr int32_t DEAD = 0;
+
+    Dfa(const Program& prog, Kind kind) : prog_(prog), kind_(kind) {
+        visited_.assign(prog.insts.size(), 0);
+        // Keep transition tables to about 4 MB
+        max_states_ = std::max<size_t>(256, (size_t(4) << 20) / (prog.classes * sizeof(int32_t) + 64));
+        reset();
+    }
+
+    int32_t start(bool at_begin) {
+        int32_t& cached = start_[at_begin ? 1 : 0];
+        if (cached < 0) {
+            std::vector<int32_t> key{at_begin ? BEGIN : 0};
+            new_generation();
+            size_t group_start = key.size();
+            if (add_closure(key, 0, at_begin) && kind_ == LEFTMOST) key[0] |= NO_INJECT;
+            sort_group(key, group_start);
+            cached = intern(std::move(key));
+        }
+        return cached;
+    }
+
+    int32_t next(int32_t state, unsigned char c) {
+        int32_t target = transitions_[static_cast<size_t>(state) * prog_.classes + prog_.byte_class[c]];
+        return target >= 0 ? target : compute(state, c);
+    }
+
+    bool accepting(int32_t state) const { return states_[state].accepting; }
+    bool accepting_at_end(int32_t state) const { return states_[state].accepting_at_end; }
+
+private:
+    static constexpr int32_t MARK = -1;
+    static constexpr int32_t BEGIN = 1;      // At the start of the text
+    static constexpr int32_t NO_INJECT = 2;  // Start no more threads
+
+    struct State {
+        std::vector<int32_t> key;
+        bool accepting = false;
+        bool accepting_at_end = false;
+    };
+
+    struct KeyHash {
+        size_t operator()(const std::vector<int32_t>& key) const {
+            uint64_t h = 1469598103934665603ULL;
+            for (int32_t v : key) {
+                h ^= static_cast<uint32_t>(v);
+                h *= 1099511628211ULL;
+            }
+            return static_cast<size_t>(h);
+        }
+    };
+
+    const Program& prog_;
+    Kind kind_;
+    size_t max_states_;
+    std::vector<State> states_;
+    std::vector<int32_t> transitions_;
+    std::unordered_map<std::vector<int32_t>, int32_t, KeyHash> index_;
+    int32_t start_[2];
+
+    size_t flushes_ = 0;
+
+    std::vector<uint32_t> visited_;
+    uint32_t generation_ = 0;
+    std::vector<int32_t> stack_;
+
+    void new_generation() {
+        if (++generation_ == 0) {
+            std::fill(visited_.begin(), visited_.end(), 0);
+            generation_ = 1;
+        }
+    }
+
+    void reset() {
+        ++flushes_;
+        states_.clear();
+        transitions_.clear();
+        index_.clear();
+        start_[0] = start_[1] = -1;
+        // DEAD: no threads, every transition back to itself
+        states_.emplace_back();
+        transitions_.assign(prog_.classes, DEAD);
+    }
+
+    // Adds the threads reachable from pc without consuming a byte to key,
+    // skipping instructions already visited in this generation. Returns
+    // true if MATCH is among them.
+    bool add_closure(std::vector<int32_t>& key, int32_t pc, bool at_begin) {
+        bool matched = false;
+        stack_.push_back(pc);
+        while (!stack_.empty()) {
+            int32_t at = stack_.back();
+            stack_.pop_back();
+            while (visited_[at] != generation_) {
+                visited_[at] = generation_;
+                const Inst& inst = prog_.insts[at];
+                if (inst.op == Op::JMP) {
+                    at = inst.x;
+                } else if (inst.op == Op::SPLIT) {
+                    stack_.push_back(inst.y);
+                    at = inst.x;
+                } else if (inst.op == Op::SAVE) {
+                    ++at;
+                } else if (inst.op == Op::ASSERT) {
+                    if (inst.assertion == BEGIN_TEXT && at_begin) {
+                        ++at;
+                    } else {
+                        if (inst.assertion == END_TEXT) key.push_back(at);
+                        break;
+                    }
+                } else {
+                    if (inst.op == Op::MATCH) matched = true;
+                    key.push_back(at);
+                    break;
+                }
+            }
+        }
+        return matched;
+    }
+
+    // Whether MATCH is reachable from key's END_TEXT threads at the end of
+    // the text
+    bool matches_at_end(const std::vector<int32_t>& key) {
+        bool at_begin = (key[0] & BEGIN) != 0;
+        new_generation();
+        for (size_t i = 1; i < key.size(); ++i) {
+            if (key[i] != MARK && prog_.insts[key[i]].op == Op::ASSERT) stack_.push_back(key[i] + 1);
+        }
+        while (!stack_.empty()) {
+            int32_t at = stack_.back();
+            stack_.pop_back();
+            while (visited_[at] != generation_) {
+                visited_[at] = generation_;
+                const Inst& inst = prog_.insts[at];
+                if (inst.op == Op::JMP) {
+                    at = inst.x;
+                } else if (inst.op == Op::SPLIT) {
+                    stack_.push_back(inst.y);
+                    at = inst.x;
+                } else if (inst.op == Op::SAVE) {
+                    ++at;
+                } else if (inst.op == Op::ASSERT &&
+                           (inst.assertion == END_TEXT || (inst.assertion == BEGIN_TEXT && at_begin))) {
+                    ++at;
+                } else {
+                    if (inst.op == Op::MATCH) {
+                        stack_.clear();
+                        return true;
+                    }
+                    break;
+                }
+            }
+        }
+        return false;
+    }
+
+    void sort_group(std::vector<int32_t>& key, size_t from) {
+        std::sort(key.begin() + static_cast<std::ptrdiff_t>(from), key.end());
+    }
+
+    // Opens a group in key; returns where its instructions start
+    size_t open_group(std::vector<int32_t>& key) {
+        if (kind_ == LEFTMOST && key.size() > 1) key.push_back(MARK);
+        return key.size();
+    }
+
+    // Sorts the group, or removes it with its MARK if it is empty
+    void close_group(std::vector<int32_t>& key, size_t start) {
+        if (key.size() == start) {
+            if (start > 1 && key[start - 1] == MARK) key.pop_back();
+            return;
+        }
+        sort_group(key, start);
+    }
+
+    int32_t compute(int32_t state, unsigned char c) {
+        const std::vector<int32_t> from = states_[state].key;
+        std::vector<int32_t> key{from[0] & NO_INJECT};
+        new_generation();
+
+        bool matched = false;
+        size_t i = 1;
+        if (kind_ == LEFTMOST) {
+            while (i < from.size() && !matched) {
+                size_t start = open_group(key);
+                for (; i < from.size() && from[i] != MARK; ++i) {
+                    const Inst& inst = prog_.insts[from[i]];
+                    if (inst.op == Op::BYTE && prog_.sets[inst.arg].has(c)) {
+                        matched |= add_closure(key, from[i] + 1, false);
+                    }
+                }
+                ++i;  // MARK
+                close_group(key, start);
+            }
+            if (!matched && !(key[0] & NO_INJECT)) {
+                size_t start = open_group(key);
+                matched = add_closure(key, 0, false);
+                close_group(key, start);
+            }
+            if (matched) key[0] |= NO_INJECT;
+        } else {
+            for (; i < from.size(); ++i) {
+                const Inst& inst = prog_.insts[from[i]];
+                if (inst.op == Op::BYTE && prog_.sets[inst.arg].has(c)) {
+                    add_closure(key, from[i] + 1, false);
+                }
+            }
+            if (kind_ == SEARCH) add_closure(key, 0, false);
+            sort_group(key, 1);
+        }
+
+        // If intern() flushed a full cache, state is gone
+        size_t flushes = flushes_;
+        int32_t target = intern(std::move(key));
+        if (flushes == flushes_) {
+            transitions_[static_cast<size_t>(state) * prog_.classes + prog_.byte_class[c]] = target;
+        }
+        return target;
+    }
+
+    int32_t intern(std::vector<int32_t> key) {
+        if (key.size() == 1) return DEAD;
+        auto it = index_.find(key);
+        if (it != index_.end()) return it->second;
+
+        if (states_.size() >= max_states_) reset();
+
+        State state;
+        state.accepting = std::find(key.begin() + 1, key.end(), prog_.match) != key.end();
+        state.accepting_at_end = state.accepting || matches_at_end(key);
+        state.key = key;
+        int32_t id = static_cast<int32_t>(states_.size());
+        states_.push_back(std::move(state));
+        transitions_.resize(states_.size() * prog_.classes, -1);
+        index_.emplace(std::move(key), id);
+        return id;
+    }
+};
+
+} // namespace regex_detail
+
+using namespace regex_detail;
+
+namespace {
+
+bool word_at(std::string_view text, size_t pos) {
+    return pos < text.size() && is_word_byte(static_cast<unsigned char>(text[pos]));
+}
+
+bool assertion_holds(Assertion kind, std::string_view text, size_t pos) {
+    bool before = pos > 0 && word_at(text, pos - 1);
+    bool after = word_at(text, pos);
+    switch (kind) {
+        case BEGIN_TEXT: return pos == 0;
+        case END_TEXT: return pos == text.size();
+        case WORD_BOUNDARY: return before != after;
+        case NOT_WORD_BOUNDARY: return before == after;
+        case WORD_START: return !before && after;
+        case WORD_END: return before && !after;
+    }
+    return false;
+}
+
+// Threads of one step of the Pike VM: a sparse set of instructions in
+// priority order, each with its capture slots
+class ThreadList {
+public:
+    ThreadList(size_t insts, size_t slots)
+        : sparse_(insts), slots_(slots), caps_(insts * slots) {
+        dense_.reserve(insts);
+    }
+
+    bool contains(int32_t pc) const {
+        uint32_t i = sparse_[pc];
+        return i < dense_.size() && dense_[i] == pc;
+    }
+
+    void insert(int32_t pc) {
+        sparse_[pc] = static_cast<uint32_t>(dense_.size());
+        dense_.push_back(pc);
+    }
+
+    void clear() { dense_.clear(); }
+    bool empty() const { return dense_.empty(); }
+    const std::vector<int32_t>& threads() const { return dense_; }
+    size_t* caps(int32_t pc) { return &caps_[static_cast<size_t>(pc) * slots_]; }
+
+private:
+    std::vector<int32_t> dense_;
+    std::vector<uint32_t> sparse_;
+    size_t slots_;
+    std::vector<size_t> caps_;
+};
+
+} // namespace
+
+// ============================================================================
+// Regex
+// ============================================================================
+
+Regex::Regex(std::string_view pattern, unsigned flags) : pattern_(pattern), flags_(flags) {
+    Parser parser(pattern, (flags & ICASE) != 0);
+    Node root = parser.parse();
+    groups_ = parser.groups();
+    nfa_only_ = parser.has_word_assertions();
+
+    // Plain text, possibly anchored: found with string_view::find
+    std::vector<const Node*> parts;
+    if (root.kind == Node::CONCAT) {
+        for (const Node& child : root.children) parts.push_back(&child);
+    } else {
+        parts.push_back(&root);
+    }
+    size_t first = 0;
+    size_t last = parts.size();
+    if (last > 0 && parts[0]->kind == Node::ASSERT && parts[0]->assertion == BEGIN_TEXT) {
+        literal_begin_ = true;
+        ++first;
+    }
+    if (last > first && parts[last - 1]->kind == Node::ASSERT && parts[last - 1]->assertion == END_TEXT) {
+        literal_end_ = true;
+        --last;
+    }
+    literal_ = true;
+    for (size_t i = first; i < last && literal_; ++i) {
+        if (parts[i]->kind == Node::EMPTY) continue;
+        int byte = parts[i]->kind == Node::SET ? parts[i]->set.single() : -1;
+        if (byte < 0) literal_ = false;
+        else literal_text_ += static_cast<char>(byte);
+    }
+    if (literal_) return;
+    literal_begin_ = literal_end_ = false;
+    literal_text_.clear();
+
+    forward_ = compile(root, groups_, false);
+    if (!nfa_only_) reverse_ = compile(root, 0, true);
+}
+
+Regex::~Regex() = default;
+
+bool Regex::find_literal(std::string_view text, size_t from, Span& match) const {
+    const size_t length = literal_text_.size();
+    if (literal_begin_) {
+        if (from > 0 || text.size() < length || text.substr(0, length) != literal_text_) return false;
+        if (literal_end_ && text.size() != length) return false;
+        match = {0, length};
+        return true;
+    }
+    if (literal_end_) {
+        if (text.size() < length || text.size() - length < from) return false;
+        if (text.substr(text.size() - length) != literal_text_) return false;
+        match = {text.size() - length, text.size()};
+        return true;
+    }
+    size_t pos = text.find(literal_text_, from);
+    if (pos == npos) return false;
+    match = {pos, pos + length};
+    return true;
+}
+
+bool Regex::search(std::string_view text) const {
+    Span match;
+    if (literal_) return find_literal(text, 0, match);
+    if (nfa_only_) return pike(text, 0, npos, nullptr, match);
+
+    if (!search_dfa_) search_dfa_ = std::make_unique<Dfa>(*forward_, Dfa::SEARCH);
+    Dfa& dfa = *search_dfa_;
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(text.data());
+    const size_t size = text.size();
+
+    int32_t state = dfa.start(true);
+    if (dfa.accepting(state)) return true;
+    for (size_t pos = 0; pos < size; ++pos) {
+        state = dfa.next(state, data[pos]);
+        if (state == Dfa::DEAD) return false;
+        if (dfa.accepting(state)) return true;
+    }
+    return dfa.accepting_at_end(state);
+}
+
+bool Regex::find(std::string_view text, size_t from, Span& match) const {
+    if (from > text.size()) return false;
+    if (literal_) return find_literal(text, from, match);
+    if (nfa_only_) return pike(text, from, npos, nullptr, match);
+
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(text.data());
+    const size_t size = text.size();
+
+    // Forward: where the leftmost-longest match ends
+    if (!leftmost_dfa_) leftmost_dfa_ = std::make_unique<Dfa>(*forward_, Dfa::LEFTMOST);
+    Dfa& forward = *leftmost_dfa_;
+    int32_t state = forward.start(from == 0);
+    size_t end = forward.accepting(state) ? from : npos;
+    size_t pos = from;
+    while (state != Dfa::DEAD && pos < size) {
+        state = forward.next(state, data[pos++]);
+        if (forward.accepting(state)) end = pos;
+    }
+    if (pos == size && state != Dfa::DEAD && forward.accepting_at_end(state)) end = size;
+    if (end == npos) return false;
+
+    // Backward from there: the earliest start of a match ending at end
+    if (!reverse_dfa_) reverse_dfa_ = std::make_unique<Dfa>(*reverse_, Dfa::LONGEST);
+    Dfa& reverse = *reverse_dfa_;
+    state = reverse.start(end == size);
+    size_t begin = reverse.accepting(state) ? end : npos;
+    pos = end;
+    while (state != Dfa::DEAD && pos > from) {
+        state = reverse.next(state, data[--pos]);
+        if (reverse.accepting(state)) begin = pos;
+    }
+    if (pos == 0 && state != Dfa::DEAD && reverse.accepting_at_end(state)) begin = 0;
+    if (begin == npos) return false;
+
+    match = {begin, end};
+    return true;
+}
+
+void Regex::captures(std::string_view text, Span match, std::vector<Span>& groups) const {
+    groups.assign(groups_ + 1, Span{});
+    groups[0] = match;
+    if (groups_ == 0 || !match.matched()) return;
+    Span found;
+    pike(text, match.begin, match.end, &groups, found);
+    groups[0] = match;
+}
+
+bool Regex::find_groups(std::string_view text, size_t from, std::vector<Span>& groups) const {
+    Span match;
+    if (nfa_only_ && from <= text.size()) {
+        groups.assign(groups_ + 1, Span{});
+        return pike(text, from, npos, &groups, match);
+    }
+    if (!find(text, from, match)) {
+        groups.assign(groups_ + 1, Span{});
+        return false;
+    }
+    captures(text, match, groups);
+    return true;
+}
+
+bool Regex::pike(std::string_view text, size_t from, size_t required_end,
+                 std::vector<Span>* groups, Span& match) const {
+    const Program& prog = *forward_;
+    const size_t slots = groups ? prog.slots : 2;
+    const size_t size = text.size();
+    const bool anchored = required_end != npos;
+    const size_t limit = anchored ? required_end : size;
+
+    ThreadList current(prog.insts.size(), slots);
+    ThreadList next(prog.insts.size(), slots);
+    std::vector<size_t> caps(slots, npos);
+    std::vector<size_t> best(slots, npos);
+    bool matched = false;
+
+    // Entries with slot >= 0 restore that capture slot when popped
+    struct Entry {
+        int32_t pc;
+        int32_t slot;
+        size_t value;
+    };
+    std::vector<Entry> stack;
+
+    auto add_thread = [&](ThreadList& list, int32_t pc, size_t pos) {
+        stack.push_back({pc, -1, 0});
+        while (!stack.empty()) {
+            Entry entry = stack.back();
+            stack.pop_back();
+            if (entry.slot >= 0) {
+                caps[entry.slot] = entry.value;
+                continue;
+            }
+            int32_t at = entry.pc;
+            while (!list.contains(at)) {
+                list.insert(at);
+                const Inst& inst = prog.insts[at];
+                if (inst.op == Op::JMP) {
+                    at = inst.x;
+                } else if (inst.op == Op::SPLIT) {
+                    stack.push_back({inst.y, -1, 0});
+                    at = inst.x;
+                } else if (inst.op == Op::SAVE) {
+                    if (static_cast<size_t>(inst.arg) < slots) {
+                        stack.push_back({0, inst.arg, caps[inst.arg]});
+                        caps[inst.arg] = pos;
+                    }
+                    ++at;
+                } else if (inst.op == Op::ASSERT) {
+                    if (!assertion_holds(inst.assertion, text, pos)) break;
+                    ++at;
+                } else {
+                    std::copy(caps.begin(), caps.end(), list.caps(at));
+                    break;
+                }
+            }
+        }
+    };
+
+    for (size_t pos = from;; ++pos) {
+        // A thread started later has lower priority than the running ones
+        if (!matched && (pos == from || !anchored)) {
+            std::fill(caps.begin(), caps.end(), npos);
+            add_thread(current, 0, pos);
+        }
+        if (current.empty() && (matched || anchored)) break;
+
+        unsigned char c = pos < size ? static_cast<unsigned char>(text[pos]) : 0;
+        for (int32_t pc : current.threads()) {
+            const Inst& inst = prog.insts[pc];
+            if (inst.op != Op::BYTE && inst.op != Op::MATCH) continue;
+            size_t* thread = current.caps(pc);
+            if (matched && !anchored && thread[0] > best[0]) continue;  // Started later
+
+            if (inst.op == Op::MATCH) {
+                if (anchored) {
+                    if (pos != required_end) continue;
+                    std::copy(thread, thread + slots, best.begin());
+                    matched = true;
+                    break;  // Lower-priority threads cannot win
+                }
+                if (!matched || thread[0] < best[0] || (thread[0] == best[0] && pos > best[1])) {
+                    std::copy(thread, thread + slots, best.begin());
+                    matched = true;
+                }
+                continue;
+            }
+            if (pos < limit && prog.sets[inst.arg].has(c)) {
+                std::copy(thread, thread + slots, caps.begin());
+                add_thread(next, pc + 1, pos + 1);
+            }
+        }
+
+        if (pos >= limit) break;
+        std::swap(current, next);
+        next.clear();
+    }
+
+    if (!matched) return false;
+    match = {best[0], best[1]};
+    if (groups) {
+        groups->assign(groups_ + 1, Span{});
+        for (size_t i = 0; i <= groups_; ++i) {
+            if (best[2 * i] != npos && best[2 * i + 1] != npos) {
+                (*groups)[i] = {best[2 * i], best[2 * i + 1]};
+            }
+        }
+    }
+    return true;
+}
+
+// ============================================================================
+// Replacement
+// ============================================================================
+
+namespace {
+
+void append_replacement(std::string& out, std::string_view text, std::string_view replacement,
+                        bool backrefs, const std::vector<Regex::Span>& groups) {
+    for (size_t i = 0; i < replacement.size(); ++i) {
+        char c = replacement[i];
+        if (c == '\\' && i + 1 < replacement.size()) {
+            char next = replacement[i + 1];
+            if (backrefs && next >= '0' && next <= '9') {
+                size_t group = static_cast<size_t>(next - '0');
+                if (group < groups.size() && groups[group].matched()) {
+                    out.append(text.substr(groups[group].begin, groups[group].length()));
+                }
+                ++i;
+            } else if (next == '&' || next == '\\') {
+                out += next;
+                ++i;
+            } else {
+                out += c;
+            }
+        } else if (c == '&') {
+            out.append(text.substr(groups[0].begin, groups[0].length()));
+        } else {
+            out += c;
+        }
+    }
+}
+
+} // namespace
+
+size_t substitute(const Regex& re, std::string_view text, std::string_view replacement,
+                  bool backrefs, size_t which, std::string& out) {
+    out.clear();
+    size_t replaced = 0;
+    size_t seen = 0;
+    size_t copied = 0;
+    bool need_groups = backrefs && re.group_count() > 0;
+    std::vector<Regex::Span> groups(1);
+
+    re.for_each_match(text, [&](Regex::Span match) {
+        ++seen;
+        if (which != 0 && seen != which) return true;
+        out.append(text.substr(copied, match.begin - copied));
+        if (need_groups) {
+            re.captures(text, match, groups);
+        } else {
+            groups[0] = match;
+        }
+        append_replacement(out, text, replacement, backrefs, groups);
+        copied = match.end;
+        ++replaced;
+        return which == 0;
+    });
+
+    out.append(text.substr(copied));
+    return replaced;
+}
+
+} // namespace awk
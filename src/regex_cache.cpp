@@ -10,8 +10,7 @@ namespace awk {
 // RegexCache Implementation
 // ============================================================================
 
-const std::regex& RegexCache::get(const std::string& pattern,
-                                   std::regex_constants::syntax_option_type flags) {
+const Regex& RegexCache::get(const std::string& pattern, unsigned flags) {
     CacheKey key{pattern, flags};
 
     auto it = cache_.find(key);
@@ -27,7 +26,7 @@ const std::regex& RegexCache::get(const std::string& pattern,
     evict_if_needed();
 
     // Compile regex
-    auto regex = std::make_shared<std::regex>(pattern, flags);
+    auto regex = std::make_shared<Regex>(pattern, flags);
     cache_[key] = regex;
 
     return *regex;
@@ -51,8 +50,33 @@ void RegexCache::evict_if_needed() {
 // Interpreter - Cached regex access
 // ============================================================================
 
-const std::regex& Interpreter::get_cached_regex(const std::string& pattern) {
+const Regex& Interpreter::get_cached_regex(const std::string& pattern) {
     return regex_cache_.get(pattern, get_regex_flags());
 }
 
+const Regex* Interpreter::literal_regex(RegexExpr& expr) {
+    unsigned flags = get_regex_flags();
+    if (!expr.compiled || expr.compiled_flags != flags) {
+        try {
+            expr.compiled = std::make_shared<Regex>(expr.pattern, flags);
+            expr.compiled_flags = flags;
+        } catch (const RegexError&) {
+            expr.compiled.reset();
+            return nullptr;
+        }
+    }
+    return expr.compiled.get();
+}
+
+bool Interpreter::regex_match(std::string_view text, RegexExpr& regex) {
+    const Regex* re = literal_regex(regex);
+    if (!re) {
+        // Invalid pattern: the generic path reports the error
+        AWKValue pattern;
+        pattern.set_regex(regex.pattern, nullptr);
+        return regex_match(AWKValue(std::string(text)), pattern);
+    }
+    return re->search(text);
+}
+
 } // namespace awk
@@ -0,0 +1,308 @@
+// ============================================================================
+// resolver.cpp - Variable Slot Resolution
+// ============================================================================
+
+#include "awk/resolver.hpp"
+
+namespace awk {
+
+Resolver::Resolver(Environment& env) : env_(env) {}
+
+void Resolver::resolve(Program& program) {
+    for (auto& func : program.functions) {
+        function_ = func.get();
+        if (func->body) {
+            resolve(*func->body);
+        }
+    }
+    function_ = nullptr;
+
+    for (auto& rule : program.rules) {
+        if (rule->pattern.expr) {
+            resolve(*rule->pattern.expr);
+        }
+        if (rule->pattern.range_end) {
+            resolve(*rule->pattern.range_end);
+        }
+        if (rule->action) {
+            resolve(*rule->action);
+        }
+    }
+}
+
+VarRef Resolver::resolve_name(const std::string& name) {
+    VarRef ref;
+
+    // SYMTAB/FUNCTAB are views of the symbol tables, not variables.
+    // SYMTAB can read NF by name, so it needs every field.
+    if (name == "SYMTAB" || name == "FUNCTAB") {
+        if (name == "SYMTAB") field_demand_.all = true;
+        return ref;
+    }
+
+    // Parameters are stored without namespace prefix
+    size_t sep_pos = name.find("::");
+    std::string unqualified = sep_pos != std::string::npos ? name.substr(sep_pos + 2) : name;
+
+    if (function_) {
+        const auto& params = function_->parameters;
+        for (size_t i = 0; i < params.size(); ++i) {
+            if (params[i] == name || params[i] == unqualified) {
+                ref.scope = VarRef::Scope::LOCAL;
+                ref.index = static_cast<uint32_t>(i);
+                return ref;
+            }
+        }
+    }
+
+    // NF is only right if the whole record was split
+    if (unqualified == "NF") {
+        field_demand_.all = true;
+    }
+
+    // Special variables are reachable from any namespace
+    ref.scope = VarRef::Scope::GLOBAL;
+    if (sep_pos != std::string::npos && Environment::is_special_variable(unqualified)) {
+        ref.index = env_.global_slot(unqualified);
+    } else {
+        ref.index = env_.global_slot(name);
+    }
+    return ref;
+}
+
+void Resolver::note_field_read(FieldExpr& field) {
+    if (field.index->kind == ExprKind::LITERAL) {
+        auto& literal = static_cast<LiteralExpr&>(*field.index);
+        if (literal.is_number() && literal.as_number() >= 0 &&
+            literal.as_number() == static_cast<double>(static_cast<size_t>(literal.as_number()))) {
+            size_t index = static_cast<size_t>(literal.as_number());
+            if (index > field_demand_.max_index) {
+                field_demand_.max_index = index;
+            }
+            return;
+        }
+    }
+    // $expr can reach any field
+    field_demand_.all = true;
+}
+
+void Resolver::note_store(Expr& target) {
+    // Assigning $N (N > 0) rebuilds $0 from all fields; assigning $0 only
+    // re-splits the record, which stays bounded
+    if (target.kind == ExprKind::FIELD) {
+        auto& field = static_cast<FieldExpr&>(target);
+        bool is_record = field.index->kind == ExprKind::LITERAL &&
+                         static_cast<LiteralExpr&>(*field.index).is_number() &&
+                         static_cast<LiteralExpr&>(*field.index).as_number() == 0;
+        if (!is_record) {
+            field_demand_.all = true;
+        }
+    }
+}
+
+// ============================================================================
+// Statements
+// ============================================================================
+
+void Resolver::resolve(Stmt& stmt) {
+    switch (stmt.kind) {
+        case StmtKind::EXPR:
+            resolve(*static_cast<ExprStmt&>(stmt).expression);
+            break;
+        case StmtKind::PRINT: {
+            auto& print = static_cast<PrintStmt&>(stmt);
+            resolve(print.arguments);
+            if (print.output_redirect) resolve(*print.output_redirect);
+            break;
+        }
+        case StmtKind::PRINTF: {
+            auto& printf_stmt = static_cast<PrintfStmt&>(stmt);
+            resolve(*printf_stmt.format);
+            resolve(printf_stmt.arguments);
+            if (printf_stmt.output_redirect) resolve(*printf_stmt.output_redirect);
+            break;
+        }
+        case StmtKind::BLOCK:
+            for (auto& s : static_cast<BlockStmt&>(stmt).statements) {
+                resolve(*s);
+            }
+            break;
+        case StmtKind::IF: {
+            auto& if_stmt = static_cast<IfStmt&>(stmt);
+            resolve(*if_stmt.condition);
+            resolve(*if_stmt.then_branch);
+            if (if_stmt.else_branch) resolve(*if_stmt.else_branch);
+            break;
+        }
+        case StmtKind::WHILE: {
+            auto& while_stmt = static_cast<WhileStmt&>(stmt);
+            resolve(*while_stmt.condition);
+            resolve(*while_stmt.body);
+            break;
+        }
+        case StmtKind::DO_WHILE: {
+            auto& do_stmt = static_cast<DoWhileStmt&>(stmt);
+            resolve(*do_stmt.body);
+            resolve(*do_stmt.condition);
+            break;
+        }
+        case StmtKind::FOR: {
+            auto& for_stmt = static_cast<ForStmt&>(stmt);
+            if (for_stmt.init) resolve(*for_stmt.init);
+            if (for_stmt.condition) resolve(*for_stmt.condition);
+            if (for_stmt.update) resolve(*for_stmt.update);
+            resolve(*for_stmt.body);
+            break;
+        }
+        case StmtKind::FOR_IN: {
+            auto& for_in = static_cast<ForInStmt&>(stmt);
+            for_in.variable_ref = resolve_name(for_in.variable);
+            for_in.array_ref = resolve_name(for_in.array_name);
+            resolve(*for_in.body);
+            break;
+        }
+        case StmtKind::SWITCH: {
+            auto& switch_stmt = static_cast<SwitchStmt&>(stmt);
+            resolve(*switch_stmt.expression);
+            for (auto& [case_expr, case_body] : switch_stmt.cases) {
+                resolve(*case_expr);
+                resolve(*case_body);
+            }
+            if (switch_stmt.default_case) resolve(*switch_stmt.default_case);
+            break;
+        }
+        case StmtKind::EXIT: {
+            auto& exit_stmt = static_cast<ExitStmt&>(stmt);
+            if (exit_stmt.status) resolve(*exit_stmt.status);
+            break;
+        }
+        case StmtKind::RETURN: {
+            auto& ret = static_cast<ReturnStmt&>(stmt);
+            if (ret.value) resolve(*ret.value);
+            break;
+        }
+        case StmtKind::DELETE: {
+            auto& del = static_cast<DeleteStmt&>(stmt);
+            del.array_ref = resolve_name(del.array_name);
+            resolve(del.indices);
+            break;
+        }
+        case StmtKind::BREAK:
+        case StmtKind::CONTINUE:
+        case StmtKind::NEXT:
+        case StmtKind::NEXTFILE:
+            break;
+    }
+}
+
+// ============================================================================
+// Expressions
+// ============================================================================
+
+void Resolver::resolve(Expr& expr) {
+    switch (expr.kind) {
+        case ExprKind::LITERAL:
+        case ExprKind::REGEX:
+            break;
+        case ExprKind::VARIABLE: {
+            auto& var = static_cast<VariableExpr&>(expr);
+            var.ref = resolve_name(var.name);
+            break;
+        }
+        case ExprKind::FIELD: {
+            auto& field = static_cast<FieldExpr&>(expr);
+            note_field_read(field);
+            resolve(*field.index);
+            break;
+        }
+        case ExprKind::ARRAY_ACCESS: {
+            auto& access = static_cast<ArrayAccessExpr&>(expr);
+            access.ref = resolve_name(access.name);
+            resolve(access.indices);
+            break;
+        }
+        case ExprKind::BINARY: {
+            auto& binary = static_cast<BinaryExpr&>(expr);
+            resolve(*binary.left);
+            resolve(*binary.right);
+            break;
+        }
+        case ExprKind::UNARY: {
+            auto& unary = static_cast<UnaryExpr&>(expr);
+            if (unary.op == TokenType::INCREMENT || unary.op == TokenType::DECREMENT) {
+                note_store(*unary.operand);
+            }
+            resolve(*unary.operand);
+            break;
+        }
+        case ExprKind::TERNARY: {
+            auto& ternary = static_cast<TernaryExpr&>(expr);
+            resolve(*ternary.condition);
+            resolve(*ternary.then_expr);
+            resolve(*ternary.else_expr);
+            break;
+        }
+        case ExprKind::ASSIGN: {
+            auto& assign = static_cast<AssignExpr&>(expr);
+            note_store(*assign.target);
+            resolve(*assign.target);
+            resolve(*assign.value);
+            break;
+        }
+        case ExprKind::CALL: {
+            auto& call = static_cast<CallExpr&>(expr);
+            // sub/gsub write their target
+            if ((call.function_name == "sub" || call.function_name == "gsub") &&
+                call.arguments.size() >= 3) {
+                note_store(*call.arguments[2]);
+            }
+            resolve(call.arguments);
+            break;
+        }
+        case ExprKind::INDIRECT_CALL: {
+            auto& call = static_cast<IndirectCallExpr&>(expr);
+            resolve(*call.func_name_expr);
+            resolve(call.arguments);
+            break;
+        }
+        case ExprKind::MATCH: {
+            auto& match = static_cast<MatchExpr&>(expr);
+            resolve(*match.string);
+            resolve(*match.regex);
+            break;
+        }
+        case ExprKind::CONCAT:
+            resolve(static_cast<ConcatExpr&>(expr).parts);
+            break;
+        case ExprKind::GETLINE: {
+            auto& getline = static_cast<GetlineExpr&>(expr);
+            if (getline.variable) {
+                note_store(*getline.variable);
+                resolve(*getline.variable);
+            }
+            if (getline.file) resolve(*getline.file);
+            if (getline.command) resolve(*getline.command);
+            break;
+        }
+        case ExprKind::IN: {
+            auto& in = static_cast<InExpr&>(expr);
+            in.array_ref = resolve_name(in.array_name);
+            resolve(in.keys);
+            break;
+        }
+        case ExprKind::UPDATE: {
+            auto& update = static_cast<UpdateExpr&>(expr);
+            resolve(*update.target);
+            if (update.value) resolve(*update.value);
+            break;
+        }
+    }
+}
+
+void Resolver::resolve(std::vector<ExprPtr>& exprs) {
+    for (auto& expr : exprs) {
+        resolve(*expr);
+    }
+}
+
+} // namespace awk
@@ -0,0 +1,178 @@
+// ============================================================================
+// simd_scan.cpp - SIMD separator scanning kernels
+// ============================================================================
+
+#include "awk/simd_scan.hpp"
+#include <initializer_list>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define AWK_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+// AVX2 code is compiled per function so the rest of the build stays
+// baseline x86-64; it only runs after the CPUID check.
+#if defined(AWK_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define AWK_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define AWK_TARGET_AVX2
+#endif
+
+namespace awk {
+namespace simd {
+
+namespace {
+
+// ============================================================================
+// Scalar Kernels
+// ============================================================================
+
+uint64_t char_mask_scalar(const char* block, char c) {
+    uint64_t mask = 0;
+    for (unsigned i = 0; i < 64; ++i) {
+        mask |= uint64_t(block[i] == c) << i;
+    }
+    return mask;
+}
+
+uint64_t space_mask_scalar(const char* block) {
+    uint64_t mask = 0;
+    for (unsigned i = 0; i < 64; ++i) {
+        unsigned char ch = static_cast<unsigned char>(block[i]);
+        mask |= uint64_t(ch == ' ' || static_cast<unsigned char>(ch - '\t') <= '\r' - '\t') << i;
+    }
+    return mask;
+}
+
+#ifdef AWK_SIMD_X86
+
+// ============================================================================
+// SSE2 Kernels (16 bytes per compare)
+// ============================================================================
+
+inline uint64_t movemask16(__m128i v, unsigned shift) {
+    return uint64_t(static_cast<uint32_t>(_mm_movemask_epi8(v))) << shift;
+}
+
+uint64_t char_mask_sse2(const char* block, char c) {
+    const __m128i needle = _mm_set1_epi8(c);
+    uint64_t mask = 0;
+    for (unsigned i = 0; i < 64; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+        mask |= movemask16(_mm_cmpeq_epi8(bytes, needle), i);
+    }
+    return mask;
+}
+
+uint64_t space_mask_sse2(const char* block) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i range = _mm_set1_epi8('\r' - '\t');
+    uint64_t mask = 0;
+    for (unsigned i = 0; i < 64; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+        // '\t'..'\r': (byte - '\t') <= 4 as unsigned, i.e. min(d, 4) == d
+        __m128i d = _mm_sub_epi8(bytes, tab);
+        __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(d, range), d);
+        mask |= movemask16(_mm_or_si128(_mm_cmpeq_epi8(bytes, space), control), i);
+    }
+    return mask;
+}
+
+// ============================================================================
+// AVX2 Kernels (32 bytes per compare)
+// ============================================================================
+
+AWK_TARGET_AVX2
+inline uint64_t movemask32(__m256i v, unsigned shift) {
+    return uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(v))) << shift;
+}
+
+AWK_TARGET_AVX2
+uint64_t char_mask_avx2(const char* block, char c) {
+    const __m256i needle = _mm256_set1_epi8(c);
+    __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+    return movemask32(_mm256_cmpeq_epi8(lo, needle), 0) |
+           movemask32(_mm256_cmpeq_epi8(hi, needle), 32);
+}
+
+AWK_TARGET_AVX2
+inline __m256i space_bytes_avx2(__m256i bytes) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i range = _mm256_set1_epi8('\r' - '\t');
+    __m256i d = _mm256_sub_epi8(bytes, tab);
+    __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(d, range), d);
+    return _mm256_or_si256(_mm256_cmpeq_epi8(bytes, space), control);
+}
+
+AWK_TARGET_AVX2
+uint64_t space_mask_avx2(const char* block) {
+    __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+    return movemask32(space_bytes_avx2(lo), 0) | movemask32(space_bytes_avx2(hi), 32);
+}
+
+bool cpu_has_avx2() {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    // AVX2 also needs the OS to save YMM state (OSXSAVE + XCR0 bits 1-2)
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!osxsave || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return false;
+#endif
+}
+
+#endif // AWK_SIMD_X86
+
+const Kernels SCALAR_KERNELS = {Level::SCALAR, "scalar", char_mask_scalar, space_mask_scalar};
+#ifdef AWK_SIMD_X86
+const Kernels SSE2_KERNELS = {Level::SSE2, "sse2", char_mask_sse2, space_mask_sse2};
+const Kernels AVX2_KERNELS = {Level::AVX2, "avx2", char_mask_avx2, space_mask_avx2};
+#endif
+
+} // namespace
+
+const Kernels* kernels_for(Level level) {
+    switch (level) {
+        case Level::SCALAR:
+            return &SCALAR_KERNELS;
+#ifdef AWK_SIMD_X86
+        case Level::SSE2:
+            return &SSE2_KERNELS;  // Part of the x86-64 baseline
+        case Level::AVX2:
+            return cpu_has_avx2() ? &AVX2_KERNELS : nullptr;
+#endif
+        default:
+            return nullptr;
+    }
+}
+
+const Kernels& kernels() {
+    static const Kernels& best = [] () -> const Kernels& {
+        for (Level level : {Level::AVX2, Level::SSE2}) {
+            if (const Kernels* k = kernels_for(level)) {
+                return *k;
+            }
+        }
+        return SCALAR_KERNELS;
+    }();
+    return best;
+}
+
+} // namespace simd
+} // namespace awk
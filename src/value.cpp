@@ -1,4 +1,7 @@
 #include "awk/value.hpp"
+#include "awk/array.hpp"
+#include "awk/number_conv.hpp"
+#include "awk/regex.hpp"
 #include <cstdlib>
 #include <cstring>
 #include <sstream>
@@ -10,79 +13,157 @@
 
 namespace awk {
 
+static_assert(sizeof(AWKValue) <= 24, "AWKValue should stay compact");
+
+// AWK arrays have reference semantics: copying the value (passing it to a
+// function) shares the elements instead of cloning them
+struct AWKValue::ArrayRep {
+    size_t refs = 1;
+    AWKArray entries;
+};
+
+// ============================================================================
+// String Storage
+// ============================================================================
+
+AWKValue::StringRep* AWKValue::StringRep::create(const char* text, size_t size, size_t capacity) {
+    auto* rep = static_cast<StringRep*>(::operator new(sizeof(StringRep) + capacity + 1));
+    rep->size = size;
+    rep->capacity = capacity;
+    rep->refs = 1;
+    rep->number = 0.0;
+    rep->numeric = NUMERIC_UNPARSED;
+    std::memcpy(rep->data(), text, size);
+    rep->data()[size] = '\0';
+    return rep;
+}
+
+void AWKValue::StringRep::release(StringRep* rep) {
+    if (--rep->refs == 0) {
+        ::operator delete(rep);
+    }
+}
+
+void AWKValue::set_string(const char* text, size_t size, ValueType type) {
+    if (size <= INLINE_CAPACITY) {
+        std::memcpy(inline_, text, size);
+        inline_[size] = '\0';
+        inline_size_ = static_cast<unsigned char>(size);
+        numeric_ = NUMERIC_UNPARSED;
+    } else {
+        heap_ = StringRep::create(text, size, size);
+        inline_size_ = HEAP_STRING;
+    }
+    type_ = type;
+}
+
+void AWKValue::take(AWKValue& other) noexcept {
+    std::memcpy(static_cast<void*>(&number_), &other.number_, sizeof(number_));
+    std::memcpy(inline_, other.inline_, sizeof(inline_));
+    inline_size_ = other.inline_size_;
+    type_ = other.type_;
+    numeric_ = other.numeric_;
+
+    other.number_ = 0.0;
+    other.inline_size_ = 0;
+    other.type_ = ValueType::UNINITIALIZED;
+}
+
+void AWKValue::release() noexcept {
+    switch (type_) {
+        case ValueType::STRING:
+        case ValueType::STRNUM:
+            if (heap_string()) {
+                StringRep::release(heap_);
+            }
+            break;
+        case ValueType::ARRAY:
+            if (--array_->refs == 0) {
+                delete array_;
+            }
+            break;
+        case ValueType::REGEX:
+            delete regex_;
+            break;
+        default:
+            break;
+    }
+    number_ = 0.0;
+    inline_size_ = 0;
+    type_ = ValueType::UNINITIALIZED;
+    numeric_ = NUMERIC_UNPARSED;
+}
+
 // ============================================================================
 // Constructors
 // ============================================================================
 
-AWKValue::AWKValue(const std::string& str)
-    : type_(ValueType::STRING)
-    , number_value_(0.0)
-    , string_value_(str) {}
+AWKValue::AWKValue(const std::string& str) {
+    set_string(str.data(), str.size(), ValueType::STRING);
+}
 
-AWKValue::AWKValue(std::string&& str)
-    : type_(ValueType::STRING)
-    , number_value_(0.0)
-    , string_value_(std::move(str)) {}
+AWKValue::AWKValue(std::string&& str) {
+    set_string(str.data(), str.size(), ValueType::STRING);
+}
 
-AWKValue AWKValue::strnum(const std::string& str) {
+AWKValue AWKValue::strnum(std::string_view str) {
     AWKValue v;
-    v.type_ = ValueType::STRNUM;
-    v.string_value_ = str;
-    v.number_value_ = string_to_number(str);
+    v.set_string(str.data(), str.size(), ValueType::STRNUM);
     return v;
 }
 
-AWKValue::AWKValue(const AWKValue& other) {
-    copy_from(other);
+AWKValue::AWKValue(const AWKValue& other) : number_(0.0) {
+    switch (other.type_) {
+        case ValueType::STRING:
+        case ValueType::STRNUM:
+            if (other.heap_string()) {
+                heap_ = other.heap_;  // Shared until one side appends
+                ++heap_->refs;
+                inline_size_ = HEAP_STRING;
+            } else {
+                std::memcpy(inline_, other.inline_, sizeof(inline_));
+                inline_size_ = other.inline_size_;
+                number_ = other.number_;  // The cached number comes along
+                numeric_ = other.numeric_;
+            }
+            break;
+        case ValueType::ARRAY:
+            array_ = other.array_;  // Arrays are shared, never copied
+            ++array_->refs;
+            break;
+        case ValueType::REGEX:
+            regex_ = new RegexRep(*other.regex_);  // The compiled regex is shared
+            break;
+        default:
+            number_ = other.number_;
+            break;
+    }
+    type_ = other.type_;
 }
 
 AWKValue::AWKValue(AWKValue&& other) noexcept {
-    move_from(std::move(other));
+    take(other);
 }
 
 AWKValue& AWKValue::operator=(const AWKValue& other) {
     if (this != &other) {
-        copy_from(other);
+        // Copy first: other may live inside the array being replaced
+        AWKValue copy(other);
+        *this = std::move(copy);
     }
     return *this;
 }
 
 AWKValue& AWKValue::operator=(AWKValue&& other) noexcept {
     if (this != &other) {
-        move_from(std::move(other));
+        // Take the payload before releasing ours, for the same reason
+        AWKValue taken(std::move(other));
+        release();
+        take(taken);
     }
     return *this;
 }
 
-AWKValue::~AWKValue() = default;
-
-void AWKValue::copy_from(const AWKValue& other) {
-    type_ = other.type_;
-    number_value_ = other.number_value_;
-    string_value_ = other.string_value_;
-
-    if (other.array_value_) {
-        array_value_ = std::make_unique<AWKArray>(*other.array_value_);
-    } else {
-        array_value_.reset();
-    }
-
-    regex_value_ = other.regex_value_;
-    regex_pattern_ = other.regex_pattern_;
-}
-
-void AWKValue::move_from(AWKValue&& other) noexcept {
-    type_ = other.type_;
-    number_value_ = other.number_value_;
-    string_value_ = std::move(other.string_value_);
-    array_value_ = std::move(other.array_value_);
-    regex_value_ = std::move(other.regex_value_);
-    regex_pattern_ = std::move(other.regex_pattern_);
-
-    other.type_ = ValueType::UNINITIALIZED;
-    other.number_value_ = 0.0;
-}
-
 // ============================================================================
 // Type Information
 // ============================================================================
@@ -111,10 +192,13 @@ std::string AWKValue::to_string(const std::string& convfmt) const {
     switch (type_) {
         case ValueType::STRING:
         case ValueType::STRNUM:
-            return string_value_;
+            return std::string(string_data(), string_size());
 
-        case ValueType::NUMBER:
-            return number_to_string(number_value_, convfmt);
+        case ValueType::NUMBER: {
+            std::string str;
+            number_to_string(number_, convfmt, str);
+            return str;
+        }
 
         case ValueType::UNINITIALIZED:
             return "";
@@ -123,41 +207,46 @@ std::string AWKValue::to_string(const std::string& convfmt) const {
             return "";  // Arrays cannot be converted to strings
 
         case ValueType::REGEX:
-            return regex_pattern_;
+            return regex_->pattern;
     }
     return "";
 }
 
-double AWKValue::string_to_number(const std::string& str) {
-    if (str.empty()) return 0.0;
-
-    const char* s = str.c_str();
-    char* end;
-
-    // Skip whitespace
-    while (*s && std::isspace(static_cast<unsigned char>(*s))) ++s;
-
-    if (*s == '\0') return 0.0;
+std::string_view AWKValue::to_string_view(std::string& scratch) const {
+    return to_string_view(scratch, "%.6g");
+}
 
-    // Hexadecimal?
-    if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
-        long long val = std::strtoll(s, &end, 16);
-        return static_cast<double>(val);
+std::string_view AWKValue::to_string_view(std::string& scratch, const std::string& convfmt) const {
+    switch (type_) {
+        case ValueType::STRING:
+        case ValueType::STRNUM:
+            return text();
+        case ValueType::REGEX:
+            return regex_->pattern;
+        case ValueType::NUMBER:
+            number_to_string(number_, convfmt, scratch);
+            return scratch;
+        default:
+            return std::string_view();
     }
-
-    // Parse normally
-    double val = std::strtod(s, &end);
-
-    // If nothing was parsed, return 0
-    if (end == s) return 0.0;
-
-    return val;
 }
 
-bool AWKValue::looks_numeric(const std::string& str) {
-    if (str.empty()) return false;
+AWKValue::NumericState AWKValue::parse_number() const {
+    const char* str = string_data();
+    double num = numconv::parse_number(str, string_size());
+    NumericState state = text_looks_numeric(str) ? NUMERIC_STRING : NUMERIC_PREFIX;
+    if (heap_string()) {
+        heap_->number = num;
+        heap_->numeric = state;
+    } else {
+        number_ = num;
+        numeric_ = state;
+    }
+    return state;
+}
 
-    const char* s = str.c_str();
+bool AWKValue::text_looks_numeric(const char* str) {
+    const char* s = str;
 
     // Skip whitespace
     while (*s && std::isspace(static_cast<unsigned char>(*s))) ++s;
@@ -214,18 +303,25 @@ bool AWKValue::looks_numeric(const std::string& str) {
     return *s == '\0';
 }
 
-std::string AWKValue::number_to_string(double num, const std::string& format) {
-    // Ganzzahl-Optimierung
+void AWKValue::number_to_string(double num, const std::string& format, std::string& out) {
+    char buffer[64];
+
+    // Ganzzahl-Optimierung (2^63 itself does not fit a long long)
     if (std::floor(num) == num &&
-        num >= std::numeric_limits<long long>::min() &&
-        num <= std::numeric_limits<long long>::max()) {
-        return std::to_string(static_cast<long long>(num));
+        num >= -9223372036854775808.0 && num < 9223372036854775808.0) {
+        char* end = numconv::format_integer(static_cast<long long>(num), buffer);
+        out.assign(buffer, static_cast<size_t>(end - buffer));
+        return;
     }
 
     // sprintf-artige Formatierung
-    char buffer[64];
-    std::snprintf(buffer, sizeof(buffer), format.c_str(), num);
-    return buffer;
+    size_t length = numconv::format_double(num, format.c_str(), buffer, sizeof(buffer));
+    if (length < sizeof(buffer)) {
+        out.assign(buffer, length);
+        return;
+    }
+    out.resize(length);
+    numconv::format_double(num, format.c_str(), &out[0], length + 1);
 }
 
 // ============================================================================
@@ -302,31 +398,26 @@ AWKValue& AWKValue::operator%=(const AWKValue& other) {
 }
 
 AWKValue& AWKValue::pre_increment() {
-    double val = to_number() + 1.0;
-    type_ = ValueType::NUMBER;
-    number_value_ = val;
-    string_value_.clear();
+    set_number(to_number() + 1.0);
     return *this;
 }
 
 AWKValue& AWKValue::pre_decrement() {
-    double val = to_number() - 1.0;
-    type_ = ValueType::NUMBER;
-    number_value_ = val;
-    string_value_.clear();
+    set_number(to_number() - 1.0);
     return *this;
 }
 
+// x++ yields the number x held, not a copy of x ("abc"++ is 0)
 AWKValue AWKValue::post_increment() {
-    AWKValue old = *this;
-    pre_increment();
-    return old;
+    double old = to_number();
+    set_number(old + 1.0);
+    return AWKValue(old);
 }
 
 AWKValue AWKValue::post_decrement() {
-    AWKValue old = *this;
-    pre_decrement();
-    return old;
+    double old = to_number();
+    set_number(old - 1.0);
+    return AWKValue(old);
 }
 
 // ============================================================================
@@ -335,18 +426,10 @@ AWKValue AWKValue::post_decrement() {
 
 int AWKValue::compare(const AWKValue& other) const {
     // AWK comparison rules:
-    // 1. If both are numeric (or strnum), numeric comparison
+    // 1. If both are numeric (or strnum that looks numeric), numeric comparison
     // 2. Otherwise string comparison
 
-    bool left_numeric = (type_ == ValueType::NUMBER ||
-                         type_ == ValueType::STRNUM ||
-                         type_ == ValueType::UNINITIALIZED);
-
-    bool right_numeric = (other.type_ == ValueType::NUMBER ||
-                          other.type_ == ValueType::STRNUM ||
-                          other.type_ == ValueType::UNINITIALIZED);
-
-    if (left_numeric && right_numeric) {
+    if (is_numeric() && other.is_numeric()) {
         double l = to_number();
         double r = other.to_number();
         if (l < r) return -1;
@@ -354,10 +437,14 @@ int AWKValue::compare(const AWKValue& other) const {
         return 0;
     }
 
-    // String-Vergleich
-    std::string l = to_string();
-    std::string r = other.to_string();
-    int cmp = l.compare(r);
+    // String-Vergleich (strings are compared in place)
+    auto is_text = [](ValueType t) { return t == ValueType::STRING || t == ValueType::STRNUM; };
+    int cmp;
+    if (is_text(type_) && is_text(other.type_)) {
+        cmp = text().compare(other.text());
+    } else {
+        cmp = to_string().compare(other.to_string());
+    }
     if (cmp < 0) return -1;
     if (cmp > 0) return 1;
     return 0;
@@ -395,20 +482,67 @@ AWKValue AWKValue::concatenate(const AWKValue& other) const {
     return AWKValue(to_string() + other.to_string());
 }
 
-void AWKValue::append_string(const std::string& str) {
+void AWKValue::append_string(std::string_view str) {
     // Convert to string type if needed, then append in place
-    if (type_ != ValueType::STRING) {
-        string_value_ = to_string();
+    if (type_ == ValueType::STRNUM) {
         type_ = ValueType::STRING;
+    } else if (type_ != ValueType::STRING) {
+        std::string text = to_string();
+        release();
+        set_string(text.data(), text.size(), ValueType::STRING);
+    }
+
+    size_t size = string_size();
+    size_t new_size = size + str.size();
+    if (!heap_string()) {
+        if (new_size <= INLINE_CAPACITY) {
+            std::memcpy(inline_ + size, str.data(), str.size());
+            inline_[new_size] = '\0';
+            inline_size_ = static_cast<unsigned char>(new_size);
+            numeric_ = NUMERIC_UNPARSED;
+            return;
+        }
+        // Moving to the heap: leave room to grow
+        StringRep* rep = StringRep::create(inline_, size, new_size + 4096);
+        heap_ = rep;
+        inline_size_ = HEAP_STRING;
+    } else if (new_size > heap_->capacity || heap_->refs > 1) {
+        // Pre-allocate more space to reduce reallocations
+        // When capacity is exceeded, grow by 2x or at least 4KB.
+        // A shared block is copied first (copy on write).
+        size_t new_cap = heap_->capacity;
+        if (new_size > new_cap) {
+            new_cap = std::max(heap_->capacity * 2, new_size + 4096);
+        }
+        StringRep* rep = StringRep::create(heap_->data(), size, new_cap);
+        StringRep::release(heap_);
+        heap_ = rep;
+    }
+    std::memcpy(heap_->data() + size, str.data(), str.size());
+    heap_->data()[new_size] = '\0';
+    heap_->size = new_size;
+    heap_->numeric = NUMERIC_UNPARSED;
+}
+
+void AWKValue::assign_string(std::string_view str) {
+    if ((type_ == ValueType::STRING || type_ == ValueType::STRNUM) && heap_string() &&
+        heap_->refs == 1 && str.size() > INLINE_CAPACITY && str.size() <= heap_->capacity) {
+        std::memmove(heap_->data(), str.data(), str.size());
+        heap_->data()[str.size()] = '\0';
+        heap_->size = str.size();
+        heap_->numeric = NUMERIC_UNPARSED;
+        type_ = ValueType::STRING;
+        return;
     }
-    // Pre-allocate more space to reduce reallocations
-    // When capacity is exceeded, grow by 2x or at least 4KB
-    if (string_value_.size() + str.size() > string_value_.capacity()) {
-        size_t new_cap = std::max(string_value_.capacity() * 2,
-                                  string_value_.size() + str.size() + 4096);
-        string_value_.reserve(new_cap);
+    if (owns_heap()) {
+        // Build the new payload before releasing the old one: str may point
+        // into it
+        AWKValue value;
+        value.set_string(str.data(), str.size(), ValueType::STRING);
+        *this = std::move(value);
+        return;
     }
-    string_value_ += str;
+    set_string(str.data(), str.size(), ValueType::STRING);
 }
 
 // ============================================================================
@@ -416,75 +550,100 @@ void AWKValue::append_string(const std::string& str) {
 // ============================================================================
 
 AWKValue& AWKValue::array_access(const std::string& key) {
-    if (type_ != ValueType::ARRAY) {
-        type_ = ValueType::ARRAY;
-        array_value_ = std::make_unique<AWKArray>();
+    return as_array()[key];
+}
+
+AWKValue& AWKValue::array_access(long long index) {
+    return as_array()[index];
+}
+
+AWKValue& AWKValue::array_access(const TupleKey& key) {
+    return as_array()[key];
+}
+
+bool AWKValue::array_contains(const TupleKey& key) const {
+    return type_ == ValueType::ARRAY && array_->entries.find(key) != nullptr;
+}
+
+void AWKValue::array_delete(const TupleKey& key) {
+    if (type_ == ValueType::ARRAY) {
+        array_->entries.erase(key);
     }
-    return (*array_value_)[key];
 }
 
 const AWKValue* AWKValue::array_get(const std::string& key) const {
-    if (type_ != ValueType::ARRAY || !array_value_) {
-        return nullptr;
-    }
-    auto it = array_value_->find(key);
-    if (it == array_value_->end()) {
+    if (type_ != ValueType::ARRAY) {
         return nullptr;
     }
-    return &it->second;
+    return array_->entries.find(key);
 }
 
 bool AWKValue::array_contains(const std::string& key) const {
-    if (type_ != ValueType::ARRAY || !array_value_) {
+    if (type_ != ValueType::ARRAY) {
         return false;
     }
-    return array_value_->find(key) != array_value_->end();
+    return array_->entries.contains(key);
 }
 
 void AWKValue::array_delete(const std::string& key) {
-    if (type_ == ValueType::ARRAY && array_value_) {
-        array_value_->erase(key);
+    if (type_ == ValueType::ARRAY) {
+        array_->entries.erase(key);
     }
 }
 
 void AWKValue::array_clear() {
-    if (type_ == ValueType::ARRAY && array_value_) {
-        array_value_->clear();
+    if (type_ == ValueType::ARRAY) {
+        array_->entries.clear();
     }
 }
 
 size_t AWKValue::array_size() const {
-    if (type_ != ValueType::ARRAY || !array_value_) {
+    if (type_ != ValueType::ARRAY) {
         return 0;
     }
-    return array_value_->size();
+    return array_->entries.size();
 }
 
 std::vector<std::string> AWKValue::array_keys() const {
     std::vector<std::string> keys;
-    if (type_ == ValueType::ARRAY && array_value_) {
-        keys.reserve(array_value_->size());
-        for (const auto& [key, _] : *array_value_) {
-            keys.push_back(key);
-        }
+    if (type_ == ValueType::ARRAY) {
+        keys.reserve(array_->entries.size());
+        array_->entries.for_each([&keys](std::string_view key, const AWKValue&) {
+            keys.emplace_back(key);
+        });
     }
     return keys;
 }
 
 AWKArray& AWKValue::as_array() {
     if (type_ != ValueType::ARRAY) {
+        ArrayRep* array = new ArrayRep();
+        release();
+        array_ = array;
         type_ = ValueType::ARRAY;
-        array_value_ = std::make_unique<AWKArray>();
     }
-    return *array_value_;
+    return array_->entries;
 }
 
 const AWKArray& AWKValue::as_array() const {
     static AWKArray empty;
-    if (type_ != ValueType::ARRAY || !array_value_) {
+    if (type_ != ValueType::ARRAY) {
         return empty;
     }
-    return *array_value_;
+    return array_->entries;
+}
+
+long long AWKValue::integer_subscript(const AWKValue& subscript) {
+    // Integral numbers convert to "%d" whatever CONVFMT is; 2^53 keeps the
+    // value exact
+    if (subscript.type_ != ValueType::NUMBER) {
+        return 0;
+    }
+    double num = subscript.number_;
+    if (num >= 1.0 && num <= 9007199254740992.0 && std::floor(num) == num) {
+        return static_cast<long long>(num);
+    }
+    return 0;
 }
 
 std::string AWKValue::make_array_key(const std::vector<AWKValue>& indices,
@@ -518,28 +677,35 @@ std::string AWKValue::make_array_key(const std::vector<AWKValue>& indices,
 // ============================================================================
 
 void AWKValue::set_regex(const std::string& pattern) {
-    type_ = ValueType::REGEX;
-    regex_pattern_ = pattern;
+    std::shared_ptr<Regex> compiled;
     try {
-        regex_value_ = std::make_shared<std::regex>(
-            pattern,
-            std::regex_constants::extended
-        );
-    } catch (const std::regex_error&) {
-        // For invalid pattern: create empty regex
-        regex_value_ = std::make_shared<std::regex>();
+        compiled = std::make_shared<Regex>(pattern);
+    } catch (const RegexError&) {
+        // Invalid pattern: matches nothing
     }
+    set_regex(pattern, std::move(compiled));
+}
+
+void AWKValue::set_regex(const std::string& pattern, std::shared_ptr<Regex> compiled) {
+    RegexRep* regex = new RegexRep{pattern, std::move(compiled)};
+    release();
+    regex_ = regex;
+    type_ = ValueType::REGEX;
+}
+
+const std::string& AWKValue::regex_pattern() const {
+    static const std::string empty;
+    return type_ == ValueType::REGEX ? regex_->pattern : empty;
 }
 
 bool AWKValue::regex_match(const std::string& text) const {
-    if (type_ == ValueType::REGEX && regex_value_) {
-        return std::regex_search(text, *regex_value_);
+    if (type_ == ValueType::REGEX && regex_->compiled) {
+        return regex_->compiled->search(text);
     }
     // Als String-Pattern interpretieren
     try {
-        std::regex re(to_string(), std::regex_constants::extended);
-        return std::regex_search(text, re);
-    } catch (...) {
+        return Regex(to_string()).search(text);
+    } catch (const RegexError&) {
         return false;
     }
 }
@@ -547,24 +713,21 @@ bool AWKValue::regex_match(const std::string& text) const {
 std::string AWKValue::regex_replace(const std::string& text,
                                     const std::string& replacement,
                                     bool global) const {
-    std::regex re;
+    std::shared_ptr<Regex> re;
 
-    if (type_ == ValueType::REGEX && regex_value_) {
-        re = *regex_value_;
+    if (type_ == ValueType::REGEX && regex_->compiled) {
+        re = regex_->compiled;
     } else {
         try {
-            re = std::regex(to_string(), std::regex_constants::extended);
-        } catch (...) {
+            re = std::make_shared<Regex>(to_string());
+        } catch (const RegexError&) {
             return text;
         }
     }
 
-    if (global) {
-        return std::regex_replace(text, re, replacement);
-    } else {
-        return std::regex_replace(text, re, replacement,
-                                  std::regex_constants::format_first_only);
-    }
+    std::string result;
+    substitute(*re, text, replacement, false, global ? 0 : 1, result);
+    return result;
 }
 
 } // namespace awk
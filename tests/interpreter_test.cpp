@@ -3,7 +3,18 @@
 #include "awk/lexer.hpp"
 #include "awk/parser.hpp"
 #include "awk/interpreter.hpp"
+#include "awk/array.hpp"
+#include "awk/resolver.hpp"
+#include "awk/record_reader.hpp"
+#include "awk/simd_scan.hpp"
+#include "awk/number_conv.hpp"
+#include "awk/format_program.hpp"
+#include "awk/output_sink.hpp"
+#include "awk/output_file_pool.hpp"
+#include "awk/regex.hpp"
 #include <sstream>
+#include <cmath>
+#include <cstring>
 
 using namespace awk;
 using namespace test;
@@ -5522,3 +5533,1270 @@ TEST(Interpreter_Namespace_Printf) {
     );
     ASSERT_EQ(result, "2 + 3 = 5\n");
 }
+
+// ============================================================================
+// Bytecode VM Engine
+// ============================================================================
+
+// Helper: Run AWK program with the selected engine
+std::string run_awk_engine(const std::string& source, const std::string& input, Engine engine) {
+    auto prog = Parser::parse_string(source);
+    if (!prog) return "PARSE_ERROR";
+
+    Interpreter interp;
+    interp.set_engine(engine);
+    std::ostringstream output;
+    interp.set_output_stream(output);
+
+    std::vector<std::string> files;
+    if (!input.empty()) {
+        std::ofstream tmp("__test_input.tmp");
+        tmp << input;
+        tmp.close();
+        files.push_back("__test_input.tmp");
+    }
+
+    try {
+        interp.run(*prog, files);
+    } catch (const std::exception& e) {
+        std::remove("__test_input.tmp");
+        return std::string("RUNTIME_ERROR: ") + e.what();
+    }
+
+    std::remove("__test_input.tmp");
+    return output.str();
+}
+
+// Helper: Run with both engines and require identical output
+std::string run_awk_both(const std::string& source, const std::string& input = "") {
+    std::string tree = run_awk_engine(source, input, Engine::TREE);
+    std::string vm = run_awk_engine(source, input, Engine::VM);
+    if (tree != vm) {
+        return "ENGINE_MISMATCH tree=[" + tree + "] vm=[" + vm + "]";
+    }
+    return vm;
+}
+
+TEST(Interpreter_VM_Arithmetic) {
+    std::string result = run_awk_both("BEGIN { x = 7; print x + 3, x - 3, x * 3, x % 4, 2 ^ 10, -x, !x }");
+    ASSERT_EQ(result, "10 4 21 3 1024 -7 0\n");
+}
+
+TEST(Interpreter_VM_Assignment_Operators) {
+    std::string result = run_awk_both(
+        "BEGIN { x = 2; x += 3; x *= 4; x -= 1; x /= 19; x ^= 3; y = 5; print x, y++, ++y, y--, --y }");
+    ASSERT_EQ(result, "1 5 7 7 5\n");
+}
+
+TEST(Interpreter_VM_Short_Circuit) {
+    std::string result = run_awk_both(
+        "function t(v) { calls++; return v } BEGIN { print (0 && t(1)), (1 || t(1)), (1 && t(2)), calls }");
+    ASSERT_EQ(result, "0 1 1 1\n");
+}
+
+TEST(Interpreter_VM_Loops_Break_Continue) {
+    std::string result = run_awk_both(R"(BEGIN {
+        for (i = 0; i < 10; i++) { if (i == 2) continue; if (i == 5) break; s = s i }
+        while (1) { if (++n >= 3) break }
+        do { m++ } while (m < 4)
+        print s, n, m
+    })");
+    ASSERT_EQ(result, "0134 3 4\n");
+}
+
+TEST(Interpreter_VM_ForIn_Break_Unwinds) {
+    std::string result = run_awk_both(R"(BEGIN {
+        a[1]; a[2]; a[3]
+        for (k in a) { for (j in a) { inner++; break }; outer++ }
+        for (k in a) { cnt++; if (cnt == 2) break }
+        print inner, outer, cnt
+    })");
+    ASSERT_EQ(result, "3 3 2\n");
+}
+
+TEST(Interpreter_VM_Switch_Fallthrough_Default) {
+    std::string result = run_awk_both(R"(BEGIN {
+        for (i = 1; i <= 4; i++) {
+            switch (i) {
+            case 1: s = s "a"
+            case 2: s = s "b"; break
+            case 3: s = s "c"; continue
+            default: s = s "d"
+            }
+            s = s "|"
+        }
+        print s
+    })");
+    ASSERT_EQ(result, "ab|b|cd|\n");
+}
+
+TEST(Interpreter_VM_Arrays_And_Delete) {
+    std::string result = run_awk_both(R"(BEGIN {
+        a["x"] = 1; a["y"] += 5; a["z"]++; a[1, 2] = "multi"
+        delete a["x"]
+        print length(a), a["y"], a["z"], ((1, 2) in a), ("x" in a), a[1, 2]
+        delete a
+        print length(a)
+    })");
+    ASSERT_EQ(result, "3 5 1 1 0 multi\n0\n");
+}
+
+TEST(Interpreter_VM_User_Functions_Recursion) {
+    std::string result = run_awk_both(
+        "function fib(n) { return n < 2 ? n : fib(n-1) + fib(n-2) } "
+        "function noret() { x = 1 } "
+        "BEGIN { print fib(15), noret() \"|\" }");
+    ASSERT_EQ(result, "610 |\n");
+}
+
+TEST(Interpreter_VM_Fields_And_Patterns) {
+    std::string result = run_awk_both(
+        "/b/ { $2 = \"X\"; print } NR == 2 { $1 += 10; print $1, NF } !/a/ { n++ } END { print n }",
+        "a b\n5 c\nd e\n");
+    ASSERT_EQ(result, "a X\n15 2\n2\n");
+}
+
+TEST(Interpreter_VM_Range_Pattern) {
+    std::string result = run_awk_both("/start/,/end/ { print NR }", "x\nstart\ny\nend\nz\n");
+    ASSERT_EQ(result, "2\n3\n4\n");
+}
+
+TEST(Interpreter_VM_Next_And_Exit) {
+    std::string result = run_awk_both(
+        "NR == 1 { next } { print } NR == 3 { exit } END { print \"end\" }",
+        "a\nb\nc\nd\n");
+    ASSERT_EQ(result, "b\nc\n");
+}
+
+TEST(Interpreter_VM_Tree_Fallback_Builtins) {
+    // sub/gsub/split/getline are delegated to the tree walker
+    std::string result = run_awk_both(R"(BEGIN {
+        s = "aaa"; n = gsub(/a/, "b", s)
+        k = split("p:q:r", parts, ":")
+        "echo hi" | getline line
+        print n, s, k, parts[3], line, toupper(substr("hello", 1, 2))
+    })");
+    ASSERT_EQ(result, "3 bbb 3 r hi HE\n");
+}
+
+TEST(Interpreter_VM_Printf_And_String_Append) {
+    std::string result = run_awk_both(
+        "BEGIN { for (i = 1; i <= 3; i++) s = s i \",\"; printf \"%s %5.2f %d\\n\", s, 3.14159, 42 }");
+    ASSERT_EQ(result, "1,2,3,  3.14 42\n");
+}
+
+// ============================================================================
+// Resolved Variable Slots
+// ============================================================================
+
+TEST(Interpreter_Slots_Function_Does_Not_See_Caller_Locals) {
+    // AWK scoping is lexical: x in inner() is the global, not outer()'s local
+    std::string result = run_awk_both(
+        "function inner() { return x } function outer(x) { return inner() } "
+        "BEGIN { x = \"global\"; print outer(\"local\") }");
+    ASSERT_EQ(result, "global\n");
+}
+
+TEST(Interpreter_Slots_SYMTAB_Shares_Storage) {
+    std::string result = run_awk_both(
+        "BEGIN { count = 5; SYMTAB[\"count\"]++; print count, SYMTAB[\"count\"] }");
+    ASSERT_EQ(result, "6 6\n");
+}
+
+TEST(Interpreter_Slots_Special_Assignment_In_Action) {
+    std::string result = run_awk_both("NR == 2 { OFS = \":\" } { $1 = $1; print }", "a b\nc d\ne f\n");
+    ASSERT_EQ(result, "a b\nc:d\ne:f\n");
+}
+
+// ============================================================================
+// Call Frames
+// ============================================================================
+
+TEST(Interpreter_Frames_Recursion_Keeps_Locals_Apart) {
+    std::string result = run_awk_both(
+        "function fib(n,   a, b) { if (n < 2) return n; a = fib(n - 1); b = fib(n - 2); return a + b }\n"
+        "BEGIN { print fib(15) }");
+    ASSERT_EQ(result, "610\n");
+}
+
+TEST(Interpreter_Frames_Locals_Start_Uninitialized) {
+    // Slots are reused between calls but every call starts with fresh locals
+    std::string result = run_awk_both(
+        "function f(x,   tmp, arr) { r = (tmp == \"\") \" \" length(arr); tmp = x; arr[x] = 1; return r }\n"
+        "BEGIN { print f(1); print f(2) }");
+    ASSERT_EQ(result, "1 0\n1 0\n");
+}
+
+TEST(Interpreter_Frames_Next_Inside_Function) {
+    // The frame is popped when next unwinds through the call
+    std::string result = run_awk_both(
+        "function skip(x,   y) { y = x; if (y == \"b\") next; return y }\n"
+        "{ v = skip($1); print v, y }", "a\nb\nc\n");
+    ASSERT_EQ(result, "a \nc \n");
+}
+
+// ============================================================================
+// Completion Signals
+// ============================================================================
+
+TEST(Interpreter_Completion_Next_From_Nested_Loops) {
+    std::string result = run_awk_both(
+        "{ for (i = 1; i <= NF; i++) { while (1) { if ($i == \"x\") next; break } } print }\n"
+        "END { print NR }", "a b\nc x d\ne\n");
+    ASSERT_EQ(result, "a b\ne\n3\n");
+}
+
+TEST(Interpreter_Completion_Continue_Through_Switch) {
+    // continue inside a switch belongs to the enclosing loop
+    std::string result = run_awk_both(
+        "BEGIN { for (i = 1; i <= 4; i++) { switch (i) { case 2: continue\n"
+        "default: s = s i } } print s }");
+    ASSERT_EQ(result, "134\n");
+}
+
+TEST(Interpreter_Completion_Return_From_For_In) {
+    std::string result = run_awk_both(
+        "function find(arr, v,   k) { for (k in arr) if (arr[k] == v) return k; return \"none\" }\n"
+        "BEGIN { a[\"x\"] = 1; a[\"y\"] = 2; print find(a, 2), find(a, 3) }");
+    ASSERT_EQ(result, "y none\n");
+}
+
+TEST(Interpreter_Completion_Exit_Skips_Remaining_Rules) {
+    std::string result = run_awk_both(
+        "NR == 2 { exit }\n{ print }", "a\nb\nc\n");
+    ASSERT_EQ(result, "a\n");
+}
+
+// ============================================================================
+// Regex Literals
+// ============================================================================
+
+TEST(Interpreter_RegexLiteral_Rebuilt_When_IGNORECASE_Changes) {
+    std::string result = run_awk_both(
+        "NR == 3 { IGNORECASE = 1 }\n/abc/ { print NR }", "abc\nABC\nABC\nabc\n");
+    ASSERT_EQ(result, "1\n3\n4\n");
+}
+
+TEST(Interpreter_RegexLiteral_Match_Operators) {
+    std::string result = run_awk_both(
+        "{ print ($1 ~ /^[0-9]+$/), ($1 !~ /^[0-9]+$/), !/x/ }", "42\nx1\n");
+    ASSERT_EQ(result, "1 0 1\n0 1 0\n");
+}
+
+TEST(Interpreter_RegexLiteral_As_Value) {
+    std::string result = run_awk_both(
+        "{ n = split($0, parts, /,+/); x = $0; gsub(/,+/, \"-\", x); print n, parts[2], x }", "a,,b,c\n");
+    ASSERT_EQ(result, "3 b a-b-c\n");
+}
+
+// ============================================================================
+// Field Spans
+// ============================================================================
+
+TEST(Interpreter_FieldSpans_Assign_Then_Read_Others) {
+    // Unassigned fields must survive the rebuild that moves them
+    std::string result = run_awk_both(
+        "{ $2 = \"LONGER\"; print; print $1, $3; $1 = \"\"; print; print $2 }", "a b c\n");
+    ASSERT_EQ(result, "a LONGER c\na c\n LONGER c\nLONGER\n");
+}
+
+TEST(Interpreter_FieldSpans_Regex_FS_Drops_Trailing_Empty) {
+    std::string result = run_awk_both(
+        "BEGIN { FS = \",+\" } { print NF; for (i = 1; i <= NF; i++) printf \"[%s]\", $i; print \"\" }",
+        ",a,,b,\n");
+    ASSERT_EQ(result, "3\n[][a][b]\n");
+}
+
+TEST(Interpreter_FieldSpans_Whitespace_Tabs_And_Extension) {
+    std::string result = run_awk_both(
+        "{ print NF, $2; $5 = \"e\"; print; print NF }", "  a\t\tb  c  \n");
+    ASSERT_EQ(result, "3 b\na b c  e\n5\n");
+}
+
+TEST(Interpreter_FieldSpans_Default_Action_After_Assignment) {
+    std::string result = run_awk_both("BEGIN { OFS = \"-\" } { $1 = $1 } 1", "a b c\n");
+    ASSERT_EQ(result, "a-b-c\n");
+}
+
+// ============================================================================
+// Field Demand
+// ============================================================================
+
+static FieldDemand field_demand_of(const std::string& source) {
+    auto prog = Parser::parse_string(source);
+    Environment env;
+    Resolver resolver(env);
+    resolver.resolve(*prog);
+    return resolver.field_demand();
+}
+
+TEST(Interpreter_FieldDemand_Constant_Fields) {
+    FieldDemand demand = field_demand_of("{ print $1, $3 } /x/ { n++ }");
+    ASSERT_FALSE(demand.all);
+    ASSERT_EQ(demand.max_index, 3u);
+
+    demand = field_demand_of("{ n += length($0) } END { print n }");
+    ASSERT_FALSE(demand.all);
+    ASSERT_EQ(demand.limit(), 0u);
+}
+
+TEST(Interpreter_FieldDemand_Needs_All_Fields) {
+    ASSERT_TRUE(field_demand_of("{ print NF }").all);
+    ASSERT_TRUE(field_demand_of("{ print $NF }").all);
+    ASSERT_TRUE(field_demand_of("{ $2 = \"x\"; print }").all);
+    ASSERT_TRUE(field_demand_of("{ $1++ }").all);
+    ASSERT_TRUE(field_demand_of("{ sub(/a/, \"b\", $2) }").all);
+    ASSERT_TRUE(field_demand_of("{ print SYMTAB[\"NF\"] }").all);
+    ASSERT_FALSE(field_demand_of("{ $0 = \"a b\"; print $1 }").all);
+}
+
+TEST(Interpreter_FieldDemand_Bounded_Split_Output) {
+    std::string result = run_awk_both(
+        "{ print $2; $0 = \"x y z\"; print $1 }", "a b c d e f\n1,2 3\n");
+    ASSERT_EQ(result, "b\nx\n3\nx\n");
+
+    result = run_awk_both("BEGIN { FS = \":\" } { print $1 }", "a:b:c\n:x\nnosep\n");
+    ASSERT_EQ(result, "a\n\nnosep\n");
+
+    result = run_awk_both("/b/ { print } END { print NR }", "a\nb\n");
+    ASSERT_EQ(result, "b\n2\n");
+}
+
+// ============================================================================
+// Record Reader
+// ============================================================================
+
+TEST(Interpreter_RecordReader_Records_Across_Blocks) {
+    // Records straddle the first block boundary; one is longer than a block
+    std::string long_record(RecordReader::BLOCK_SIZE + 100, 'x');
+    std::string text = std::string(RecordReader::BLOCK_SIZE - 3, 'a') + "\nbc;" +
+                       long_record + ";tail";
+    {
+        std::ofstream tmp("__test_reader.tmp", std::ios::binary);
+        tmp << text;
+    }
+
+    auto reader = RecordReader::open("__test_reader.tmp");
+    ASSERT_TRUE(reader != nullptr);
+    std::string_view record, rt;
+    ASSERT_TRUE(reader->read_record("\n", record, rt));
+    ASSERT_EQ(record.size(), RecordReader::BLOCK_SIZE - 3);
+    ASSERT_EQ(std::string(rt), "\n");
+    ASSERT_TRUE(reader->read_record(";", record, rt));
+    ASSERT_EQ(std::string(record), "bc");
+    ASSERT_TRUE(reader->read_record(";", record, rt));
+    ASSERT_EQ(record.size(), long_record.size());
+    ASSERT_TRUE(reader->read_record(";", record, rt));
+    ASSERT_EQ(std::string(record), "tail");
+    ASSERT_EQ(std::string(rt), "");
+    ASSERT_FALSE(reader->read_record(";", record, rt));
+    ASSERT_FALSE(reader->failed());
+
+    reader.reset();
+    std::remove("__test_reader.tmp");
+}
+
+TEST(Interpreter_RecordReader_Paragraph_Mode) {
+    std::string result = run_awk_both(
+        "BEGIN { RS = \"\" } { print NR \": \" $0 \" [\" RT \"]\" }",
+        "\n\na\nb\n\n\n\nc\n");
+    ASSERT_EQ(result, "1: a\nb [\n]\n2: c []\n");
+}
+
+TEST(Interpreter_RecordReader_Getline_Reads_Main_Input) {
+    std::string result = run_awk_both(
+        "NR == 1 { getline; print \"got\", $0, NR, FNR; next } { print }",
+        "1\n2\n3\n");
+    ASSERT_EQ(result, "got 2 2 2\n3\n");
+}
+
+TEST(Interpreter_RecordReader_Mapped_File) {
+    {
+        std::ofstream tmp("__test_reader.tmp", std::ios::binary);
+        tmp << "one\n\ntwo;three";
+    }
+
+    auto reader = RecordReader::open("__test_reader.tmp", true);
+    ASSERT_TRUE(reader != nullptr);
+#ifndef _WIN32
+    ASSERT_TRUE(reader->mapped());
+#endif
+    std::string_view first, second, rt;
+    ASSERT_TRUE(reader->read_record("\n", first, rt));
+    ASSERT_TRUE(reader->read_record("\n", second, rt));
+    ASSERT_TRUE(reader->read_record(";", second, rt));
+    ASSERT_EQ(std::string(first), "one");  // Earlier records stay valid
+    ASSERT_EQ(std::string(second), "two");
+    ASSERT_TRUE(reader->read_record(";", second, rt));
+    ASSERT_EQ(std::string(second), "three");
+    ASSERT_FALSE(reader->read_record(";", second, rt));
+
+    reader.reset();
+    std::remove("__test_reader.tmp");
+}
+
+TEST(Interpreter_RecordReader_Mmap_And_Streaming_Agree) {
+    const std::string source =
+        "{ n += NF; last = $2 } FNR == 2 { $1 = \"X\"; print } END { print n, last, $0 }";
+    {
+        std::ofstream tmp("__test_input.tmp");
+        tmp << "a b c\nd e\nf g h i";
+    }
+
+    std::string outputs[2];
+    for (int mapped = 0; mapped < 2; ++mapped) {
+        auto prog = Parser::parse_string(source);
+        Interpreter interp;
+        interp.set_mmap_input(mapped == 1);
+        std::ostringstream output;
+        interp.set_output_stream(output);
+        interp.run(*prog, {"__test_input.tmp"});
+        outputs[mapped] = output.str();
+    }
+    std::remove("__test_input.tmp");
+
+    // $0 in END outlives the mapping of its file
+    ASSERT_EQ(outputs[1], "X e\n9 g f g h i\n");
+    ASSERT_EQ(outputs[0], outputs[1]);
+}
+
+// ============================================================================
+// SIMD Scanning
+// ============================================================================
+
+TEST(Interpreter_Simd_Kernels_Match_Scalar) {
+    // Pseudo-random bytes heavy in separators and bytes >= 0x80
+    const char alphabet[] = {' ', '\t', '\n', '\v', '\r', ',', 'a', 'z', '\0', '\x85', '\xa0', '\x1f'};
+    char block[64];
+    uint32_t seed = 12345;
+    const simd::Kernels* scalar = simd::kernels_for(simd::Level::SCALAR);
+    ASSERT_TRUE(scalar != nullptr);
+
+    for (simd::Level level : {simd::Level::SSE2, simd::Level::AVX2}) {
+        const simd::Kernels* k = simd::kernels_for(level);
+        if (!k) continue;  // Not available on this CPU
+        for (int round = 0; round < 200; ++round) {
+            for (char& c : block) {
+                seed = seed * 1103515245 + 12345;
+                c = alphabet[(seed >> 16) % sizeof(alphabet)];
+            }
+            ASSERT_EQ(k->space_mask(block), scalar->space_mask(block));
+            ASSERT_EQ(k->char_mask(block, ','), scalar->char_mask(block, ','));
+            ASSERT_EQ(k->char_mask(block, '\x85'), scalar->char_mask(block, '\x85'));
+        }
+    }
+}
+
+TEST(Interpreter_Simd_Splitting_Across_Blocks) {
+    // Fields straddle the 64-byte block boundaries
+    std::string line;
+    std::string expected_words;
+    for (int i = 0; i < 40; ++i) {
+        std::string word(static_cast<size_t>(i % 7 + 1), static_cast<char>('a' + i % 26));
+        line += word + (i % 3 ? " " : " \t ");
+        expected_words += word + "|";
+    }
+
+    std::string words;
+    simd::for_each_word(simd::kernels(), line.data(), line.size(), [&](size_t start, size_t length) {
+        words += line.substr(start, length) + "|";
+        return true;
+    });
+    ASSERT_EQ(words, expected_words);
+
+    std::string csv = line;
+    std::replace(csv.begin(), csv.end(), ' ', ',');
+    std::string result = run_awk_both("BEGIN { FS = \",\" } { print NF, $1, $3 }", csv + "\n");
+    std::vector<size_t> commas;
+    simd::for_each_char(simd::kernels(), csv.data(), csv.size(), ',', [&](size_t pos) {
+        commas.push_back(pos);
+        return true;
+    });
+    ASSERT_EQ(commas.size(), static_cast<size_t>(std::count(csv.begin(), csv.end(), ',')));
+    ASSERT_EQ(result, std::to_string(commas.size() + 1) + " a bb\n");
+}
+
+// ============================================================================
+// Whitespace Tokenizer
+// ============================================================================
+
+TEST(Interpreter_Split_Whitespace_Matches_Fields) {
+    std::string result = run_awk_both(
+        "{ n = split($0, a); printf \"%d %d\", n, NF; for (i = 1; i <= n; i++) printf \" [%s|%s]\", a[i], $i; print \"\" }",
+        " \t lead  two\tthree \t\n\n   \n");
+    ASSERT_EQ(result, "3 3 [lead|lead] [two|two] [three|three]\n0 0\n0 0\n");
+}
+
+TEST(Interpreter_Split_Whitespace_Explicit_Separator) {
+    std::string result = run_awk_both(
+        "BEGIN { s = \"  a\\tb\\n c  \"; n = split(s, x, \" \"); print n, x[1] x[2] x[3]; "
+        "print split(\"\", y, \" \"), length(y) }");
+    ASSERT_EQ(result, "3 abc\n0 0\n");
+}
+
+// ============================================================================
+// Value Layout
+// ============================================================================
+
+TEST(Interpreter_Value_Compact_Size) {
+    ASSERT_TRUE(sizeof(AWKValue) <= 24);
+}
+
+TEST(Interpreter_Value_Inline_And_Heap_Strings) {
+    AWKValue s("short");
+    for (int i = 0; i < 10; ++i) {
+        s.append_string("0123456789");  // Crosses from inline to heap storage
+    }
+    ASSERT_EQ(s.to_string().size(), 105u);
+    ASSERT_EQ(s.to_string().substr(0, 8), "short012");
+
+    AWKValue copy = s;
+    copy.append_string("!");
+    ASSERT_EQ(s.to_string().size(), 105u);
+    ASSERT_EQ(copy.to_string().size(), 106u);
+
+    AWKValue moved = std::move(copy);
+    ASSERT_TRUE(copy.is_uninitialized());
+    ASSERT_EQ(moved.to_string().back(), '!');
+
+    AWKValue num = AWKValue::strnum(" 42 ");
+    ASSERT_TRUE(num.is_strnum());
+    ASSERT_EQ(num.to_number(), 42.0);
+    ASSERT_EQ(num.to_string(), " 42 ");
+    ASSERT_TRUE(AWKValue::strnum("10") < AWKValue::strnum("9.5e1"));
+    ASSERT_TRUE(AWKValue("abc") < AWKValue("abd"));
+}
+
+TEST(Interpreter_Value_Assign_From_Own_Element) {
+    AWKValue arr;
+    arr.array_access("k") = AWKValue(std::string(40, 'x'));
+    arr = arr.as_array().at("k");
+    ASSERT_TRUE(arr.is_string());
+    ASSERT_EQ(arr.to_string(), std::string(40, 'x'));
+
+    AWKValue re;
+    re.set_regex("a+b");
+    AWKValue re_copy = re;
+    ASSERT_TRUE(re_copy.is_regex());
+    ASSERT_EQ(re_copy.regex_pattern(), "a+b");
+    ASSERT_TRUE(re_copy.regex_match("xaab"));
+}
+
+// ============================================================================
+// Copy-on-Write Strings
+// ============================================================================
+
+TEST(Interpreter_String_Copy_Shares_Until_Append) {
+    AWKValue s(std::string(40, 'a'));
+    AWKValue copy = s;
+    std::string scratch;
+    ASSERT_TRUE(s.to_string_view(scratch).data() == copy.to_string_view(scratch).data());
+
+    copy.append_string("b");
+    ASSERT_EQ(s.to_string(), std::string(40, 'a'));
+    ASSERT_EQ(copy.to_string(), std::string(40, 'a') + "b");
+    ASSERT_TRUE(s.to_string_view(scratch).data() != copy.to_string_view(scratch).data());
+
+    AWKValue num(2.5);
+    ASSERT_EQ(num.to_string_view(scratch), "2.5");
+}
+
+// ============================================================================
+// Number Conversion Kernels
+// ============================================================================
+
+TEST(Interpreter_Numconv_Format_Matches_Printf) {
+    const char* formats[] = {"%.6g", "%g", "%.2f", "%.10g", "%.3e", "%.0f", "%.17g", "%+08.2f"};
+    std::vector<double> values = {0.1, -2.5, 1e-7, 123456.5, 1234567.5, 1e21, 3.14159265358979,
+                                  -0.0, 5e-324, 1.7976931348623157e308, 0.5, 2.5};
+    uint64_t seed = 42;
+    for (int i = 0; i < 500; ++i) {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        double mantissa = static_cast<double>(seed >> 11) / 9007199254740992.0;
+        values.push_back((mantissa - 0.5) * std::pow(10.0, static_cast<int>(seed % 40) - 20));
+    }
+    for (const char* format : formats) {
+        for (double v : values) {
+            char expected[512];
+            char actual[512];
+            int n = std::snprintf(expected, sizeof(expected), format, v);
+            size_t len = numconv::format_double(v, format, actual, sizeof(actual));
+            ASSERT_EQ(len, static_cast<size_t>(n));
+            ASSERT_EQ(std::string(actual, len), std::string(expected));
+        }
+    }
+
+    char small[8];
+    ASSERT_EQ(numconv::format_double(1e20, "%.2f", small, sizeof(small)), 24u);
+}
+
+TEST(Interpreter_Numconv_Integers_And_Parsing) {
+    char buf[numconv::INTEGER_DIGITS + 1];
+    for (long long v : {0LL, 7LL, -10LL, 99LL, 100LL, 123456789012LL,
+                        9223372036854775807LL, -9223372036854775807LL - 1}) {
+        char* end = numconv::format_integer(v, buf);
+        ASSERT_EQ(std::string(buf, end), std::to_string(v));
+    }
+
+    const char* texts[] = {"42", "  -3.5e2xyz", "+7", ".5", "5.", "1e", "1e+", "abc", "",
+                           "  ", "-", "+-1", "0x1A", "-0x10", "inf", "-nan", "1e400",
+                           "1e-400", "00012", "123456789012345678901234567890", "\t\n 8 "};
+    for (const char* text : texts) {
+        double expected = 0.0;
+        const char* s = text;
+        while (*s == ' ' || *s == '\t' || *s == '\n') ++s;
+        if (s[0] == '0' && s[1] == 'x') {
+            expected = static_cast<double>(std::strtoll(s, nullptr, 16));
+        } else {
+            expected = std::strtod(s, nullptr);
+        }
+        double actual = numconv::parse_number(text, std::strlen(text));
+        if (std::isnan(expected)) {
+            ASSERT_TRUE(std::isnan(actual));
+        } else {
+            ASSERT_EQ(actual, expected);
+        }
+    }
+}
+
+TEST(Interpreter_Number_Output_Formats) {
+    std::string result = run_awk_both(
+        "BEGIN { print 1/3, 100000 * 10, 2^53, -2^63, 1e300 * 10, 0.1 + 0.2; "
+        "OFMT = \"%.3e\"; print 1234.5678; OFMT = \"%.70f\"; print 0.5 }");
+    ASSERT_EQ(result, "0.333333 1000000 9007199254740992 -9223372036854775808 1e+301 0.3\n"
+                      "1.235e+03\n0.5" + std::string(69, '0') + "\n");
+}
+
+// ============================================================================
+// Compiled printf Formats
+// ============================================================================
+
+TEST(Interpreter_Format_Program_Matches_Printf) {
+    const char* int_specs[] = {"%d", "%5d", "%-5d|", "%05d", "%-05d|", "%+d", "% d", "%.3d", "%i"};
+    const char* float_specs[] = {"%f", "%.2f", "%10.2f", "%-10.2f|", "%010.2f", "%e", "%12.3e",
+                                 "%g", "%8.3g", "%-8g|", "%#g", "%+.1f", "%.0f", "%G", "%E"};
+    const char* string_specs[] = {"%s", "%10s", "%-10s|", "%.2s", "%5.1s", "%-5.3s|"};
+    double numbers[] = {0.0, 7.0, -42.0, 123456.0, -0.5, 3.14159, 2.5e-7, -1e10, 1e300};
+    const char* strings[] = {"", "a", "hello", "hello world, longer"};
+
+    char expected[512];
+    for (const char* spec : int_specs) {
+        for (double n : numbers) {
+            if (std::fabs(n) > 1e18) continue;
+            std::string actual;
+            AWKValue arg(n);
+            FormatProgram(spec).run(&arg, 1, actual);
+            std::string wide_spec(spec);
+            wide_spec.insert(wide_spec.find_first_of("di"), "ll");
+            std::snprintf(expected, sizeof(expected), wide_spec.c_str(), static_cast<long long>(n));
+            ASSERT_EQ(actual, std::string(expected));
+        }
+    }
+    for (const char* spec : float_specs) {
+        for (double n : numbers) {
+            std::string actual;
+            AWKValue arg(n);
+            FormatProgram(spec).run(&arg, 1, actual);
+            std::snprintf(expected, sizeof(expected), spec, n);
+            ASSERT_EQ(actual, std::string(expected));
+        }
+    }
+    for (const char* spec : string_specs) {
+        for (const char* str : strings) {
+            std::string actual;
+            AWKValue arg(str);
+            FormatProgram(spec).run(&arg, 1, actual);
+            std::snprintf(expected, sizeof(expected), spec, str);
+            ASSERT_EQ(actual, std::string(expected));
+        }
+    }
+
+    // '*' takes width and precision from the arguments; a negative width
+    // left-justifies
+    AWKValue args[] = {AWKValue(-6), AWKValue(2), AWKValue(3.14159), AWKValue("x")};
+    std::string out;
+    FormatProgram("[%*.*f] %d%% %s %q").run(args, 4, out);
+    ASSERT_EQ(out, "[3.14  ] 0%  q");
+
+    AWKValue big(-1e10);
+    out.clear();
+    FormatProgram("%d|%+d").run(&big, 1, out);
+    ASSERT_EQ(out, "-10000000000|+0");
+}
+
+TEST(Interpreter_Printf_Formats_Reused) {
+    std::string result = run_awk_both(
+        "{ printf \"%-6s|%4d|%7.2f\\n\", $1, $2, $3; f = \"<%\" NR \"d>\"; printf f, NR; "
+        "s = s sprintf(\"%03d \", $2) } END { print \"\"; print s }",
+        "ab 7 1.5\nlonger 1234 -22.125\n");
+    ASSERT_EQ(result, "ab    |   7|   1.50\n<1>longer|1234| -22.12\n< 2>\n007 1234 \n");
+}
+
+// ============================================================================
+// Output Sinks
+// ============================================================================
+
+TEST(Interpreter_Output_Sink_Buffers_Until_Flush) {
+    std::ostringstream stream;
+    OutputSink sink(stream, 8);
+    sink.write("abc");
+    sink.end_statement();
+    ASSERT_EQ(stream.str(), "");  // Fully buffered
+    sink.write("defgh");
+    ASSERT_EQ(stream.str(), "");  // Exactly fills the buffer
+    sink.write("i");
+    ASSERT_EQ(stream.str(), "abcdefgh");
+    sink.write(std::string(20, 'x'));  // Larger than the buffer: written through
+    ASSERT_EQ(stream.str(), "abcdefghi" + std::string(20, 'x'));
+    ASSERT_TRUE(sink.flush());
+
+    sink.set_line_buffered(true);
+    sink.write("j\n");
+    sink.end_statement();
+    ASSERT_EQ(stream.str(), "abcdefghi" + std::string(20, 'x') + "j\n");
+
+    OutputSink discard;
+    discard.write(std::string(100, 'y'));
+    ASSERT_TRUE(discard.flush());
+}
+
+TEST(Interpreter_Output_Sink_File_Truncate_And_Append) {
+    const char* path = "__test_sink.tmp";
+    std::string big(3 * OutputSink::DEFAULT_BUFFER_SIZE / 2, 'z');
+    {
+        auto sink = OutputSink::open_file(path, false);
+        ASSERT_TRUE(sink != nullptr);
+        sink->write("first\n");
+        sink->write(big);  // Buffered text and big go out together
+        sink->write("\n");
+        ASSERT_TRUE(sink->close());
+    }
+    {
+        auto sink = OutputSink::open_file(path, true);
+        ASSERT_TRUE(sink != nullptr);
+        sink->write("appended\n");
+    }  // Flushed by the destructor
+    std::ifstream in(path, std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    ASSERT_EQ(content, "first\n" + big + "\nappended\n");
+    in.close();
+
+    auto truncated = OutputSink::open_file(path, false);
+    truncated->write("new\n");
+    truncated.reset();
+    std::ifstream again(path, std::ios::binary);
+    std::string line;
+    std::getline(again, line);
+    ASSERT_EQ(line, "new");
+    ASSERT_FALSE(std::getline(again, line));
+    again.close();
+    std::remove(path);
+
+    ASSERT_TRUE(OutputSink::open_file("__no_such_dir__/out.tmp", false) == nullptr);
+}
+
+TEST(Interpreter_Print_Redirects_Keep_Order) {
+    std::string program =
+        "{ print $1 >> \"__test_sink_print.tmp\"; printf \"%s-\", $2 >> \"/dev/stdout\"; print $2 } "
+        "END { close(\"__test_sink_print.tmp\"); "
+        "while ((getline line < \"__test_sink_print.tmp\") > 0) print \"file:\" line; "
+        "print \"gone\" >> \"/dev/null\"; print \"last\" }";
+    for (Engine engine : {Engine::TREE, Engine::VM}) {
+        std::remove("__test_sink_print.tmp");
+        std::string result = run_awk_engine(program, "a 1\nb 2\n", engine);
+        ASSERT_EQ(result, "1-1\n2-2\nfile:a\nfile:b\nlast\n");
+    }
+    std::remove("__test_sink_print.tmp");
+}
+
+static std::string read_whole_file(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+TEST(Interpreter_Output_File_Pool_Releases_Cold_Files) {
+    const std::string paths[] = {"__test_pool_a.tmp", "__test_pool_b.tmp", "__test_pool_c.tmp"};
+    for (const auto& path : paths) {
+        std::remove(path.c_str());
+    }
+    {
+        std::ofstream stale(paths[0]);
+        stale << "stale\n";
+    }
+
+    OutputFilePool pool(2);
+    pool.get(paths[0], false)->write("a1\n");  // Truncates
+    pool.get(paths[1], true)->write("b1\n");
+    ASSERT_EQ(pool.open_count(), static_cast<size_t>(2));
+    pool.get(paths[2], false)->write("c1\n");  // Releases a
+    ASSERT_EQ(pool.open_count(), static_cast<size_t>(2));
+    ASSERT_EQ(pool.size(), static_cast<size_t>(3));
+    ASSERT_EQ(read_whole_file(paths[0]), "a1\n");
+
+    pool.get(paths[0], false)->write("a2\n");  // Reopened for appending, releases b
+    pool.get(paths[2], false)->write("c2\n");
+    pool.get(paths[1], true)->write("b2\n");
+    pool.flush_all();
+    ASSERT_EQ(read_whole_file(paths[0]), "a1\na2\n");
+    ASSERT_EQ(read_whole_file(paths[1]), "b1\nb2\n");
+    ASSERT_EQ(read_whole_file(paths[2]), "c1\nc2\n");
+
+    // After close() the next open truncates again
+    ASSERT_TRUE(pool.close(paths[0]));
+    ASSERT_FALSE(pool.close(paths[0]));
+    ASSERT_TRUE(pool.find(paths[0]) == nullptr);
+    pool.get(paths[0], false)->write("a3\n");
+    pool.get(paths[1], true);
+    pool.set_max_open(1);  // Releases c and a
+    ASSERT_EQ(pool.open_count(), static_cast<size_t>(1));
+    ASSERT_EQ(read_whole_file(paths[0]), "a3\n");
+    pool.clear();
+    ASSERT_EQ(pool.size(), static_cast<size_t>(0));
+
+    for (const auto& path : paths) {
+        std::remove(path.c_str());
+    }
+    ASSERT_TRUE(OutputFilePool::default_max_open() >= 1);
+}
+
+TEST(Interpreter_Print_Partitions_Beyond_Open_Limit) {
+    auto prog = Parser::parse_string(
+        "{ $0 = $2; print > (\"__test_part_\" NR % 8 \".tmp\") } "
+        "END { close(\"__test_part_0.tmp\"); $0 = \"again\"; print > \"__test_part_0.tmp\" }");
+    ASSERT_TRUE(prog != nullptr);
+    std::string input;
+    for (int i = 0; i < 40; ++i) {
+        input += "x " + std::to_string(i) + "\n";
+    }
+
+    for (Engine engine : {Engine::TREE, Engine::VM}) {
+        Interpreter interp;
+        interp.set_engine(engine);
+        interp.set_max_open_files(3);
+        std::ostringstream output;
+        interp.set_output_stream(output);
+        {
+            std::ofstream tmp("__test_input.tmp");
+            tmp << input;
+        }
+        interp.run(*prog, {"__test_input.tmp"});
+        std::remove("__test_input.tmp");
+
+        ASSERT_EQ(read_whole_file("__test_part_0.tmp"), "again\n");
+        ASSERT_EQ(read_whole_file("__test_part_5.tmp"), "4\n12\n20\n28\n36\n");
+        for (int i = 0; i < 8; ++i) {
+            std::remove(("__test_part_" + std::to_string(i) + ".tmp").c_str());
+        }
+    }
+}
+
+// ============================================================================
+// Cached Numeric Values
+// ============================================================================
+
+TEST(Interpreter_Value_Number_Cache_Follows_Text) {
+    AWKValue s = AWKValue::strnum("12");
+    ASSERT_EQ(s.to_number(), 12.0);
+    ASSERT_TRUE(s.looks_numeric());
+    s.append_string("abc");  // The cache must not outlive the text
+    ASSERT_EQ(s.to_number(), 12.0);
+    ASSERT_FALSE(s.looks_numeric());
+    s.assign_string("3.5");
+    ASSERT_EQ(s.to_number(), 3.5);
+
+    AWKValue heap = AWKValue::strnum("   12345678901234567890   ");
+    ASSERT_TRUE(heap.looks_numeric());
+    AWKValue copy = heap;
+    copy.append_string("x");
+    ASSERT_TRUE(heap.looks_numeric());
+    ASSERT_FALSE(copy.looks_numeric());
+    ASSERT_EQ(copy.to_number(), heap.to_number());
+
+    AWKValue in_place = AWKValue::strnum(std::string(30, '7'));
+    in_place.to_number();
+    in_place.assign_string(std::string(20, ' ') + "1.5");  // Reuses the heap block
+    ASSERT_EQ(in_place.to_number(), 1.5);
+}
+
+TEST(Interpreter_Strnum_Compares_As_String_Unless_Numeric) {
+    std::string result = run_awk_both(
+        "{ print ($1 == $2), ($1 < $2), ($3 < $4), ($1 < 5), ($5 == 0) }",
+        "abc abd 10 9.5e1\n");
+    ASSERT_EQ(result, "0 1 1 0 0\n");
+}
+
+TEST(Interpreter_String_Self_Concat_And_Assign_Value) {
+    std::string result = run_awk_both(
+        "BEGIN { s = \"abcdefghijklmnopqrst\"; t = s; s = s s; print length(s), length(t); "
+        "print (s = s \"x\"); u = s; s = s \"y\"; print substr(u, 40), substr(s, 40) }");
+    ASSERT_EQ(result,
+              "40 20\n"
+              "abcdefghijklmnopqrstabcdefghijklmnopqrstx\n"
+              "tx txy\n");
+}
+
+TEST(Interpreter_String_Builtins_On_Long_Values) {
+    std::string result = run_awk_both(
+        "BEGIN { s = \"the quick brown fox jumps over the lazy dog\"; "
+        "print length(s), index(s, \"lazy\"), substr(s, 5, 5), s ~ /fox/; "
+        "n = 12345678901; print length(n), index(n, 890) }");
+    ASSERT_EQ(result, "43 36 quick 1\n11 8\n");
+}
+
+// ============================================================================
+// Array Parameters
+// ============================================================================
+
+TEST(Interpreter_Array_Param_By_Reference) {
+    std::string result = run_awk_both(
+        "function fill(a, n,   i) { for (i = 1; i <= n; i++) a[i] = i * i }\n"
+        "function wipe(a) { delete a }\n"
+        "function drop(a, k) { delete a[k] }\n"
+        "BEGIN { t[0] = 0; fill(t, 4); print length(t), t[4]; drop(t, 4); print length(t); "
+        "wipe(t); print length(t) }");
+    ASSERT_EQ(result, "5 16\n4\n0\n");
+}
+
+TEST(Interpreter_Array_Param_Untyped_Becomes_Array) {
+    std::string result = run_awk_both(
+        "function inner(b) { b[\"x\"] = 1 }\n"
+        "function outer(c) { inner(c) }\n"
+        "function scalar(s) { s = 5 }\n"
+        "BEGIN { inner(a); print length(a), a[\"x\"]; outer(d); print length(d); "
+        "scalar(e); print length(e) \"|\" e \"|\" }");
+    ASSERT_EQ(result, "1 1\n1\n0||\n");
+}
+
+TEST(Interpreter_Array_Copy_Shares_Elements) {
+    AWKValue arr;
+    arr.array_access("k") = AWKValue(1.0);
+    AWKValue alias = arr;
+    alias.array_access("j") = AWKValue(2.0);
+    ASSERT_EQ(arr.array_size(), 2u);
+    ASSERT_TRUE(&arr.as_array() == &alias.as_array());
+}
+
+// ============================================================================
+// Array Table
+// ============================================================================
+
+TEST(Interpreter_Array_Table_Insert_Erase_Grow) {
+    AWKArray table;
+    for (int i = 0; i < 10000; ++i) {
+        table[std::to_string(i)] = AWKValue(static_cast<double>(i));
+    }
+    ASSERT_EQ(table.size(), 10000u);
+    for (int i = 0; i < 10000; i += 2) {
+        ASSERT_EQ(table.erase(std::to_string(i)), 1u);
+    }
+    ASSERT_EQ(table.erase("0"), 0u);
+    ASSERT_EQ(table.size(), 5000u);
+    ASSERT_TRUE(table.find("10") == nullptr);
+    ASSERT_EQ(table.at("9999").to_number(), 9999.0);
+
+    // Reinsertion after deletes rebuilds without losing or reordering
+    table["new"] = AWKValue("x");
+    size_t count = 0;
+    int previous = -1;
+    bool ordered = true;
+    table.for_each([&](std::string_view key, const AWKValue&) {
+        if (key != "new") {
+            int n = std::stoi(std::string(key));
+            ordered = ordered && n > previous && n % 2 == 1;
+            previous = n;
+        }
+        ++count;
+    });
+    ASSERT_TRUE(ordered);
+    ASSERT_EQ(count, 5001u);
+
+    table.clear();
+    ASSERT_TRUE(table.empty());
+    ASSERT_TRUE(table.dense());
+}
+
+TEST(Interpreter_Array_Table_Sliding_Window) {
+    AWKArray table;
+    for (int i = 0; i < 100000; ++i) {
+        table[std::to_string(i)] = AWKValue(1.0);
+        if (i >= 3) {
+            table.erase(std::to_string(i - 3));
+        }
+    }
+    ASSERT_EQ(table.size(), 3u);
+    ASSERT_TRUE(table.contains("99999"));
+    ASSERT_FALSE(table.contains("99996"));
+    ASSERT_TRUE(AWKArray::hash("abc") != AWKArray::hash("abd"));
+    ASSERT_TRUE(table.find("") == nullptr);
+}
+
+TEST(Interpreter_Array_For_In_Insertion_Order) {
+    std::string result = run_awk_both(
+        "BEGIN { a[\"zeta\"]; a[\"alpha\"]; a[3]; a[\"m\"]; delete a[3]; a[\"last\"]; "
+        "for (k in a) printf \"%s \", k; print \"\" }");
+    ASSERT_EQ(result, "zeta alpha m last \n");
+}
+
+// ============================================================================
+// Dense Arrays
+// ============================================================================
+
+TEST(Interpreter_Array_Dense_Until_Gap) {
+    AWKArray table;
+    for (long long i = 1; i <= 1000; ++i) {
+        table[i] = AWKValue(static_cast<double>(i));
+    }
+    ASSERT_TRUE(table.dense());
+    ASSERT_EQ(table["500"].to_number(), 500.0);  // Same element as table[500]
+    ASSERT_TRUE(table.find("0500") == nullptr);
+    ASSERT_TRUE(table.find(1001) == nullptr);
+    ASSERT_EQ(table.erase("1000"), 1u);          // Deleting the last keeps it dense
+    ASSERT_TRUE(table.dense());
+    ASSERT_EQ(table.size(), 999u);
+
+    table["x"] = AWKValue("y");                  // Not 1..n: becomes a hash table
+    ASSERT_FALSE(table.dense());
+    ASSERT_EQ(table.size(), 1000u);
+    ASSERT_EQ(table[999LL].to_number(), 999.0);
+    ASSERT_EQ(table.find("x")->to_string(), "y");
+
+    std::string keys;
+    table.for_each([&](std::string_view key, const AWKValue&) {
+        if (key.size() == 1) keys += key;
+    });
+    ASSERT_EQ(keys, "123456789x");
+}
+
+TEST(Interpreter_Array_Dense_Integer_And_String_Keys) {
+    std::string result = run_awk_both(
+        "BEGIN { n = split(\"a b c\", p); p[n + 1] = \"d\"; print length(p), p[\"4\"], (\"2\" in p), (\"02\" in p); "
+        "q[1.0] = \"one\"; q[2] = \"two\"; print q[\"1\"], q[1]; q[0.5] = \"half\"; q[\"x\"]; "
+        "for (k in q) printf \"%s \", k; print \"\"; "
+        "delete p[2]; for (k in p) printf \"%s=%s \", k, p[k]; print \"\" }");
+    ASSERT_EQ(result, "4 d 1 0\none one\n1 2 0.5 x \n1=a 3=c 4=d \n");
+}
+
+TEST(Interpreter_Array_Dense_Counting_Loop_And_Asort) {
+    std::string result = run_awk_both(
+        "BEGIN { for (i = 1; i <= 5; i++) a[i] = 10 - i; a[3] += 100; n = asort(a, b); "
+        "for (i = 1; i <= n; i++) printf \"%s \", b[i]; print \"\"; "
+        "split(\"\", a); a[2] = 1; for (k in a) print k, length(a) }");
+    ASSERT_EQ(result, "107 5 6 8 9 \n2 1\n");  // asort compares as strings
+}
+
+// ============================================================================
+// Tuple Keys
+// ============================================================================
+
+TEST(Interpreter_Array_Tuple_Key_Matches_Joined_Key) {
+    AWKValue parts[3] = {AWKValue("ab"), AWKValue(12.0), AWKValue(0.5)};
+    TupleKey key(parts, 3, "\x1c");
+    std::string joined = "ab\x1c" "12\x1c" "0.5";
+    ASSERT_EQ(key.join(), joined);
+    ASSERT_EQ(key.size(), joined.size());
+    ASSERT_TRUE(key.equals(joined));
+    ASSERT_FALSE(key.equals("ab\x1c" "12\x1c" "0.50"));
+    ASSERT_EQ(AWKArray::hash(key), AWKArray::hash(joined));
+
+    AWKArray table;
+    table[key] = AWKValue("x");
+    ASSERT_EQ(table.find(joined)->to_string(), "x");
+    ASSERT_EQ(table.erase(key), 1u);
+    ASSERT_TRUE(table.empty());
+}
+
+TEST(Interpreter_Array_Tuple_Key_Subscripts) {
+    std::string result = run_awk_both(
+        "BEGIN { a[1, \"x\"] = 5; a[1, \"x\"]++; print a[1 SUBSEP \"x\"], ((1, \"x\") in a); "
+        "for (k in a) { split(k, p, SUBSEP); print p[1], p[2] } "
+        "s = SUBSEP; SUBSEP = \":\"; print ((1, \"x\") in a), a[1 s \"x\"]; a[2, 3]; print (\"2:3\" in a); "
+        "delete a[2, 3]; print length(a) }");
+    ASSERT_EQ(result, "6 1\n1 x\n0 6\n1\n1\n");
+}
+
+TEST(Interpreter_Array_Tuple_Key_Many_Subscripts) {
+    std::string result = run_awk_both(
+        "BEGIN { SUBSEP = \"-\"; a[1,2,3,4,5,6,7,8,9,10] = \"ten\"; a[1,2,3,4,5,6,7,8] = \"eight\"; "
+        "print a[\"1-2-3-4-5-6-7-8-9-10\"], a[\"1-2-3-4-5-6-7-8\"], ((1,2,3,4,5,6,7,8,9,10) in a); "
+        "delete a[1,2,3,4,5,6,7,8,9,10]; for (k in a) print k }");
+    ASSERT_EQ(result, "ten eight 1\n1-2-3-4-5-6-7-8\n");
+}
+
+// ============================================================================
+// For-In Cursors
+// ============================================================================
+
+TEST(Interpreter_Array_Cursor_Survives_Deletes_And_Inserts) {
+    AWKValue array;
+    AWKArray& table = array.as_array();
+    for (int i = 0; i < 100; ++i) {
+        table["key" + std::to_string(i)] = AWKValue(i);
+    }
+
+    ArrayCursor cursor(array);
+    std::string_view key;
+    int visited = 0;
+    while (cursor.next(key)) {
+        ++visited;
+        if (key == "key0") {
+            // Tombstones outnumber live entries and the index is rebuilt,
+            // but positions stay put while the cursor is open
+            for (int i = 1; i < 100; i += 2) table.erase("key" + std::to_string(i));
+            for (int i = 0; i < 1000; ++i) table["new" + std::to_string(i)];
+        }
+    }
+    ASSERT_EQ(visited, 50);
+    ASSERT_EQ(table.size(), 1050u);
+    ASSERT_TRUE(table.contains("key98"));
+    ASSERT_FALSE(table.contains("key99"));
+
+    AWKValue scalar(1.0);
+    ArrayCursor none(scalar);
+    ASSERT_FALSE(none.next(key));
+}
+
+TEST(Interpreter_Array_For_In_Modified_By_Body) {
+    std::string result = run_awk_both(
+        "BEGIN { n = split(\"a b c d e\", a); "
+        "for (k in a) { printf \"%s \", k; if (k == 1) delete a[3]; a[k + 10] } print length(a); "
+        "for (k in a) { delete a; n++ } print n, length(a); "
+        "b[\"a-long-key-of-more-than-15\"]; b[\"another-long-key-in-b\"]; "
+        "for (k in b) { s = k; t = t k \" \" } print t; print s }");
+    ASSERT_EQ(result,
+              "1 2 4 5 8\n6 0\na-long-key-of-more-than-15 another-long-key-in-b \n"
+              "another-long-key-in-b\n");
+}
+
+// ============================================================================
+// Update Expressions
+// ============================================================================
+
+TEST(Interpreter_Update_Counters) {
+    std::string result = run_awk_both(
+        "{ count[$1]++; sum[$1] += $2; total = total + $2 } "
+        "END { print count[\"a\"], sum[\"a\"], count[\"b\"], sum[\"b\"], total, typeof(sum[\"b\"]) }",
+        "a 1\nb 2.5\na 3\n");
+    ASSERT_EQ(result, "2 4 1 2.5 6.5 number\n");
+}
+
+TEST(Interpreter_Update_Results) {
+    std::string result = run_awk_both(
+        "BEGIN { x = \"abc\"; print x++, x, u--, u; a[1, 2] = \"5\"; print a[1, 2]++, ++a[1, 2], a[1, 2] -= 3; "
+        "n = 7; n = n % 4; m = 2; m = m ^ 10; d = 1; d = d / 4; print n, m, d; "
+        "y = 1; y = y + (y = 5); print y }");
+    ASSERT_EQ(result, "0 1 0 -1\n5 7 4\n3 1024 0.25\n6\n");
+}
+
+// ============================================================================
+// Regex Engine
+// ============================================================================
+
+// "begin,end" of the leftmost-longest match, or "none"
+static std::string regex_find(const std::string& pattern, const std::string& text,
+                              size_t from = 0, unsigned flags = Regex::NONE) {
+    Regex re(pattern, flags);
+    Regex::Span match;
+    if (!re.find(text, from, match)) return "none";
+    return std::to_string(match.begin) + "," + std::to_string(match.end);
+}
+
+TEST(Interpreter_Regex_Leftmost_Longest) {
+    ASSERT_EQ(regex_find("abcd|bc", "xabcd"), "1,5");
+    ASSERT_EQ(regex_find("bc|abcd", "xabcd"), "1,5");
+    ASSERT_EQ(regex_find("a|ab|abc", "xxabcabc"), "2,5");
+    ASSERT_EQ(regex_find("(a|ab)(c|bcd)", "abcd"), "0,4");
+    ASSERT_EQ(regex_find("b*", "xbb"), "0,0");
+    ASSERT_EQ(regex_find("b+", "xbb"), "1,3");
+    ASSERT_EQ(regex_find("^a", "aa", 1), "none");
+    ASSERT_EQ(regex_find("a$", "aba"), "2,3");
+    ASSERT_EQ(regex_find("x*$", "abc"), "3,3");
+    ASSERT_EQ(regex_find("(^a|b)c", "bcac"), "0,2");
+    ASSERT_EQ(regex_find("c(a$|b)", "cacb"), "2,4");
+    ASSERT_EQ(regex_find("hello", "say hello"), "4,9");
+    ASSERT_EQ(regex_find("^$", ""), "0,0");
+    ASSERT_EQ(regex_find("HeLLo", "say hello", 0, Regex::ICASE), "4,9");
+    ASSERT_EQ(regex_find("[^a-z]+", "abcDEFghi", 0, Regex::ICASE), "none");
+}
+
+TEST(Interpreter_Regex_Syntax) {
+    ASSERT_EQ(regex_find("[]a]+", "x]a]"), "1,4");
+    ASSERT_EQ(regex_find("[^]a]", "]ab"), "2,3");
+    ASSERT_EQ(regex_find("[a-]+", "x-a-"), "1,4");
+    ASSERT_EQ(regex_find("[[:digit:][:upper:]]+", "ab12CDe"), "2,6");
+    ASSERT_EQ(regex_find("[\\/]", "a/b"), "1,2");
+    ASSERT_EQ(regex_find("a{2,3}", "aaaa"), "0,3");
+    ASSERT_EQ(regex_find("a{2}", "abaa"), "2,4");
+    ASSERT_EQ(regex_find("(ab){2,}", "abababx"), "0,6");
+    ASSERT_EQ(regex_find("a{,2}b", "aaab"), "1,4");
+    ASSERT_EQ(regex_find("a{x", "ba{x"), "1,4");
+    ASSERT_EQ(regex_find("{", "a{"), "1,2");
+    ASSERT_EQ(regex_find("*a", "b*a"), "1,3");
+    ASSERT_EQ(regex_find("a.c", "a\nc"), "0,3");
+    ASSERT_EQ(regex_find("\\.\\t\\x41\\101", "x.\tAA"), "1,5");
+    ASSERT_EQ(regex_find("\\w+\\s\\S", "-ab_1 x"), "1,7");
+    ASSERT_EQ(regex_find("\\`a|b\\'", "aab"), "0,1");
+
+    ASSERT_THROWS(Regex("(ab"));
+    ASSERT_THROWS(Regex("ab)"));
+    ASSERT_THROWS(Regex("[ab"));
+    ASSERT_THROWS(Regex("[z-a]"));
+    ASSERT_THROWS(Regex("[[:nope:]]"));
+    ASSERT_THROWS(Regex("a{3,2}"));
+}
+
+TEST(Interpreter_Regex_Word_Assertions_And_Captures) {
+    ASSERT_EQ(regex_find("\\ycat\\y", "concat cat"), "7,10");
+    ASSERT_EQ(regex_find("\\<c[a-z]*", "a concat"), "2,8");
+    ASSERT_EQ(regex_find("[a-z]+\\>", "ab1 cd"), "4,6");
+    ASSERT_EQ(regex_find("\\Bat", "at cat"), "4,6");
+
+    Regex re("([a-z]+)-([0-9]+)?(x)?");
+    std::vector<Regex::Span> groups;
+    ASSERT_TRUE(re.find_groups(" ab-12", 0, groups));
+    ASSERT_EQ(groups.size(), 4u);
+    ASSERT_EQ(groups[0].begin, 1u);
+    ASSERT_EQ(groups[0].end, 6u);
+    ASSERT_EQ(groups[1].begin, 1u);
+    ASSERT_EQ(groups[2].begin, 4u);
+    ASSERT_FALSE(groups[3].matched());
+
+    std::string out;
+    ASSERT_EQ(substitute(re, "a-1 b-2", "<\\2\\1&>", true, 0, out), 2u);
+    ASSERT_EQ(out, "<1aa-1> <2bb-2>");
+    ASSERT_EQ(substitute(Regex("x*"), "abc", "-", false, 0, out), 4u);
+    ASSERT_EQ(out, "-a-b-c-");
+    ASSERT_EQ(substitute(Regex("b*"), "abc", "X", false, 2, out), 1u);
+    ASSERT_EQ(out, "aXc");
+
+    std::string result = run_awk_both(
+        "BEGIN { s = \"key=value; k2=v2\"; "
+        "if (match(s, /([a-z0-9]+)=([a-z0-9]+)$/, m)) print RSTART, RLENGTH, m[1], m[2]; "
+        "print gensub(/([a-z0-9]+)=([a-z0-9]+)/, \"\\\\2:\\\\1\", \"g\", s); "
+        "t = \"a&b\"; gsub(/&/, \"[\\\\&]\", t); print t; "
+        "n = split(\"a1b22c\", p, /[0-9]+/); print n, p[1], p[2], p[3] }");
+    ASSERT_EQ(result, "12 5 k2 v2\nvalue:key; v2:k2\na[&]b\n3 a b c\n");
+}
+
+TEST(Interpreter_Regex_Long_Lines_And_Hostile_Patterns) {
+    // std::regex recursed once per character here and overflowed its stack
+    std::string line(1 << 20, 'a');
+    line += 'b';
+    ASSERT_EQ(regex_find("(a|b)*b", line), "0," + std::to_string(line.size()));
+    ASSERT_EQ(regex_find("(a*)*c", line), "none");
+    ASSERT_EQ(regex_find("(a|aa)+$", line), "none");
+
+    // (a|b)*a(a|b){17} needs up to 2^18 DFA states: the cache is flushed
+    // and rebuilt while scanning, without changing the result
+    std::string text;
+    uint32_t seed = 99;
+    for (int i = 0; i < 200000; ++i) {
+        seed = seed * 1103515245 + 12345;
+        text += ((seed >> 16) & 1) ? 'a' : 'b';
+    }
+    size_t end = 0;
+    for (size_t i = 18; i <= text.size(); ++i) {
+        if (text[i - 18] == 'a') end = i;
+    }
+    ASSERT_EQ(regex_find("(a|b)*a(a|b){17}", text), "0," + std::to_string(end));
+    ASSERT_TRUE(Regex("a(a|b){17}b$").search(text) == (text[text.size() - 19] == 'a' && text.back() == 'b'));
+}